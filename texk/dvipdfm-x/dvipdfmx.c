@@ -32,6 +32,9 @@
 #include <string.h>
 #include <limits.h>
 #include <ctype.h>
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_GETRUSAGE)
+#include <sys/resource.h>
+#endif
 
 #include "system.h"
 #include "mem.h"
@@ -83,6 +86,7 @@ static int    opt_flags = 0;
 static int    pdf_version_major = 1;
 static int    pdf_version_minor = 5;
 static int    compression_level = 9;
+static int    compression_threads = 1;
 
 static char   ignore_colors    = 0;
 static double annot_grow       = 0.0;
@@ -105,6 +109,12 @@ static int     image_cache_life = -2;
 /* Image format conversion filter template */
 static char   *filter_template  = NULL;
 
+/* Directory of the font subset cache, NULL for none */
+static char   *font_cache_dir   = NULL;
+
+/* Write out each page as soon as it is finished */
+static int     low_memory       = 0;
+
 /* Encryption */
 static int     do_encryption = 0;
 static int     key_bits      = 40;
@@ -185,9 +195,11 @@ show_usage (void)
   printf ("  --dvipdfm\tEnable DVIPDFM emulation mode\n");
   printf ("  -d number\tSet PDF decimal digits (0-5) [3]\n");
   printf ("  -f filename\tSet font map file name [pdftex.map]\n");
+  printf ("  --font-cache dir\tCache font subsets in directory dir [none]\n");
   printf ("  -g dimension\tAnnotation \"grow\" amount [0.0in]\n");
   printf ("  -h | --help \tShow this help message and exit\n");
   printf ("  -l \t\tLandscape mode\n");
+  printf ("  --low-memory\tWrite out each page as soon as it is finished\n");
   printf ("  -m number\tSet additional magnification [1.0]\n");
   printf ("  --mvorigin\tTranslate the origin for MP inclusion\n");
   printf ("  -o filename\tSet output file name, \"-\" for stdout [DVIFILE.pdf]\n");
@@ -197,6 +209,7 @@ show_usage (void)
   printf ("  -s pages\tSelect page ranges [all pages]\n");
   printf ("  --showpaper\tShow available paper formats and exit\n");
   printf ("  -t \t\tEmbed thumbnail images of PNG format (DVIFILE.pageno, pageno=int) \n");
+  printf ("  --threads number\tCompress streams in number threads, 0 for all CPUs [1]\n");
   printf ("  --version\tOutput version information and exit\n");
   printf ("  -v \t\tBe verbose\n");
   printf ("  -vv\t\tBe more verbose\n");
@@ -485,6 +498,9 @@ static struct option long_options[] = {
   {"dvipdfm", 0, 0, 132},
   {"mvorigin", 0, 0, 1000},
   {"kpathsea-debug", 1, 0, 133},
+  {"threads", 1, 0, 134},
+  {"font-cache", 1, 0, 135},
+  {"low-memory", 0, 0, 136},
   {0, 0, 0, 0}
 };
 
@@ -683,6 +699,25 @@ do_args_second_pass (int argc, char *argv[], const char *source, int unsafe)
       compression_level = atoi(optarg);
       break;
 
+    case 134: /* --threads */
+      compression_threads = atoi(optarg);
+      break;
+
+    case 135: /* --font-cache */
+      if (unsafe) {
+        WARN("Ignoring \"font-cache\" option for dvipdfmx:config special. (unsafe)");
+      } else {
+        if (font_cache_dir)
+          RELEASE(font_cache_dir);
+        font_cache_dir = NEW(strlen(optarg)+1, char);
+        strcpy(font_cache_dir, optarg);
+      }
+      break;
+
+    case 136: /* --low-memory */
+      low_memory = 1;
+      break;
+
     case 'd':
       pdfdecimaldigits = atoi(optarg);
       break;
@@ -752,6 +787,21 @@ do_args_second_pass (int argc, char *argv[], const char *source, int unsafe)
   return;
 }
 
+static void
+report_peak_memory (void)
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_GETRUSAGE)
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    usage.ru_maxrss /= 1024; /* bytes, not kilobytes */
+#endif
+    MESG("\nPeak memory usage: %ld kB", (long) usage.ru_maxrss);
+  }
+#endif
+}
+
 static void
 cleanup (void)
 {
@@ -763,6 +813,8 @@ cleanup (void)
     RELEASE(page_ranges);
   if (filter_template)
     RELEASE(filter_template);
+  if (font_cache_dir)
+    RELEASE(font_cache_dir);
 }
 
 static void
@@ -1206,6 +1258,7 @@ main (int argc, char *argv[])
   settings.annot_grow_amount  = annot_grow;
   settings.outline_open_depth = bookmark_open;
   settings.check_gotos        = !(opt_flags & OPT_PDFDOC_NO_DEST_REMOVE);
+  settings.low_memory         = low_memory;
 
   settings.device.dvi2pts     = dvi2pts;
   settings.device.precision   = pdfdecimaldigits;
@@ -1220,6 +1273,8 @@ main (int argc, char *argv[])
     pdf_set_version(version);
   }
   pdf_set_compression(compression_level);
+  pdf_set_compression_threads(compression_threads);
+  pdf_font_set_cache_dir(font_cache_dir);
   if (enable_thumbnail)
     pdf_doc_enable_manual_thumbnails();
 
@@ -1251,6 +1306,8 @@ main (int argc, char *argv[])
   }
 
   pdf_close_document();
+  if (dpx_conf.verbose_level > 0)
+    report_peak_memory();
 
   pdf_close_fontmaps(); /* pdf_font may depend on fontmap. */
 
@@ -188,6 +188,25 @@ struct name_dict
   struct ht_table *data;
 };
 
+/*
+ * In low-memory mode, pages are written out as soon as they are
+ * finished. A page dictionary needs a reference to its parent, so
+ * pages are collected into intermediate page tree nodes which are
+ * opened on demand and written when they are full. Only the nodes
+ * on the current path and the kids of the root node stay in memory.
+ */
+#define PAGE_STREAM_CLUSTER 32
+#define PAGE_STREAM_DEPTH   2
+
+struct page_node
+{
+  pdf_obj *dict;
+  pdf_obj *ref;
+  pdf_obj *kids;
+  int      num_kids;
+  int      count;
+};
+
 
 typedef struct pdf_doc
 {
@@ -210,6 +229,10 @@ typedef struct pdf_doc
     int       num_entries; /* This is not actually total number of pages. */
     int       max_entries;
     pdf_page *entries;
+
+    /* Used only in low-memory mode */
+    struct page_node nodes[PAGE_STREAM_DEPTH];
+    pdf_obj *kids;
   } pages;
 
   struct {
@@ -232,6 +255,7 @@ typedef struct pdf_doc
   struct {
     int    outline_open_depth;
     double annot_grow;
+    int    low_memory;
   } opt;
 
   struct form_list_node *pending_forms;
@@ -714,6 +738,92 @@ build_page_tree (pdf_doc  *p,
   return self;
 }
 
+static void
+doc_open_page_node (pdf_doc *p, int level)
+{
+  struct page_node *node = &(p->pages.nodes[level]);
+  pdf_obj          *parent_ref;
+
+  if (node->dict)
+    return;
+
+  node->dict     = pdf_new_dict();
+  node->ref      = pdf_ref_obj(node->dict);
+  node->kids     = pdf_new_array();
+  node->num_kids = 0;
+  node->count    = 0;
+
+  if (level + 1 < PAGE_STREAM_DEPTH) {
+    struct page_node *parent = &(p->pages.nodes[level + 1]);
+
+    doc_open_page_node(p, level + 1);
+    pdf_add_array(parent->kids, pdf_link_obj(node->ref));
+    parent->num_kids++;
+    parent_ref = pdf_link_obj(parent->ref);
+  } else {
+    if (!p->pages.kids)
+      p->pages.kids = pdf_new_array();
+    pdf_add_array(p->pages.kids, pdf_link_obj(node->ref));
+    parent_ref = pdf_ref_obj(p->root.pages);
+  }
+
+  pdf_add_dict(node->dict, pdf_new_name("Type"),   pdf_new_name("Pages"));
+  pdf_add_dict(node->dict, pdf_new_name("Parent"), parent_ref);
+
+  return;
+}
+
+static void
+doc_close_page_node (pdf_doc *p, int level)
+{
+  struct page_node *node = &(p->pages.nodes[level]);
+
+  if (!node->dict)
+    return;
+
+  pdf_add_dict(node->dict,
+               pdf_new_name("Count"), pdf_new_number((double) node->count));
+  pdf_add_dict(node->dict, pdf_new_name("Kids"), node->kids);
+  pdf_release_obj(node->ref);
+  pdf_release_obj(node->dict);
+
+  node->dict = NULL;
+  node->ref  = NULL;
+  node->kids = NULL;
+
+  return;
+}
+
+/*
+ * Write out a finished page in low-memory mode. The reference to the
+ * page is kept since other pages, outlines and articles may refer to it,
+ * but only by label: the page dictionary is released.
+ */
+static void
+doc_stream_page (pdf_doc *p, pdf_page *page)
+{
+  struct page_node *leaf = &(p->pages.nodes[0]);
+  pdf_obj          *page_ref;
+  int               level;
+
+  doc_open_page_node(p, 0);
+  pdf_add_array(leaf->kids, pdf_link_obj(page->page_ref));
+  leaf->num_kids++;
+  for (level = 0; level < PAGE_STREAM_DEPTH; level++)
+    p->pages.nodes[level].count++;
+
+  page_ref = pdf_link_obj(page->page_ref);
+  doc_flush_page(p, page, pdf_link_obj(leaf->ref));
+  pdf_unlink_ref(page_ref);
+  page->page_ref = page_ref;
+
+  for (level = 0; level < PAGE_STREAM_DEPTH &&
+         p->pages.nodes[level].num_kids == PAGE_STREAM_CLUSTER; level++)
+    doc_close_page_node(p, level);
+
+  return;
+}
+
 static void
 pdf_doc_init_page_tree (pdf_doc *p, double media_width, double media_height)
 {
@@ -731,6 +841,14 @@ pdf_doc_init_page_tree (pdf_doc *p, double media_width, double media_height)
   p->pages.bop = NULL;
   p->pages.eop = NULL;
 
+  {
+    int level;
+
+    for (level = 0; level < PAGE_STREAM_DEPTH; level++)
+      p->pages.nodes[level].dict = NULL;
+    p->pages.kids = NULL;
+  }
+
   p->pages.mediabox.llx = 0.0;
   p->pages.mediabox.lly = 0.0;
   p->pages.mediabox.urx = media_width;
@@ -782,9 +900,37 @@ pdf_doc_close_page_tree (pdf_doc *p)
   /*
    * Connect page tree to root node.
    */
-  page_tree_root = build_page_tree(p, FIRSTPAGE(p), PAGECOUNT(p), NULL);
-  pdf_merge_dict (p->root.pages, page_tree_root);
-  pdf_release_obj(page_tree_root);
+  if (p->opt.low_memory) {
+    int level;
+
+    for (level = 0; level < PAGE_STREAM_DEPTH; level++)
+      doc_close_page_node(p, level);
+    /*
+     * Pages were written before articles were closed,
+     * so they have no "B" entry for their beads.
+     */
+    for (page_no = 1; page_no <= PAGECOUNT(p); page_no++) {
+      pdf_page  *page;
+
+      page = doc_get_page_entry(p, page_no);
+      if (page->page_ref)
+        pdf_release_obj(page->page_ref);
+      if (page->beads)
+        pdf_release_obj(page->beads);
+      page->page_ref = NULL;
+      page->beads    = NULL;
+    }
+    pdf_add_dict(p->root.pages, pdf_new_name("Type"), pdf_new_name("Pages"));
+    pdf_add_dict(p->root.pages,
+                 pdf_new_name("Count"), pdf_new_number((double) PAGECOUNT(p)));
+    pdf_add_dict(p->root.pages, pdf_new_name("Kids"),
+                 p->pages.kids ? p->pages.kids : pdf_new_array());
+    p->pages.kids = NULL;
+  } else {
+    page_tree_root = build_page_tree(p, FIRSTPAGE(p), PAGECOUNT(p), NULL);
+    pdf_merge_dict (p->root.pages, page_tree_root);
+    pdf_release_obj(page_tree_root);
+  }
 
   /* They must be after build_page_tree() */
   if (p->pages.bop) {
@@ -1578,6 +1724,28 @@ pdf_doc_add_names (const char *category,
   if (!p->names[i].data) {
     p->names[i].data = pdf_new_name_tree();
   }
+  /*
+   * These become indirect objects in the name tree anyway.
+   * Write them now in low-memory mode.
+   */
+  if (p->opt.low_memory && key && keylen > 0 &&
+      !pdf_names_lookup_object(p->names[i].data, key, keylen)) {
+    switch (PDF_OBJ_TYPEOF(value)) {
+    case PDF_ARRAY:
+    case PDF_DICT:
+    case PDF_STREAM:
+    case PDF_STRING:
+      {
+        pdf_obj *ref = pdf_ref_obj(value);
+
+        pdf_release_obj(value);
+        value = ref;
+      }
+      break;
+    default:
+      break;
+    }
+  }
 
   return pdf_names_add_object(p->names[i].data, key, keylen, value);
 }
@@ -2234,7 +2402,7 @@ pdf_doc_ref_page (unsigned page_no)
   pdf_page *page;
 
   page = doc_get_page_entry(p, page_no);
-  if (!page->page_obj) {
+  if (!page->page_ref) {
     page->page_obj = pdf_new_dict();
     page->page_ref = pdf_ref_obj(page->page_obj);
   }
@@ -2474,6 +2642,8 @@ pdf_doc_end_page (void)
   doc_fill_page_background(p);
 
   pdf_doc_finish_page(p);
+  if (p->opt.low_memory)
+    doc_stream_page(p, &(p->pages.entries[PAGECOUNT(p) - 1]));
 
   return;
 }
@@ -2512,6 +2682,7 @@ pdf_open_document (const char *filename,
 
   p->opt.annot_grow = settings.annot_grow_amount;
   p->opt.outline_open_depth = settings.outline_open_depth;
+  p->opt.low_memory = settings.low_memory;
 
   pdf_init_resources();
   pdf_init_colors();
@@ -63,6 +63,7 @@ struct pdf_setting
     double annot_grow_amount;
     int    outline_open_depth;
     int    check_gotos;
+    int    low_memory;
     int    enable_encrypt;
     struct pdf_enc_setting encrypt;
     struct pdf_dev_setting device;
@@ -33,8 +33,10 @@
 #include "dpxconf.h"
 #include "dpxfile.h"
 #include "dpxutil.h"
+#include "dpxcrypt.h"
 
 #include "pdfobj.h"
+#include "pdfparse.h"
 
 #include "agl.h"
 #include "pdfencoding.h"
@@ -46,6 +48,7 @@
 #include "truetype.h"
 
 #include "pkfont.h"
+#include "tfm.h"
 
 #include "type0.h"
 #include "tt_cmap.h"
@@ -424,6 +427,469 @@ try_load_ToUnicode_CMap (pdf_font *font)
   return  0;
 }
 
+/*
+ * Font subset cache
+ *
+ * Loading a simple font adds a few entries to the font dictionary and
+ * the font descriptor, e.g., Widths and the embedded font program, and
+ * drops unavailable glyphs from the used characters. With a cache
+ * directory given, they are saved in a file named after a digest of
+ * everything the loader depends on: the font file, the glyphs in use,
+ * the encoding, the TFM widths and the output options. A later run
+ * finding that file takes the entries from there instead of parsing and
+ * subsetting the font again.
+ *
+ * Type0 fonts are not cached.
+ */
+
+#define SUBSET_CACHE_PREFIX "dvipdfm-x.font."
+#define SUBSET_CACHE_HEADER "%DVIPDFMX-FONT-CACHE 1\n"
+
+static struct {
+  char *dir;
+  int   hits;
+  int   misses;
+  long  bytes; /* font data taken from the cache */
+} subset_cache = {
+  NULL, 0, 0, 0
+};
+
+void
+pdf_font_set_cache_dir (const char *dir)
+{
+  if (subset_cache.dir)
+    RELEASE(subset_cache.dir);
+  subset_cache.dir = NULL;
+  if (dir && dir[0]) {
+    subset_cache.dir = NEW(strlen(dir) + 1, char);
+    strcpy(subset_cache.dir, dir);
+  }
+}
+
+static char *
+subset_cache_filename (pdf_font *font)
+{
+  MD5_CONTEXT    md5;
+  unsigned char  digest[16];
+  unsigned char  buf[8192];
+  FILE          *fp = NULL;
+  size_t         len;
+  int            code, tfm_id;
+  char          *filename, *s;
+
+  switch (font->subtype) {
+  case PDF_FONT_FONTTYPE_TYPE1:
+    fp = DPXFOPEN(font->ident, DPX_RES_TYPE_T1FONT);
+    break;
+  case PDF_FONT_FONTTYPE_TYPE1C:
+    fp = DPXFOPEN(font->ident, DPX_RES_TYPE_OTFONT);
+    break;
+  case PDF_FONT_FONTTYPE_TRUETYPE:
+    fp = DPXFOPEN(font->ident, DPX_RES_TYPE_TTFONT);
+    if (!fp)
+      fp = DPXFOPEN(font->ident, DPX_RES_TYPE_DFONT);
+    break;
+  }
+  if (!fp)
+    return NULL;
+
+  MD5_init(&md5);
+  rewind(fp);
+  while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    MD5_write(&md5, buf, len);
+  DPXFCLOSE(fp);
+
+  len = sprintf((char *) buf, "%d %d %d %d %d %d %d",
+                font->subtype, font->flags, font->index,
+                pdf_get_version(), pdf_get_compression(),
+                font->encoding_id >= 0 &&
+                  pdf_encoding_is_predefined(font->encoding_id),
+                font->resource &&
+                  pdf_lookup_dict(font->resource, "ToUnicode") != NULL);
+  MD5_write(&md5, buf, len + 1);
+  if (font->fontname)
+    MD5_write(&md5, (unsigned char *) font->fontname,
+              strlen(font->fontname) + 1);
+  MD5_write(&md5, (unsigned char *) font->usedchars, 256);
+
+  if (font->encoding_id >= 0) {
+    char **enc_vec = pdf_encoding_get_encoding(font->encoding_id);
+
+    for (code = 0; code < 256; code++) {
+      if (enc_vec[code])
+        MD5_write(&md5, (unsigned char *) enc_vec[code],
+                  strlen(enc_vec[code]));
+      MD5_write(&md5, (const unsigned char *) "", 1);
+    }
+  }
+
+  tfm_id = tfm_open(font->map_name, 0);
+  if (tfm_id >= 0) {
+    for (code = 0; code < 256; code++) {
+      if (font->usedchars[code]) {
+        len = sprintf((char *) buf, "%d %d ",
+                      code, (int) tfm_get_fw_width(tfm_id, code));
+        MD5_write(&md5, buf, len);
+      }
+    }
+  }
+  MD5_final(digest, &md5);
+
+  filename = NEW(strlen(subset_cache.dir) + 1 +
+                 strlen(SUBSET_CACHE_PREFIX) + 2 * 16 + 1, char);
+  sprintf(filename, "%s/%s", subset_cache.dir, SUBSET_CACHE_PREFIX);
+  s = filename + strlen(filename);
+  for (code = 0; code < 16; code++) {
+    sprintf(s, "%02x", digest[code]);
+    s += 2;
+  }
+
+  return filename;
+}
+
+static int
+add_snapshot_entry (pdf_obj *key, pdf_obj *value, void *pdata)
+{
+  pdf_add_dict((pdf_obj *) pdata, pdf_link_obj(key), pdf_link_obj(value));
+
+  return 0;
+}
+
+static pdf_obj *
+dict_snapshot (pdf_obj *dict)
+{
+  pdf_obj *snapshot = pdf_new_dict();
+
+  if (dict)
+    pdf_foreach_dict(dict, add_snapshot_entry, snapshot);
+
+  return snapshot;
+}
+
+static int has_reference (pdf_obj *object);
+
+static int
+has_reference_in_dict (pdf_obj *key, pdf_obj *value, void *pdata)
+{
+  return has_reference(value);
+}
+
+static int
+has_reference (pdf_obj *object)
+{
+  int i;
+
+  switch (pdf_obj_typeof(object)) {
+  case PDF_INDIRECT:
+    return 1;
+  case PDF_ARRAY:
+    for (i = 0; i < pdf_array_length(object); i++) {
+      if (has_reference(pdf_get_array(object, i)))
+        return 1;
+    }
+    break;
+  case PDF_DICT:
+    return pdf_foreach_dict(object, has_reference_in_dict, NULL);
+  case PDF_STREAM:
+    return has_reference(pdf_stream_dict(object));
+  }
+
+  return 0;
+}
+
+struct subset_cache_entries
+{
+  pdf_obj *snapshot; /* entries before loading */
+  pdf_obj *entries;  /* new or changed entries */
+  pdf_obj *indirect; /* keys of entries referring to an object */
+};
+
+/* Collect the entries the loader has added or replaced. */
+static int
+add_changed_entry (pdf_obj *key, pdf_obj *value, void *pdata)
+{
+  struct subset_cache_entries *cd = pdata;
+
+  if (pdf_lookup_dict(cd->snapshot, pdf_name_value(key)) == value)
+    return 0;
+
+  if (PDF_OBJ_INDIRECTTYPE(value)) {
+    value = pdf_capture_lookup(value);
+    if (!value)
+      return -1; /* not created by the loader */
+    pdf_add_array(cd->indirect, pdf_link_obj(key));
+  }
+  if (has_reference(value))
+    return -1;
+  pdf_add_dict(cd->entries, pdf_link_obj(key), pdf_link_obj(value));
+
+  return 0;
+}
+
+static int
+write_cache_entry (pdf_obj *key, pdf_obj *value, void *pdata)
+{
+  FILE *fp = pdata;
+
+  pdf_print_obj(key, fp);
+  fputc(' ', fp);
+  if (PDF_OBJ_STREAMTYPE(value)) {
+    /* Store the stream data as it goes to the output file. */
+    pdf_compress_stream(value);
+    pdf_add_dict(pdf_stream_dict(value),
+                 pdf_new_name("Length"),
+                 pdf_new_number(pdf_stream_length(value)));
+    pdf_print_obj(pdf_stream_dict(value), fp);
+    fputs("\nstream\n", fp);
+    fwrite(pdf_stream_dataptr(value), 1, pdf_stream_length(value), fp);
+    fputs("\nendstream", fp);
+  } else {
+    pdf_print_obj(value, fp);
+  }
+  fputc('\n', fp);
+
+  return 0;
+}
+
+/* Returns 0 if all the changes made by the loader can be stored. */
+static int
+collect_changes (struct subset_cache_entries *cd,
+                 pdf_obj *dict, pdf_obj *snapshot)
+{
+  cd->snapshot = snapshot;
+  cd->entries  = pdf_new_dict();
+  cd->indirect = pdf_new_array();
+
+  return dict ? pdf_foreach_dict(dict, add_changed_entry, cd) : 0;
+}
+
+static void
+write_changes (FILE *fp, const char *name, struct subset_cache_entries *cd)
+{
+  fprintf(fp, "/%s <<\n", name);
+  pdf_foreach_dict(cd->entries, write_cache_entry, fp);
+  fprintf(fp, ">>\n/%sIndirect ", name);
+  pdf_print_obj(cd->indirect, fp);
+  fputc('\n', fp);
+}
+
+static void
+write_cache_file (pdf_font *font, const char *filename,
+                  struct subset_cache_entries *font_cd,
+                  struct subset_cache_entries *desc_cd)
+{
+  FILE    *fp;
+  char    *tmpname;
+  pdf_obj *tmp;
+  int      error;
+
+  /* Write to a file of our own first as other jobs may use the cache. */
+  tmpname = NEW(strlen(filename) + 32, char);
+  sprintf(tmpname, "%s.%d", filename, (int) getpid());
+  fp = fopen(tmpname, FOPEN_WBIN_MODE);
+  if (!fp) {
+    WARN("Could not write font cache file \"%s\".", tmpname);
+    RELEASE(tmpname);
+    return;
+  }
+
+  fputs(SUBSET_CACHE_HEADER, fp);
+  fputs("<<\n/Tag ", fp);
+  tmp = pdf_new_string(font->uniqueID, strlen(font->uniqueID));
+  pdf_print_obj(tmp, fp);
+  pdf_release_obj(tmp);
+  fputs("\n/UsedChars ", fp);
+  tmp = pdf_new_string(font->usedchars, 256);
+  pdf_print_obj(tmp, fp);
+  pdf_release_obj(tmp);
+  fputc('\n', fp);
+  write_changes(fp, "Font", font_cd);
+  if (font->descriptor)
+    write_changes(fp, "Descriptor", desc_cd);
+  fputs(">>\n", fp);
+
+  error = ferror(fp);
+  if (fclose(fp) || error || rename(tmpname, filename)) {
+    WARN("Could not write font cache file \"%s\".", filename);
+    remove(tmpname);
+  }
+  RELEASE(tmpname);
+}
+
+/* Called after loading, while the objects created are still captured. */
+static void
+subset_cache_write (pdf_font *font, const char *filename,
+                    pdf_obj *resource, pdf_obj *descriptor)
+{
+  struct subset_cache_entries font_cd, desc_cd;
+  int    error;
+
+  error  = collect_changes(&font_cd, font->resource,   resource);
+  error |= collect_changes(&desc_cd, font->descriptor, descriptor);
+  if (!error && font->resource)
+    write_cache_file(font, filename, &font_cd, &desc_cd);
+
+  pdf_release_obj(font_cd.entries);
+  pdf_release_obj(font_cd.indirect);
+  pdf_release_obj(desc_cd.entries);
+  pdf_release_obj(desc_cd.indirect);
+}
+
+struct subset_cache_apply
+{
+  pdf_obj *dict;
+  pdf_obj *indirect;
+};
+
+static int
+apply_cache_entry (pdf_obj *key, pdf_obj *value, void *pdata)
+{
+  struct subset_cache_apply *cd = pdata;
+  int i;
+
+  for (i = 0; i < pdf_array_length(cd->indirect); i++) {
+    pdf_obj *name = pdf_get_array(cd->indirect, i);
+
+    if (PDF_OBJ_NAMETYPE(name) &&
+        !strcmp(pdf_name_value(name), pdf_name_value(key))) {
+      if (PDF_OBJ_STREAMTYPE(value))
+        subset_cache.bytes += pdf_stream_length(value);
+      pdf_add_dict(cd->dict, pdf_link_obj(key), pdf_ref_obj(value));
+      return 0;
+    }
+  }
+  pdf_add_dict(cd->dict, pdf_link_obj(key), pdf_link_obj(value));
+
+  return 0;
+}
+
+static int
+apply_cache_dict (pdf_obj *cache, const char *name, pdf_obj *dict)
+{
+  struct subset_cache_apply cd;
+  char                      key[32];
+
+  sprintf(key, "%sIndirect", name);
+  cd.dict     = dict;
+  cd.indirect = pdf_lookup_dict(cache, key);
+
+  return pdf_foreach_dict(pdf_lookup_dict(cache, name),
+                          apply_cache_entry, &cd);
+}
+
+static int
+subset_cache_read (pdf_font *font, const char *filename)
+{
+  FILE       *fp;
+  char       *buf;
+  const char *p, *endptr;
+  long        size;
+  pdf_obj    *cache, *tag, *usedchars, *tmp;
+  int         valid;
+
+  fp = fopen(filename, FOPEN_RBIN_MODE);
+  if (!fp)
+    return -1;
+  fseek(fp, 0L, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  if (size <= (long) strlen(SUBSET_CACHE_HEADER)) {
+    fclose(fp);
+    return -1;
+  }
+  buf = NEW(size, char);
+  if (fread(buf, 1, size, fp) != (size_t) size ||
+      memcmp(buf, SUBSET_CACHE_HEADER, strlen(SUBSET_CACHE_HEADER))) {
+    RELEASE(buf);
+    fclose(fp);
+    return -1;
+  }
+  fclose(fp);
+
+  p      = buf + strlen(SUBSET_CACHE_HEADER);
+  endptr = buf + size;
+  cache  = parse_pdf_object(&p, endptr, NULL);
+  RELEASE(buf);
+
+  valid = PDF_OBJ_DICTTYPE(cache) &&
+          !pdf_lookup_dict(cache, "Uncacheable");
+  if (valid) {
+    tag       = pdf_lookup_dict(cache, "Tag");
+    usedchars = pdf_lookup_dict(cache, "UsedChars");
+    valid     = PDF_OBJ_STRINGTYPE(tag) && pdf_string_length(tag) < 7 &&
+                PDF_OBJ_STRINGTYPE(usedchars) &&
+                pdf_string_length(usedchars) == 256 &&
+                PDF_OBJ_DICTTYPE(pdf_lookup_dict(cache, "Font")) &&
+                PDF_OBJ_ARRAYTYPE(pdf_lookup_dict(cache, "FontIndirect"));
+  }
+  if (valid && (tmp = pdf_lookup_dict(cache, "Descriptor")) != NULL) {
+    valid = PDF_OBJ_DICTTYPE(tmp) &&
+            PDF_OBJ_ARRAYTYPE(pdf_lookup_dict(cache, "DescriptorIndirect"));
+  }
+  if (!valid) {
+    WARN("Ignoring invalid font cache file \"%s\".", filename);
+    if (cache)
+      pdf_release_obj(cache);
+    return -1;
+  }
+
+  if (pdf_string_length(tag) > 0) {
+    /* Draw a tag anyway such that the following fonts get the same
+     * tags as without the cache.
+     */
+    pdf_font_get_uniqueTag(font);
+    memset(font->uniqueID, 0, 7);
+    memcpy(font->uniqueID, pdf_string_value(tag), pdf_string_length(tag));
+  }
+  memcpy(font->usedchars, pdf_string_value(usedchars), 256);
+
+  apply_cache_dict(cache, "Font", pdf_font_get_resource(font));
+  if (pdf_lookup_dict(cache, "Descriptor"))
+    apply_cache_dict(cache, "Descriptor", pdf_font_get_descriptor(font));
+  pdf_release_obj(cache);
+
+  return 0;
+}
+
+/* Load a simple font through the subset cache if there is one. */
+static int
+load_simple_font (pdf_font *font, int (*loader) (pdf_font *font))
+{
+  char    *filename;
+  pdf_obj *resource, *descriptor;
+  int      error;
+
+  if (!subset_cache.dir ||
+      !pdf_font_is_in_use(font) || !font->usedchars)
+    return loader(font);
+
+  filename = subset_cache_filename(font);
+  if (!filename)
+    return loader(font);
+
+  if (subset_cache_read(font, filename) == 0) {
+    if (dpx_conf.verbose_level > 1)
+      MESG("[cached]");
+    subset_cache.hits++;
+    RELEASE(filename);
+    return 0;
+  }
+  subset_cache.misses++;
+
+  resource   = dict_snapshot(font->resource);
+  descriptor = dict_snapshot(font->descriptor);
+  pdf_capture_begin();
+  error = loader(font);
+  if (!error)
+    subset_cache_write(font, filename, resource, descriptor);
+  pdf_capture_end();
+  pdf_release_obj(resource);
+  pdf_release_obj(descriptor);
+  RELEASE(filename);
+
+  return error;
+}
+
 void
 pdf_close_fonts (void)
 {
@@ -465,17 +931,17 @@ pdf_close_fonts (void)
       if (dpx_conf.verbose_level > 0)
 	      MESG("[Type1]");
       if (!pdf_font_get_flag(font, PDF_FONT_FLAG_BASEFONT))
-	      pdf_font_load_type1(font);
+	      load_simple_font(font, pdf_font_load_type1);
       break;
     case PDF_FONT_FONTTYPE_TYPE1C:
       if (dpx_conf.verbose_level > 0)
 	      MESG("[Type1C]");
-      pdf_font_load_type1c(font);
+      load_simple_font(font, pdf_font_load_type1c);
       break;
     case PDF_FONT_FONTTYPE_TRUETYPE:
       if (dpx_conf.verbose_level > 0)
 	      MESG("[TrueType]");
-      pdf_font_load_truetype(font);
+      load_simple_font(font, pdf_font_load_truetype);
       break;
     case PDF_FONT_FONTTYPE_TYPE3:
       if (dpx_conf.verbose_level > 0)
@@ -500,6 +966,11 @@ pdf_close_fonts (void)
 
   pdf_encoding_complete();
 
+  if (subset_cache.dir && dpx_conf.verbose_level > 0) {
+    MESG("\nFont subset cache: %d hits, %d misses, %ld bytes of font data reused\n",
+         subset_cache.hits, subset_cache.misses, subset_cache.bytes);
+  }
+
   for (font_id = 0; font_id < font_cache.count; font_id++) {
     pdf_font *font = GET_FONT(font_id);
 
@@ -35,6 +35,7 @@
 #define PDF_FONT_FONTTYPE_TYPE0    4
 
 extern void pdf_font_set_dpi (int font_dpi);
+extern void pdf_font_set_cache_dir (const char *dir);
 
 #define PDF_FONT_FLAG_NOEMBED   (1 << 0)
 #define PDF_FONT_FLAG_COMPOSITE (1 << 1)
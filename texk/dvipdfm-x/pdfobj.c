@@ -43,6 +43,10 @@
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif /* HAVE_PTHREAD */
+
 #include "pdfobj.h"
 #include "pdfdev.h"
 
@@ -107,13 +111,26 @@ struct pdf_array
   struct pdf_obj **values;
 };
 
+struct dict_entry
+{
+  struct pdf_obj    *key;
+  struct pdf_obj    *value;
+  unsigned int       hash;      /* hash value of the key name */
+  struct dict_entry *next;      /* next entry in order of insertion */
+  struct dict_entry *hash_next; /* next entry in the same hash bucket */
+};
+
 struct pdf_dict
 {
-  struct pdf_obj  *key;
-  struct pdf_obj  *value;
-  struct pdf_dict *next;
+  struct dict_entry  *first;
+  struct dict_entry  *last;
+  unsigned int        size;
+  unsigned int        hash_size; /* zero as long as there is no hash table */
+  struct dict_entry **hash;
 };
 
+#define DICT_HASH_MIN 16
+
 /* DecodeParms for FlateDecode */
  struct decode_parms {
   int     predictor;
@@ -122,6 +139,17 @@ struct pdf_dict
   int32_t columns;
  };
 
+/* Compression of a stream by a worker thread */
+struct stream_job
+{
+  unsigned char     *data;       /* filtered data, then compressed data */
+  unsigned int       length;
+  unsigned int       raw_length; /* length before compression */
+  int                overhead;   /* length of added filter entries */
+  int                status;     /* 0: pending, 1: done, <0: error   */
+  struct stream_job *next;       /* next job waiting for a worker */
+};
+
 /* 2015/12/27 Added support for predictor functions
  *
  * There are yet no way to specify the use of predictor functions.
@@ -142,6 +170,7 @@ struct pdf_stream
   unsigned int        max_length;
   int32_t             _flags;
   struct decode_parms decodeparms;
+  struct stream_job  *job;            /* used for deferred output */
 };
 
 struct pdf_indirect
@@ -251,6 +280,16 @@ static void release_dict (pdf_dict *dict);
 static void write_stream   (pdf_stream *stream, FILE *file);
 static void release_stream (pdf_stream *stream);
 
+#ifdef HAVE_PTHREAD
+static void pool_start (void);
+static void pool_stop  (void);
+#endif
+
+static int            pdf_defer_obj     (pdf_obj *object);
+static void           pdf_flush_deferred (int max_pending);
+static unsigned char *finish_stream_job (struct stream_job *job,
+                                         unsigned int *length);
+
 static char compression_level = 9;
 static char compression_use_predictor = 1;
 
@@ -274,6 +313,12 @@ pdf_set_compression (int level)
   return;
 }
 
+int
+pdf_get_compression (void)
+{
+  return compression_level;
+}
+
 FILE *
 pdf_get_output_file (void)
 {
@@ -390,6 +435,10 @@ pdf_out_init (const char *filename,
   enc_mode = 0;
   doc_enc_mode = do_encryption;
   compression_use_predictor = enable_predictor;
+
+#ifdef HAVE_PTHREAD
+  pool_start();
+#endif
 }
 
 static void
@@ -496,6 +545,11 @@ pdf_out_flush (void)
       current_objstm =NULL;
     }
 
+#ifdef HAVE_PTHREAD
+    /* Write out all queued objects before the xref */
+    pool_stop();
+#endif
+
     /*
      * Label xref stream - we need the number of correct objects
      * for the xref stream dictionary (= trailer).
@@ -1411,21 +1465,22 @@ pdf_pop_array (pdf_obj *array)
 static void
 write_dict (pdf_dict *dict, FILE *file)
 {
+  struct dict_entry *entry;
+
 #if 0
   pdf_out (file, "<<\n", 3); /* dropping \n saves few kb. */
 #else
   pdf_out (file, "<<", 2);
 #endif
-  while (dict->key != NULL) {
-    pdf_write_obj(dict->key, file);
-    if (pdf_need_white(PDF_NAME, (dict->value)->type)) {
+  for (entry = dict->first; entry != NULL; entry = entry->next) {
+    pdf_write_obj(entry->key, file);
+    if (pdf_need_white(PDF_NAME, (entry->value)->type)) {
       pdf_out_white(file);
     }
-    pdf_write_obj(dict->value, file);
+    pdf_write_obj(entry->value, file);
 #if 0
     pdf_out_char (file, '\n'); /* removing this saves few kb. */
 #endif
-    dict = dict->next;
   }
   pdf_out (file, ">>", 2);
 }
@@ -1438,9 +1493,11 @@ pdf_new_dict (void)
 
   result = pdf_new_obj(PDF_DICT);
   data   = NEW(1, pdf_dict);
-  data->key    = NULL;
-  data->value  = NULL;
-  data->next   = NULL;
+  data->first     = NULL;
+  data->last      = NULL;
+  data->size      = 0;
+  data->hash_size = 0;
+  data->hash      = NULL;
   result->data = data;
 
   return result;
@@ -1449,26 +1506,83 @@ pdf_new_dict (void)
 static void
 release_dict (pdf_dict *data)
 {
-  pdf_dict *next;
+  struct dict_entry *entry, *next;
 
-  while (data != NULL && data->key != NULL) {
-    pdf_release_obj(data->key);
-    pdf_release_obj(data->value);
-    data->key   = NULL;
-    data->value = NULL;
-    next = data->next;
-    RELEASE(data);
-    data = next;
+  for (entry = data->first; entry != NULL; entry = next) {
+    pdf_release_obj(entry->key);
+    pdf_release_obj(entry->value);
+    next = entry->next;
+    RELEASE(entry);
   }
+  if (data->hash)
+    RELEASE(data->hash);
   RELEASE(data);
 }
 
-/* Array is ended by a node with NULL this pointer */
+/*
+ * Small dictionaries are searched linearly. Once a dictionary holds
+ * DICT_HASH_MIN entries, its entries are also chained into a hash
+ * table on their key names, which grows along with the dictionary.
+ */
+static unsigned int
+dict_hash (const char *name)
+{
+  unsigned int h = 0;
+
+  if (name) {
+    while (*name)
+      h = 31 * h + (unsigned char) *name++;
+  }
+
+  return h;
+}
+
+static void
+dict_rehash (pdf_dict *data, unsigned int hash_size)
+{
+  struct dict_entry *entry;
+
+  if (data->hash)
+    RELEASE(data->hash);
+  data->hash_size = hash_size;
+  data->hash      = NEW(hash_size, struct dict_entry *);
+  memset(data->hash, 0, hash_size * sizeof(struct dict_entry *));
+  for (entry = data->first; entry != NULL; entry = entry->next) {
+    unsigned int i = entry->hash & (hash_size - 1);
+
+    entry->hash_next = data->hash[i];
+    data->hash[i]    = entry;
+  }
+}
+
+static struct dict_entry *
+dict_find (pdf_dict *data, const char *name, unsigned int hash)
+{
+  struct dict_entry *entry;
+
+  if (data->hash) {
+    entry = data->hash[hash & (data->hash_size - 1)];
+    for (; entry != NULL; entry = entry->hash_next) {
+      if (entry->hash == hash && !strcmp(name, pdf_name_value(entry->key)))
+        return entry;
+    }
+  } else {
+    for (entry = data->first; entry != NULL; entry = entry->next) {
+      if (!strcmp(name, pdf_name_value(entry->key)))
+        return entry;
+    }
+  }
+
+  return NULL;
+}
+
 /* pdf_add_dict returns 0 if the key is new and non-zero otherwise */
 int
 pdf_add_dict (pdf_obj *dict, pdf_obj *key, pdf_obj *value)
 {
-  pdf_dict *data, *new_node;
+  pdf_dict          *data;
+  struct dict_entry *entry;
+  unsigned int       hash;
 
   TYPECHECK(dict, PDF_DICT);
   TYPECHECK(key,  PDF_NAME);
@@ -1477,28 +1591,45 @@ pdf_add_dict (pdf_obj *dict, pdf_obj *key, pdf_obj *value)
   if (value != NULL && INVALIDOBJ(value))
     ERROR("pdf_add_dict(): Passed invalid value");
 
+  data = dict->data;
+  hash = dict_hash(pdf_name_value(key));
+
   /* If this key already exists, simply replace the value */
-  for (data = dict->data; data->key != NULL; data = data->next) {
-    if (!strcmp(pdf_name_value(key), pdf_name_value(data->key))) {
-      /* Release the old value */
-      pdf_release_obj(data->value);
-      /* Release the new key (we don't need it) */
-      pdf_release_obj(key);
-      data->value = value;
-      return 1;
-    }
+  entry = dict_find(data, pdf_name_value(key), hash);
+  if (entry) {
+    /* Release the old value */
+    pdf_release_obj(entry->value);
+    /* Release the new key (we don't need it) */
+    pdf_release_obj(key);
+    entry->value = value;
+    return 1;
   }
   /*
-   * We didn't find the key. We build a new "end" node and add
-   * the new key just before the end
+   * We didn't find the key. We add it at the end, such that the
+   * dictionary is written in the order the keys were added.
    */
-  new_node = NEW (1, pdf_dict);
-  new_node->key = NULL;
-  new_node->value = NULL;
-  new_node->next = NULL;
-  data->next  = new_node;
-  data->key   = key;
-  data->value = value;
+  entry = NEW(1, struct dict_entry);
+  entry->key       = key;
+  entry->value     = value;
+  entry->hash      = hash;
+  entry->next      = NULL;
+  entry->hash_next = NULL;
+  if (data->last)
+    data->last->next = entry;
+  else
+    data->first = entry;
+  data->last = entry;
+  data->size++;
+
+  if (data->hash && data->size <= data->hash_size) {
+    unsigned int i = hash & (data->hash_size - 1);
+
+    entry->hash_next = data->hash[i];
+    data->hash[i]    = entry;
+  } else if (data->size >= DICT_HASH_MIN) {
+    dict_rehash(data, data->hash ? 2 * data->hash_size : 2 * DICT_HASH_MIN);
+  }
+
   return 0;
 }
 
@@ -1506,8 +1637,6 @@ pdf_add_dict (pdf_obj *dict, pdf_obj *key, pdf_obj *value)
 void
 pdf_put_dict (pdf_obj *dict, const char *key, pdf_obj *value)
 {
-  pdf_dict *data;
-
   TYPECHECK(dict, PDF_DICT);
 
   if (!key) {
@@ -1518,32 +1647,7 @@ pdf_put_dict (pdf_obj *dict, const char *key, pdf_obj *value)
     ERROR("pdf_add_dict(): Passed invalid value.");
   }
 
-  data = dict->data;
-
-  while (data->key != NULL) {
-    if (!strcmp(key, pdf_name_value(data->key))) {
-      pdf_release_obj(data->value);
-      data->value = value;
-      break;
-    }
-    data = data->next;
-  }
-
-  /*
-   * If we didn't find the key, build a new "end" node and add
-   * the new key just before the end
-   */
-  if (data->key == NULL) {
-    pdf_dict *new_node;
-
-    new_node = NEW (1, pdf_dict);
-    new_node->key   = NULL;
-    new_node->value = NULL;
-    new_node->next  = NULL;
-    data->next  = new_node;
-    data->key   = pdf_new_name(key);
-    data->value = value;
-  }
+  pdf_add_dict(dict, pdf_new_name(key), value);
 }
 #endif
 
@@ -1551,15 +1655,15 @@ pdf_put_dict (pdf_obj *dict, const char *key, pdf_obj *value)
 void
 pdf_merge_dict (pdf_obj *dict1, pdf_obj *dict2)
 {
-  pdf_dict *data;
+  struct dict_entry *entry;
 
   TYPECHECK(dict1, PDF_DICT);
   TYPECHECK(dict2, PDF_DICT);
 
-  data = dict2->data;
-  while (data->key != NULL) {
-    pdf_add_dict(dict1, pdf_link_obj(data->key), pdf_link_obj(data->value));
-    data = data->next;
+  entry = ((pdf_dict *) dict2->data)->first;
+  while (entry != NULL) {
+    pdf_add_dict(dict1, pdf_link_obj(entry->key), pdf_link_obj(entry->value));
+    entry = entry->next;
   }
 }
 
@@ -1567,18 +1671,18 @@ int
 pdf_foreach_dict (pdf_obj *dict,
 		  int (*proc) (pdf_obj *, pdf_obj *, void *), void *pdata)
 {
-  int       error = 0;
-  pdf_dict *data;
+  int                error = 0;
+  struct dict_entry *entry;
 
   ASSERT(proc);
 
   TYPECHECK(dict, PDF_DICT);
 
-  data = dict->data;
+  entry = ((pdf_dict *) dict->data)->first;
   while (!error &&
-	 data->key != NULL) {
-    error = proc(data->key, data->value, pdata);
-    data = data->next;
+	 entry != NULL) {
+    error = proc(entry->key, entry->value, pdata);
+    entry = entry->next;
   }
 
   return error;
@@ -1588,39 +1692,33 @@ pdf_foreach_dict (pdf_obj *dict,
 pdf_obj *
 pdf_lookup_dict (pdf_obj *dict, const char *name)
 {
-  pdf_dict *data;
+  struct dict_entry *entry;
 
   ASSERT(name);
 
   TYPECHECK(dict, PDF_DICT);
 
-  data = dict->data;
-  while (data->key != NULL) {
-    if (!strcmp(name, pdf_name_value(data->key))) {
-      return data->value;
-    }
-    data = data->next;
-  }
+  entry = dict_find(dict->data, name, dict_hash(name));
 
-  return NULL;
+  return entry ? entry->value : NULL;
 }
 
 /* Returns array of dictionary keys */
 pdf_obj *
 pdf_dict_keys (pdf_obj *dict)
 {
-  pdf_obj  *keys;
-  pdf_dict *data;
+  pdf_obj           *keys;
+  struct dict_entry *entry;
 
   TYPECHECK(dict, PDF_DICT);
 
   keys = pdf_new_array();
-  for (data = dict->data; (data &&
-			   data->key != NULL); data = data->next) {
+  for (entry = ((pdf_dict *) dict->data)->first;
+       entry != NULL; entry = entry->next) {
     /* We duplicate name object rather than linking keys.
      * If we forget to free keys, broken PDF is generated.
      */
-    pdf_add_array(keys, pdf_new_name(pdf_name_value(data->key)));
+    pdf_add_array(keys, pdf_new_name(pdf_name_value(entry->key)));
   }
 
   return keys;
@@ -1629,23 +1727,38 @@ pdf_dict_keys (pdf_obj *dict)
 void
 pdf_remove_dict (pdf_obj *dict, const char *name)
 {
-  pdf_dict *data, **data_p;
+  pdf_dict          *data;
+  struct dict_entry *entry, *prev, **entry_p;
 
   TYPECHECK(dict, PDF_DICT);
 
-  data   = dict->data;
-  data_p = (pdf_dict **) (void *) &(dict->data);
-  while (data->key != NULL) {
-    if (pdf_match_name(data->key, name)) {
-      pdf_release_obj(data->key);
-      pdf_release_obj(data->value);
-      *data_p = data->next;
-      RELEASE(data);
+  data = dict->data;
+  prev = NULL;
+  for (entry = data->first; entry != NULL; entry = entry->next) {
+    if (pdf_match_name(entry->key, name))
       break;
-    }
-    data_p = &(data->next);
-    data   = data->next;
+    prev = entry;
   }
+  if (!entry)
+    return;
+
+  if (prev)
+    prev->next = entry->next;
+  else
+    data->first = entry->next;
+  if (data->last == entry)
+    data->last = prev;
+  if (data->hash) {
+    entry_p = &data->hash[entry->hash & (data->hash_size - 1)];
+    while (*entry_p != entry)
+      entry_p = &(*entry_p)->hash_next;
+    *entry_p = entry->hash_next;
+  }
+  data->size--;
+
+  pdf_release_obj(entry->key);
+  pdf_release_obj(entry->value);
+  RELEASE(entry);
 }
 
 pdf_obj *
@@ -1667,6 +1780,7 @@ pdf_new_stream (int flags)
   data->stream_length = 0;
   data->max_length    = 0;
   data->objstm_data = NULL;
+  data->job         = NULL;
 
   data->decodeparms.predictor = 2;
   data->decodeparms.columns   = 0;
@@ -1965,17 +2079,17 @@ filter_create_predictor_dict (int predictor, int32_t columns,
   return  parms;
 }
 
-static void
-write_stream (pdf_stream *stream, FILE *file)
+/*
+ * Apply the predictor filter if requested and enter FlateDecode in the
+ * stream dictionary, leaving the compression itself to deflate_stream().
+ * Returns 1 if the data in "*data" is to be compressed.
+ */
+static int
+filter_stream (pdf_stream *stream,
+               unsigned char **data, unsigned int *length, int *overhead)
 {
   unsigned char *filtered;
   unsigned int   filtered_length;
-#ifdef HAVE_ZLIB
-  uLong          buffer_length;
-#else
-  unsigned int   buffer_length;
-#endif
-  unsigned char *buffer;
 
   /*
    * Always work from a copy of the stream. All filters read from
@@ -1988,6 +2102,10 @@ write_stream (pdf_stream *stream, FILE *file)
   memcpy(filtered, stream->stream, stream->stream_length);
   filtered_length = stream->stream_length;
 
+  *data     = filtered;
+  *length   = filtered_length;
+  *overhead = 0;
+
   /* PDF/A requires Metadata to be not filtered. */
   {
     pdf_obj *type;
@@ -2050,9 +2168,8 @@ write_stream (pdf_stream *stream, FILE *file)
     }
 
     filters = pdf_lookup_dict(stream->dict, "Filter");
+    *overhead = filters ? strlen("/FlateDecode ") : strlen("/Filter/FlateDecode\n");
 
-    buffer_length = filtered_length + filtered_length/1000 + 14;
-    buffer = NEW(buffer_length, unsigned char);
     {
       pdf_obj *filter_name = pdf_new_name("FlateDecode");
 
@@ -2069,26 +2186,83 @@ write_stream (pdf_stream *stream, FILE *file)
          */
         pdf_add_dict(stream->dict, pdf_new_name("Filter"), filter_name);
     }
+
+    *data   = filtered;
+    *length = filtered_length;
+    return 1;
+  }
+#endif /* HAVE_ZLIB */
+
+  return 0;
+}
+
+/*
+ * Compress the data filtered by filter_stream(). This must not call
+ * ERROR() nor touch any PDF object since it may run in a worker thread,
+ * hence malloc() instead of NEW().
+ * Returns -1 on zlib error and -2 if out of memory, leaving the data
+ * unchanged; the main thread reports it with deflate_error().
+ */
+static int
+deflate_stream (unsigned char **data, unsigned int *length)
+{
+#ifdef HAVE_ZLIB
+  uLong          buffer_length;
+  unsigned char *buffer;
+  int            error;
+
+  buffer_length = *length + *length/1000 + 14;
+  buffer = malloc(buffer_length);
+  if (!buffer)
+    return -2;
 #ifdef HAVE_ZLIB_COMPRESS2    
-    if (compress2(buffer, &buffer_length, filtered,
-		  filtered_length, compression_level)) {
-      ERROR("Zlib error");
-    }
+  error = compress2(buffer, &buffer_length, *data, *length, compression_level);
 #else 
-    if (compress(buffer, &buffer_length, filtered,
-		 filtered_length)) {
-      ERROR ("Zlib error");
-    }
+  error = compress(buffer, &buffer_length, *data, *length);
 #endif /* HAVE_ZLIB_COMPRESS2 */
-    RELEASE(filtered);
-    compression_saved += filtered_length - buffer_length
-      - (filters ? strlen("/FlateDecode "): strlen("/Filter/FlateDecode\n"));
-
-    filtered        = buffer;
-    filtered_length = buffer_length;
+  if (error) {
+    RELEASE(buffer);
+    return -1;
   }
+  RELEASE(*data);
+  *data   = buffer;
+  *length = buffer_length;
 #endif /* HAVE_ZLIB */
 
+  return 0;
+}
+
+static void
+deflate_error (int status)
+{
+  if (status == -2)
+    ERROR("Out of memory while compressing a stream.");
+  ERROR("Zlib error");
+}
+
+static void
+write_stream (pdf_stream *stream, FILE *file)
+{
+  unsigned char *filtered;
+  unsigned int   filtered_length;
+
+  if (stream->job) {
+    /* Compressed by a worker thread */
+    filtered        = finish_stream_job(stream->job, &filtered_length);
+    stream->job     = NULL;
+  } else {
+    int overhead;
+
+    if (filter_stream(stream, &filtered, &filtered_length, &overhead)) {
+      unsigned int raw_length = filtered_length;
+      int          status     = deflate_stream(&filtered, &filtered_length);
+
+      if (status < 0)
+        deflate_error(status);
+      compression_saved += raw_length - filtered_length - overhead;
+    }
+  }
+
   /* AES will change the size of data! */
   if (enc_mode) {
     unsigned char *cipher = NULL;
@@ -2134,6 +2308,42 @@ write_stream (pdf_stream *stream, FILE *file)
   pdf_out(file, "endstream", 9);
 }
 
+/*
+ * Replace the data of the stream with the data write_stream() would
+ * output, except for encryption, and enter the filters in its dictionary.
+ * The stream will be written as it is afterwards.
+ */
+void
+pdf_compress_stream (pdf_obj *stream)
+{
+  pdf_stream    *data;
+  unsigned char *filtered;
+  unsigned int   filtered_length;
+  int            overhead;
+
+  TYPECHECK(stream, PDF_STREAM);
+
+  data = stream->data;
+  if (!filter_stream(data, &filtered, &filtered_length, &overhead)) {
+    RELEASE(filtered);
+    return;
+  }
+  {
+    unsigned int raw_length = filtered_length;
+    int          status     = deflate_stream(&filtered, &filtered_length);
+
+    if (status < 0)
+      deflate_error(status);
+    compression_saved += raw_length - filtered_length - overhead;
+  }
+
+  RELEASE(data->stream);
+  data->stream        = filtered;
+  data->stream_length = filtered_length;
+  data->max_length    = filtered_length;
+  data->_flags       &= ~(STREAM_COMPRESS|STREAM_USE_PREDICTOR);
+}
+
 static void
 release_stream (pdf_stream *stream)
 {
@@ -2925,6 +3135,374 @@ pdf_flush_obj (pdf_obj *object, FILE *file)
   pdf_out(file, "\nendobj\n", 8);
 }
 
+/*
+ * Write a direct object to a file other than the output file,
+ * e.g., a cache file. Nothing is encrypted.
+ */
+void
+pdf_print_obj (pdf_obj *object, FILE *file)
+{
+  int saved_enc_mode = enc_mode;
+
+  ASSERT(file != pdf_output_file);
+
+  enc_mode = 0;
+  pdf_write_obj(object, file);
+  enc_mode = saved_enc_mode;
+}
+
+/*
+ * Concurrent compression of streams
+ *
+ * With more than one thread, streams are compressed by a pool of worker
+ * threads. A stream released for output gets its filters applied right
+ * away, its data is handed over to the workers, and a copy of its
+ * dictionary waits in a queue until the compressed data is available.
+ * Objects released in the meantime are copied and queued as well, and
+ * the queue is written in the order the objects were released. Objects
+ * thus get the same labels, offsets and contents as without threads.
+ */
+
+#define STREAM_JOB_MIN_LENGTH 1024 /* don't bother with short streams */
+#define MAX_PENDING_PER_THREAD   8 /* bound memory held by queued objects */
+
+#ifdef HAVE_PTHREAD
+struct pending_obj
+{
+  pdf_obj            *object;
+  struct pending_obj *next;
+};
+
+static int compression_threads = 1;
+
+static struct
+{
+  int                 running; /* number of worker threads */
+  pthread_t          *workers;
+  pthread_mutex_t     lock;
+  pthread_cond_t      todo_cond;
+  pthread_cond_t      done_cond;
+  struct stream_job  *todo, *todo_last;
+  int                 quit;
+  struct pending_obj *first, *last; /* objects waiting for output */
+  int                 pending;
+} pool;
+
+static void *
+pool_worker (void *arg)
+{
+  struct stream_job *job;
+  int                status;
+
+  pthread_mutex_lock(&pool.lock);
+  for (;;) {
+    while (!pool.todo && !pool.quit)
+      pthread_cond_wait(&pool.todo_cond, &pool.lock);
+    if (!pool.todo)
+      break;
+    job = pool.todo;
+    pool.todo = job->next;
+    if (!pool.todo)
+      pool.todo_last = NULL;
+    pthread_mutex_unlock(&pool.lock);
+
+    status = deflate_stream(&job->data, &job->length);
+    if (status == 0)
+      status = 1;
+
+    pthread_mutex_lock(&pool.lock);
+    job->status = status;
+    pthread_cond_broadcast(&pool.done_cond);
+  }
+  pthread_mutex_unlock(&pool.lock);
+
+  return NULL;
+}
+
+static void
+pool_start (void)
+{
+  int i;
+
+  pool.running = 0;
+  pool.todo    = pool.todo_last = NULL;
+  pool.first   = pool.last = NULL;
+  pool.pending = 0;
+  pool.quit    = 0;
+  if (compression_threads < 2 || compression_level == 0)
+    return;
+
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.todo_cond, NULL);
+  pthread_cond_init(&pool.done_cond, NULL);
+  pool.workers = NEW(compression_threads, pthread_t);
+  for (i = 0; i < compression_threads; i++) {
+    if (pthread_create(&pool.workers[i], NULL, pool_worker, NULL) != 0)
+      break;
+    pool.running++;
+  }
+  if (pool.running == 0) {
+    WARN("Could not start threads for stream compression.");
+    RELEASE(pool.workers);
+    pool.workers = NULL;
+  } else if (dpx_conf.verbose_level > 0) {
+    MESG("(compressing streams in %d threads)", pool.running);
+  }
+}
+
+static void
+pool_stop (void)
+{
+  int i;
+
+  if (pool.running == 0)
+    return;
+
+  pdf_flush_deferred(0);
+
+  pthread_mutex_lock(&pool.lock);
+  pool.quit = 1;
+  pthread_cond_broadcast(&pool.todo_cond);
+  pthread_mutex_unlock(&pool.lock);
+  for (i = 0; i < pool.running; i++)
+    pthread_join(pool.workers[i], NULL);
+  RELEASE(pool.workers);
+  pool.workers = NULL;
+  pool.running = 0;
+
+  pthread_cond_destroy(&pool.done_cond);
+  pthread_cond_destroy(&pool.todo_cond);
+  pthread_mutex_destroy(&pool.lock);
+}
+
+static int
+stream_job_done (struct stream_job *job)
+{
+  int status;
+
+  pthread_mutex_lock(&pool.lock);
+  status = job->status;
+  pthread_mutex_unlock(&pool.lock);
+
+  return status != 0;
+}
+#endif /* HAVE_PTHREAD */
+
+void
+pdf_set_compression_threads (int threads)
+{
+#ifdef HAVE_PTHREAD
+  if (threads == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (threads < 1)
+      threads = 1;
+  }
+  if (threads < 0)
+    ERROR("Invalid number of threads: %d", threads);
+  compression_threads = threads;
+#else
+  if (threads != 1)
+    WARN("No thread support compiled in, compressing streams serially.");
+#endif /* HAVE_PTHREAD */
+}
+
+/*
+ * Recursively copy a direct object, such that the copy does not change
+ * when objects shared with the original are changed later on.
+ */
+static pdf_obj *
+pdf_copy_direct (pdf_obj *object)
+{
+  pdf_obj *copy = NULL;
+
+  switch (pdf_obj_typeof(object)) {
+  case PDF_BOOLEAN:
+    copy = pdf_new_boolean(pdf_boolean_value(object));
+    break;
+  case PDF_NUMBER:
+    copy = pdf_new_number(pdf_number_value(object));
+    break;
+  case PDF_STRING:
+    if (pdf_string_length(object) > 0)
+      copy = pdf_new_string(pdf_string_value(object),
+                            pdf_string_length(object));
+    else
+      copy = pdf_new_string("", 0);
+    break;
+  case PDF_NAME:
+    {
+      const char *name = pdf_name_value(object);
+      copy = pdf_new_name(name ? name : "");
+    }
+    break;
+  case PDF_NULL:
+    copy = pdf_new_null();
+    break;
+  case PDF_ARRAY:
+    {
+      pdf_array   *data = object->data;
+      unsigned int i;
+
+      copy = pdf_new_array();
+      for (i = 0; i < data->size; i++)
+        pdf_add_array(copy, pdf_copy_direct(data->values[i]));
+    }
+    break;
+  case PDF_DICT:
+    {
+      struct dict_entry *entry = ((pdf_dict *) object->data)->first;
+
+      copy = pdf_new_dict();
+      for (; entry != NULL; entry = entry->next)
+        pdf_add_dict(copy, pdf_link_obj(entry->key),
+                     pdf_copy_direct(entry->value));
+    }
+    break;
+  case PDF_INDIRECT:
+    copy = pdf_new_obj(PDF_INDIRECT);
+    copy->data = NEW(1, pdf_indirect);
+    memcpy(copy->data, object->data, sizeof(pdf_indirect));
+    break;
+  default:
+    /* undefined objects are reported by pdf_write_obj() */
+    copy = pdf_link_obj(object);
+    break;
+  }
+
+  return copy;
+}
+
+/*
+ * Queue a labeled object released for output instead of writing it, if
+ * it is a stream to be compressed by the workers or if other objects are
+ * already waiting. Returns 1 if the object was queued.
+ */
+static int
+pdf_defer_obj (pdf_obj *object)
+{
+#ifdef HAVE_PTHREAD
+  struct pending_obj *entry;
+  pdf_obj            *copy;
+
+  if (pool.running == 0)
+    return 0;
+
+  if (object->type == PDF_STREAM) {
+    pdf_stream        *stream = object->data;
+    pdf_stream        *data;
+    struct stream_job *job;
+
+    if (!pool.first &&
+        (!(stream->_flags & STREAM_COMPRESS) ||
+         stream->stream_length < STREAM_JOB_MIN_LENGTH))
+      return 0;
+
+    job = NEW(1, struct stream_job);
+    job->next   = NULL;
+    job->status = 0;
+    if (filter_stream(stream, &job->data, &job->length, &job->overhead)) {
+      job->raw_length = job->length;
+      pthread_mutex_lock(&pool.lock);
+      if (pool.todo_last)
+        pool.todo_last->next = job;
+      else
+        pool.todo = job;
+      pool.todo_last = job;
+      pthread_cond_signal(&pool.todo_cond);
+      pthread_mutex_unlock(&pool.lock);
+    } else {
+      job->raw_length = 0;
+      job->status     = 1;
+    }
+
+    copy = pdf_new_stream(stream->_flags);
+    data = copy->data;
+    pdf_release_obj(data->dict);
+    data->dict = pdf_copy_direct(stream->dict);
+    data->job  = job;
+  } else if (!pool.first) {
+    return 0;
+  } else {
+    copy = pdf_copy_direct(object);
+  }
+  copy->label      = object->label;
+  copy->generation = object->generation;
+  copy->flags      = object->flags;
+
+  entry = NEW(1, struct pending_obj);
+  entry->object = copy;
+  entry->next   = NULL;
+  if (pool.last)
+    pool.last->next = entry;
+  else
+    pool.first = entry;
+  pool.last = entry;
+  pool.pending++;
+
+  pdf_flush_deferred(MAX_PENDING_PER_THREAD * pool.running);
+
+  return 1;
+#else
+  return 0;
+#endif /* HAVE_PTHREAD */
+}
+
+/*
+ * Write queued objects as long as their data is ready, and further
+ * while more than max_pending objects are waiting.
+ */
+static void
+pdf_flush_deferred (int max_pending)
+{
+#ifdef HAVE_PTHREAD
+  while (pool.first) {
+    struct pending_obj *entry  = pool.first;
+    pdf_obj            *object = entry->object;
+
+    if (pool.pending <= max_pending && object->type == PDF_STREAM &&
+        !stream_job_done(((pdf_stream *) object->data)->job))
+      break;
+
+    pool.first = entry->next;
+    if (!pool.first)
+      pool.last = NULL;
+    pool.pending--;
+    RELEASE(entry);
+
+    pdf_flush_obj(object, pdf_output_file);
+    /* Written now, so don't let pdf_release_obj() write it again. */
+    object->label = 0;
+    pdf_release_obj(object);
+  }
+#endif /* HAVE_PTHREAD */
+}
+
+/* Wait for a job and return its data */
+static unsigned char *
+finish_stream_job (struct stream_job *job, unsigned int *length)
+{
+  unsigned char *data;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&pool.lock);
+  while (job->status == 0)
+    pthread_cond_wait(&pool.done_cond, &pool.lock);
+  pthread_mutex_unlock(&pool.lock);
+#endif /* HAVE_PTHREAD */
+  if (job->status < 0)
+    deflate_error(job->status);
+  if (job->raw_length > 0)
+    compression_saved += job->raw_length - job->length - job->overhead;
+
+  data    = job->data;
+  *length = job->length;
+  RELEASE(job);
+
+  return data;
+}
+
 static int
 pdf_add_objstm (pdf_obj *objstm, pdf_obj *object)
 {
@@ -2986,6 +3564,70 @@ release_objstm (pdf_obj *objstm)
   pdf_release_obj(objstm);
 }
 
+/*
+ * Labeled objects created after pdf_capture_begin() are not written out
+ * when released but kept until pdf_capture_end(), such that a caller can
+ * still read the objects it only holds references to. The font cache
+ * uses this to store the objects created by a font loader.
+ */
+static struct
+{
+  int       active;
+  unsigned  first_label;
+  int       count, max;
+  pdf_obj **objects;
+} capture = {
+  0, 0, 0, 0, NULL
+};
+
+void
+pdf_capture_begin (void)
+{
+  ASSERT(!capture.active);
+
+  capture.active      = 1;
+  capture.first_label = next_label;
+  capture.count       = 0;
+}
+
+pdf_obj *
+pdf_capture_lookup (pdf_obj *ref)
+{
+  pdf_indirect *data;
+  int           i;
+
+  if (!PDF_OBJ_INDIRECTTYPE(ref))
+    return NULL;
+
+  data = ref->data;
+  if (data->pf)
+    return NULL;
+
+  for (i = 0; i < capture.count; i++) {
+    if (capture.objects[i]->label      == data->label &&
+        capture.objects[i]->generation == data->generation)
+      return capture.objects[i];
+  }
+
+  return NULL;
+}
+
+void
+pdf_capture_end (void)
+{
+  int i;
+
+  ASSERT(capture.active);
+
+  capture.active = 0;
+  /* Output them in the order they were released. */
+  for (i = 0; i < capture.count; i++)
+    pdf_release_obj(capture.objects[i]);
+  RELEASE(capture.objects);
+  capture.objects = NULL;
+  capture.count   = capture.max = 0;
+}
+
 void
 pdf_release_obj (pdf_obj *object)
 {
@@ -2997,6 +3639,16 @@ pdf_release_obj (pdf_obj *object)
     pdf_write_obj(object, stderr);
     ERROR("pdf_release_obj:  Called with invalid object.");
   }
+  if (capture.active && object->refcount == 1 &&
+      object->label >= capture.first_label && pdf_output_file != NULL) {
+    /* Keep the last reference until pdf_capture_end(). */
+    if (capture.count >= capture.max) {
+      capture.max    += 16;
+      capture.objects = RENEW(capture.objects, capture.max, pdf_obj *);
+    }
+    capture.objects[capture.count++] = object;
+    return;
+  }
   object->refcount -= 1;
   if (object->refcount == 0) {
 #if defined(PDFOBJ_DEBUG)
@@ -3009,9 +3661,10 @@ pdf_release_obj (pdf_obj *object)
     if (object->label && pdf_output_file != NULL) {
       if (!do_objstm || object->flags & OBJ_NO_OBJSTM
 	  || (doc_enc_mode && object->flags & OBJ_NO_ENCRYPT)
-	  || object->generation)
-	pdf_flush_obj(object, pdf_output_file);
-      else {
+	  || object->generation) {
+        if (!pdf_defer_obj(object))
+          pdf_flush_obj(object, pdf_output_file);
+      } else {
         if (!current_objstm) {
 	  int *data = NEW(2*OBJSTM_MAX_OBJS+2, int);
 	  data[0] = data[1] = 0;
@@ -3443,6 +4096,20 @@ pdf_new_ref (pdf_obj *object)
   return result;
 }
 
+/*
+ * Keep only the label of the object REF refers to, for an object that
+ * has been written out and released while REF is still in use.
+ * Dereferencing REF is an error afterwards.
+ */
+void
+pdf_unlink_ref (pdf_obj *ref)
+{
+  TYPECHECK(ref, PDF_INDIRECT);
+
+  ASSERT(!OBJ_FILE(ref));
+  OBJ_OBJ(ref) = NULL;
+}
+
 /* pdf_deref_obj always returns a link instead of the original   */
 /* It never return the null object, but the NULL pointer instead */
 pdf_obj *
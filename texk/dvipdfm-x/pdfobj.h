@@ -82,6 +82,7 @@ extern int      pdf_obj_typeof  (pdf_obj *object);
 
 extern pdf_obj *pdf_ref_obj        (pdf_obj *object);
 extern pdf_obj *pdf_link_obj       (pdf_obj *object);
+extern void     pdf_unlink_ref     (pdf_obj *ref);
 
 extern void     pdf_transfer_label (pdf_obj *dst, pdf_obj *src);
 extern pdf_obj *pdf_new_undefined  (void);
@@ -163,15 +164,26 @@ extern const void *pdf_stream_dataptr    (pdf_obj *stream);
 extern void        pdf_stream_set_predictor (pdf_obj *stream,
                                              int predictor, int32_t columns,
                                              int bpc, int colors);
+extern void        pdf_compress_stream   (pdf_obj *stream);
 
 /* Compare label of two indirect reference object.
  */
 extern int         pdf_compare_reference (pdf_obj *ref1, pdf_obj *ref2);
 
+/* Keep objects created in between alive for inspection, see pdfobj.c.
+ */
+extern void        pdf_capture_begin     (void);
+extern pdf_obj    *pdf_capture_lookup    (pdf_obj *ref);
+extern void        pdf_capture_end       (void);
+
+extern void        pdf_print_obj         (pdf_obj *object, FILE *file);
+
 /* The following routines are not appropriate for pdfobj.
  */
 
 extern void      pdf_set_compression (int level);
+extern int       pdf_get_compression (void);
+extern void      pdf_set_compression_threads (int threads);
 
 extern void      pdf_set_info     (pdf_obj *obj);
 extern void      pdf_set_root     (pdf_obj *obj);
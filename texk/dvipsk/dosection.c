@@ -6,12 +6,358 @@
  *   The external declarations:
  */
 #include "protos.h"
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+#if defined(HAVE_FORK) && defined(HAVE_WAITPID) && defined(HAVE_SYS_WAIT_H)
+#define PAGEWORKERS
+#endif
 
 static int psfont;
 #ifdef HPS
 int pagecounter;
 #endif
 
+/*
+ *   Progress reports:  "[n" when page n is begun, a dot for each
+ *   further copy of it, and "] " when it is done.
+ */
+static void
+pagestart(void)
+{
+/*
+ *   We want to take the base 10 log of the number.  It's probably
+ *   small, so we do it quick.
+ */
+   if (! quiet) {
+      int t = pagenum, i = 0;
+      if (t < 0) {
+         t = -t;
+         i++;
+      }
+      do {
+         i++;
+         t /= 10;
+      } while (t > 0);
+      if (pagecopies < 20)
+         i += pagecopies - 1;
+      if (i + prettycolumn > STDOUTSIZE) {
+         fprintf(stderr, "\n");
+         prettycolumn = 0;
+      }
+      prettycolumn += i + 1;
+#ifdef SHORTINT
+      fprintf(stderr, "[%ld", pagenum);
+#else  /* ~SHORTINT */
+      fprintf(stderr, "[%d", pagenum);
+#endif /* ~SHORTINT */
+      fflush(stderr);
+   }
+}
+
+static void
+pagecopy(void)
+{
+   if (prettycolumn + 1 > STDOUTSIZE) {
+      fprintf(stderr, "\n");
+      prettycolumn = 0;
+   }
+   fprintf(stderr, ".");
+   fflush(stderr);
+   prettycolumn++;
+}
+
+static void
+pagedone(void)
+{
+   if (! quiet) {
+      fprintf(stderr, "] ");
+      fflush(stderr);
+      prettycolumn += 2;
+   }
+}
+
+#ifdef PAGEWORKERS
+/*
+ *   With -J, the pages of a section are split into consecutive runs.
+ *   All runs but the first are rendered by child processes, each
+ *   into its own temporary file, while we render the first run
+ *   ourselves; then the runs are copied to the output in order.
+ *
+ *   A child starts from the state the section started with, not
+ *   from the state the previous run ended in (see struct pagestate).
+ *   So its output is only used if the two agree on everything the
+ *   run depended on; otherwise we render the run again ourselves.
+ *   Either way the output is the same as without -J.
+ */
+struct pageloc {
+   integer loc;       /* where the page starts, after its bop parameters */
+   integer num;       /* its TeX page number */
+};
+
+struct pagerun {
+   int first, last;   /* the pages of the run */
+   pid_t pid;         /* the child rendering it, if any */
+   FILE *f;           /* where the child writes to */
+   FILE *err;         /* where the child writes its messages to */
+   struct pagestate start;
+};
+
+/*
+ *   Find the pages of the section that we are to print, in the order
+ *   we are to print them, the same way the loop in dosection does.
+ */
+static int
+findpages(sectiontype *s, struct pageloc *pl)
+{
+   integer prevptr = s->bos;
+   int np = s->numpages;
+   int n = 0;
+
+   if (! reverse)
+      fseek(dvifile, (long)prevptr, 0);
+   while (np-- != 0) {
+      if (reverse)
+         fseek(dvifile, (long)prevptr, 0);
+      pagenum = signedquad();
+      if ((evenpages && (pagenum & 1)) || (oddpages && (pagenum & 1)==0) ||
+       (pagelist && !InPageList(pagenum))) {
+         if (reverse) {
+            skipover(36);
+            prevptr = signedquad()+1;
+         } else {
+            skipover(40);
+            skippage();
+            skipnop();
+         }
+         ++np;
+         continue;
+      }
+      skipover(36);
+      prevptr = signedquad()+1;
+      pl[n].loc = ftell(dvifile);
+      pl[n].num = pagenum;
+      n++;
+      if (! reverse) {
+         skippagebody();
+         skipnop();
+      }
+   }
+   return n;
+}
+
+/*
+ *   Render pages first up to last of pl.
+ */
+static void
+dorun(struct pageloc *pl, int first, int last, Boolean verbose)
+{
+   int i, k;
+
+   for (i=first; i<last; i++) {
+      pagenum = pl[i].num;
+      if (verbose)
+         pagestart();
+      for (k=0; k<pagecopies; k++) {
+         if (k > 0 && verbose)
+            pagecopy();
+         fseek(dvifile, (long)pl[i].loc, 0);
+         dopage();
+      }
+      if (verbose)
+         pagedone();
+   }
+}
+
+/*
+ *   The child side:  render the run into its file, followed by the
+ *   state at its end and the length of the PostScript, and quit.
+ *   The DVI file is opened anew, so that we don't move the file
+ *   position that the parent is reading at.  Messages go to a file
+ *   of their own, which the parent shows only if it uses the run;
+ *   otherwise it renders the run again and they are given anew.
+ *   We leave with _exit, also on fatal errors, so that nothing the
+ *   parent has buffered is flushed twice.
+ */
+static void
+runchild(struct pageloc *pl, struct pagerun *r)
+{
+   struct pagestate end;
+   long len;
+
+   pageworker = 1;
+   quiet = 1;
+   prettycolumn = 0;
+   if (dup2(fileno(r->err), 2) < 0)
+      _exit(1);
+   close(fileno(dvifile));
+   dvifile = fopen(iname, READBIN);
+   if (dvifile == NULL)
+      _exit(1);
+   setoutput(r->f);
+   setpagestate(&r->start);
+   dorun(pl, r->first, r->last, 0);
+   getpagestate(&end);
+   len = ftell(bitfile);
+   if (fwrite(&end, sizeof(end), 1, bitfile) != 1 ||
+       fwrite(&len, sizeof(len), 1, bitfile) != 1 ||
+       fflush(bitfile) == EOF || ferror(bitfile) || fflush(stderr) == EOF)
+      _exit(1);
+   _exit(0);
+}
+
+/*
+ *   Copy len bytes from the start of f to g.
+ */
+static void
+copyback(FILE *f, FILE *g, long len)
+{
+   char buf[BUFSIZ];
+
+   rewind(f);
+   while (len > 0) {
+      size_t n = fread(buf, 1, len < BUFSIZ ? (size_t)len : BUFSIZ, f);
+      if (n == 0)
+         error("! Problems reading back rendered pages.");
+      fwrite(buf, 1, n, g);
+      len -= n;
+   }
+}
+
+/*
+ *   The parent side:  wait for the child, and copy its output and
+ *   its messages if the state that the run started in is the one the
+ *   previous run ended in, as far as the run depends on it.  The run
+ *   may not leave a tpic path behind, since that is not part of the
+ *   state.  If the run reported errors in specials, it must have
+ *   started with the same count of errors still to be reported.
+ *   Returns 0 if the run has to be rendered again.
+ */
+static int
+runparent(struct pagerun *r)
+{
+   struct pagestate cur, end, *st = &r->start;
+   int status;
+   long len, errlen;
+
+   if (waitpid(r->pid, &status, 0) != r->pid ||
+       !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      return 0;
+   if (fseek(r->f, -(long)(sizeof(end) + sizeof(len)), SEEK_END) != 0 ||
+       fread(&end, sizeof(end), 1, r->f) != 1 ||
+       fread(&len, sizeof(len), 1, r->f) != 1 ||
+       len != ftell(r->f) - (long)(sizeof(end) + sizeof(len)))
+      return 0;
+   getpagestate(&cur);
+   if (cur.thispage != st->thispage ||
+       (cur.linepos != 0) != (st->linepos != 0) ||
+       cur.any_dir != st->any_dir || cur.jflag != st->jflag ||
+       cur.pathLen != 0 || end.pathLen != 0 ||
+       ((end.tpicused & TPIC_SHADING) && cur.shading != st->shading) ||
+       ((end.tpicused & TPIC_PENSIZE) && cur.penSize != st->penSize) ||
+       ((end.tpicused & TPIC_SHADETP) && cur.shadetp != st->shadetp) ||
+       (end.emposused && (cur.emx != st->emx || cur.emy != st->emy)) ||
+       (end.specialerrors != st->specialerrors &&
+        cur.specialerrors != st->specialerrors))
+      return 0;
+   copyback(r->f, bitfile, len);
+   if (fseek(r->err, 0L, SEEK_END) == 0 && (errlen = ftell(r->err)) > 0) {
+      if (prettycolumn > 0)
+         fprintf(stderr, "\n");
+      prettycolumn = 0;
+      fflush(stderr);
+      copyback(r->err, stderr, errlen);
+      fflush(stderr);
+   }
+   cur.thispage = end.thispage;
+   cur.linepos = end.linepos;
+   cur.any_dir = end.any_dir;
+   cur.jflag = end.jflag;
+   if (end.tpicset & TPIC_SHADING)
+      cur.shading = end.shading;
+   if (end.tpicset & TPIC_PENSIZE)
+      cur.penSize = end.penSize;
+   if (end.tpicset & TPIC_SHADETP)
+      cur.shadetp = end.shadetp;
+   if (end.emposset) {
+      cur.emx = end.emx;
+      cur.emy = end.emy;
+   }
+   if (end.specialerrors != st->specialerrors)
+      cur.specialerrors = end.specialerrors;
+   setpagestate(&cur);
+   return 1;
+}
+
+/*
+ *   Print one pass over the section with pageworkers processes.
+ *   Returns 0, having done nothing, if this cannot be done.
+ */
+static int
+dosectionruns(sectiontype *s)
+{
+   struct pageloc *pl;
+   struct pagerun *runs;
+   struct pagestate st;
+   int n, nruns, j, i, k;
+
+   if (pageworkers < 2 || s->numpages < 2 || *iname == 0)
+      return 0;
+#ifdef HPS
+   if (HPS_FLAG)
+      return 0;
+#endif
+   getpagestate(&st);
+   if (st.pathLen != 0)
+      return 0;
+   pl = (struct pageloc *)mymalloc((integer)(s->numpages * sizeof(*pl)));
+   n = findpages(s, pl);
+   nruns = (n < pageworkers ? n : pageworkers);
+   runs = (struct pagerun *)mymalloc((integer)(nruns * sizeof(*runs)));
+   fflush(bitfile);
+   for (j=0; j<nruns; j++) {
+      runs[j].first = j * n / nruns;
+      runs[j].last = (j + 1) * n / nruns;
+      runs[j].pid = -1;
+      runs[j].f = NULL;
+      runs[j].err = NULL;
+      runs[j].start = st;
+      runs[j].start.thispage = st.thispage + runs[j].first * pagecopies;
+      runs[j].start.tpicused = runs[j].start.tpicset = 0;
+      runs[j].start.emposused = runs[j].start.emposset = 0;
+      if (j == 0)
+         continue;
+      runs[j].start.linepos = 1;
+      if ((runs[j].f = tmpfile()) == NULL ||
+          (runs[j].err = tmpfile()) == NULL)
+         continue;
+      runs[j].pid = fork();
+      if (runs[j].pid == 0)
+         runchild(pl, &runs[j]);
+   }
+   dorun(pl, runs[0].first, runs[0].last, 1);
+   for (j=1; j<nruns; j++) {
+      if (runs[j].pid > 0 && runparent(&runs[j])) {
+         for (i=runs[j].first; i<runs[j].last; i++) {
+            pagenum = pl[i].num;
+            pagestart();
+            for (k=1; k<pagecopies; k++)
+               pagecopy();
+            pagedone();
+         }
+      } else
+         dorun(pl, runs[j].first, runs[j].last, 1);
+      if (runs[j].f)
+         fclose(runs[j].f);
+      if (runs[j].err)
+         fclose(runs[j].err);
+   }
+   free(runs);
+   free(pl);
+   return 1;
+}
+#endif /* PAGEWORKERS */
+
 /*
  *   Now we have the main procedure.
  */
@@ -72,6 +418,10 @@ dosection(sectiontype *s, int c)
       cu->fd->psflag = 0;
    while (c > 0) {
       c--;
+#ifdef PAGEWORKERS
+      if (dosectionruns(s))
+         continue;
+#endif
       prevptr = s->bos;
       if (! reverse)
          fseek(dvifile, (long)prevptr, 0);
@@ -93,34 +443,7 @@ dosection(sectiontype *s, int c)
 	    ++np;	/* this page wasn't counted for s->numpages */
 	    continue;
 	 }
-/*
- *   We want to take the base 10 log of the number.  It's probably
- *   small, so we do it quick.
- */
-         if (! quiet) {
-            int t = pagenum, i = 0;
-            if (t < 0) {
-               t = -t;
-               i++;
-            }
-            do {
-               i++;
-               t /= 10;
-            } while (t > 0);
-            if (pagecopies < 20)
-               i += pagecopies - 1;
-            if (i + prettycolumn > STDOUTSIZE) {
-               fprintf(stderr, "\n");
-               prettycolumn = 0;
-            }
-            prettycolumn += i + 1;
-#ifdef SHORTINT
-            fprintf(stderr, "[%ld", pagenum);
-#else  /* ~SHORTINT */
-            fprintf(stderr, "[%d", pagenum);
-#endif /* ~SHORTINT */
-            fflush(stderr);
-         }
+         pagestart();
          skipover(36);
          prevptr = signedquad()+1;
          for (k=0; k<pagecopies; k++) {
@@ -129,21 +452,11 @@ dosection(sectiontype *s, int c)
                   thispage = ftell(dvifile);
             } else {
                fseek(dvifile, (long)thispage, 0);
-               if (prettycolumn + 1 > STDOUTSIZE) {
-                  fprintf(stderr, "\n");
-                  prettycolumn = 0;
-               }
-               fprintf(stderr, ".");
-               fflush(stderr);
-               prettycolumn++;
+               pagecopy();
             }
             dopage();
          }
-         if (! quiet) {
-            fprintf(stderr, "] ");
-            fflush(stderr);
-            prettycolumn += 2;
-         }
+         pagedone();
          if (! reverse)
             skipnop();
       }
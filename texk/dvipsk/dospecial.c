@@ -48,6 +48,22 @@ specerror(const char *s)
    }
 }
 
+/*
+ *   How many more errors in specials are reported is part of the
+ *   state carried from page to page.
+ */
+void
+getspecialstate(struct pagestate *ps)
+{
+   ps->specialerrors = specialerrors;
+}
+
+void
+setspecialstate(struct pagestate *ps)
+{
+   specialerrors = ps->specialerrors;
+}
+
 static void
 outputstring(register char *p)
 {
@@ -145,6 +145,12 @@ static double zPixRound(double, double);             /* (x/y)PixRound(x,y) */
 static double  shadetp = 0.5;
              /* shading level, initialized as requested by tpic 2.0 -- MJ */
 
+/* which of shading, penSize and shadetp were read before being set, and
+   which were set, since the last settpicstate (see struct pagestate) */
+static int tpicused, tpicset;
+#define tpicread(b) (tpicused |= (b) & ~tpicset)
+#define tpicwrite(b) (tpicset |= (b))
+
 void
 setPenSize(char *cp)
 {
@@ -157,6 +163,7 @@ setPenSize(char *cp)
     }
 
   penSize = convPS(ps);
+  tpicwrite(TPIC_PENSIZE);
   doubleout((integer)penSize);
   cmdout("setlinewidth");
 }                               /* end setPenSize */
@@ -196,6 +203,7 @@ arc(char *cp, int invis)
 
 /* we need the newpath since STROKE doesnt do a newpath */
 
+  tpicread(TPIC_SHADING);
   if (shading) {
       /* first time for shading */
       cmdout(NEWPATH);
@@ -214,6 +222,7 @@ arc(char *cp, int invis)
 
       cmdout(FILL);
       shading = NONE;
+      tpicwrite(TPIC_SHADING);
       cmdout("0 setgray");	/* default of black */
   }
 
@@ -283,6 +292,7 @@ flushDashedPath(int dotted, double inchesPerDash)
       return;
     }
 
+  tpicread(TPIC_PENSIZE);
   cmdout(NEWPATH);		/* to save the current point */
   for (i=2; i <= pathLen; i++) {
       integer dx = hconvPS(xx[i-1]) - hconvPS(xx[i]);
@@ -367,6 +377,7 @@ flushPath(int invis)
 #endif  /* ~SHORTINT */
                     hh, vv, xx[1], yy[1], hconvPS(xx[1]), vconvPS(yy[1]));
 #endif /* DEBUG */
+  tpicread(TPIC_SHADING);
   if (shading) {
       /* first time for shading */
       cmdout(NEWPATH); /* to save the current point */
@@ -409,6 +420,7 @@ flushPath(int invis)
       }
       cmdout(FILL);
       shading = NONE;
+      tpicwrite(TPIC_SHADING);
       cmdout("0 setgray");	/* default of black */
   }
 
@@ -481,6 +493,7 @@ flushSpline(char *cp)
       if (ipd != 0) {
 	  cmdout("[");
 	  if (inchesPerDash < 0.0) /* dotted */ {
+	      tpicread(TPIC_PENSIZE);
 	      doubleout(penSize);
 	      doubleout(fabs(convPS((int)-ipd) - penSize));
 	  } else		/* dashed */
@@ -591,6 +604,7 @@ SetShade(register char *cp)
     }
     shadetp = 1.0 - ((double) blackbits / (double) totalbits);
     shading = GRAY;
+    tpicwrite(TPIC_SHADETP | TPIC_SHADING);
 }                               /* end of SetShade       */
 
 void
@@ -605,16 +619,20 @@ shadeLast(char *cp)
 	  error ("Illegal format for shade level");
       else if (tempShadetp < 0.0 || tempShadetp > 1.0)
 	  error ("Invalid shade level");
-      else
+      else {
 	  /* if "sh" has an argument we can safely assume that tpic 2.0 is used
 	     so that all subsequent "sh" commands will come with an explicit
 	     argument.  Hence we may overwrite shadetp's old value */
 	  /* Also note the inversion of gray levels for tpic 2.0 (0 = white,
 	     1 = black) w.r.t. PostScript (0 = black, 1 = white) */
 	  shadetp = 1.0 - tempShadetp;
+	  tpicwrite(TPIC_SHADETP);
+      }
   }
 
+  tpicread(TPIC_SHADETP);
   shading = GRAY;
+  tpicwrite(TPIC_SHADING);
   snprintf(tpout, sizeof(tpout), "%1.3f setgray", shadetp); 
     /* priol@irisa.fr, MJ */
   cmdout(tpout);
@@ -624,6 +642,7 @@ void
 whitenLast(void)
 {
   shading = WHITE;
+  tpicwrite(TPIC_SHADING);
   cmdout("1 setgray");
 }                               /* end of whitenLast */
 
@@ -631,6 +650,7 @@ void
 blackenLast(void)
 {
   shading = BLACK;
+  tpicwrite(TPIC_SHADING);
   cmdout("0 setgray");          /* actually this aint needed */
 }                               /* end of whitenLast */
 
@@ -650,6 +670,32 @@ doShading(void)
 }                               !* end of doShading *!
 #endif
 
+/*
+ *   The tpic part of the state carried from page to page.  The path
+ *   itself is not saved; pathLen tells whether there is one.
+ */
+void
+gettpicstate(struct pagestate *ps)
+{
+  ps->pathLen = pathLen;
+  ps->shading = shading;
+  ps->penSize = penSize;
+  ps->shadetp = shadetp;
+  ps->tpicused = tpicused;
+  ps->tpicset = tpicset;
+}
+
+void
+settpicstate(struct pagestate *ps)
+{
+  pathLen = ps->pathLen;
+  shading = ps->shading;
+  penSize = ps->penSize;
+  shadetp = ps->shadetp;
+  tpicused = ps->tpicused;
+  tpicset = ps->tpicset;
+}
+
 /*
  *   We need to calculate (x * convDPI * mag) / (tpicResolution * 1000)
  *   So we use doubleing point.  (This should have a very small impact
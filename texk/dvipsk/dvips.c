@@ -106,6 +106,8 @@ int secure_option = 0;        /* set by -R */
 int collatedcopies = 1;      /* how many collated copies? */
 int sectioncopies = 1;       /* how many times to repeat each section? */
 integer pagecopies = 1;      /* how many times to repeat each page? */
+int pageworkers = 1;         /* how many processes render the pages? */
+Boolean pageworker = 0;      /* are we one of those processes? */
 shalfword linepos = 0;       /* where are we on the line being output? */
 integer maxpages;            /* the maximum number of pages */
 Boolean notfirst, notlast;   /* true if a first page was specified */
@@ -295,7 +297,7 @@ static const char *helparr[] = {
 #endif
 "-h f Add header file",
 "-i*  Separate file per section",
-"-j*  Download fonts partially",
+"-j*  Download fonts partially        -J # Render pages in # processes",
 "-k*  Print crop marks                -K*  Pull comments from inclusions",
 "-l # Last page                       -L*  Last special papersize wins",
 "-m*  Manual feed                     -M*  Don't make fonts",
@@ -377,6 +379,10 @@ error_with_perror(const char *s, const char *fname)
       if (bitfile != NULL) {
          cleanprinter();
       }
+#ifdef HAVE_FORK
+      if (pageworker)
+         _exit(1); /* leave the parent's buffers and handlers alone */
+#endif
       exit(1); /* fatal */
    }
 }
@@ -833,6 +839,14 @@ case 'i':
 case 'j':
                partialdownload = (*p != '0');
                break;
+case 'J':
+               if (*p == 0 && argv[i+1])
+                  p = argv[++i];
+               if (sscanf(p, "%d", &pageworkers)==0)
+                  error("! Bad number of page processes option (-J).");
+               if (pageworkers < 1 || pageworkers > 64)
+                  error("! can only render pages with one to 64 processes");
+               break;
 case 'k':
                cropmarks = (*p != '0');
                break;
@@ -1115,7 +1129,7 @@ default:
                               "'. Try --help for more information."));
 #else
                error(
-     "! Bad option, not one of acdefhijklmnopqrstxyzABCDEFKMNOPSTUXYZ?");
+     "! Bad option, not one of acdefhijklmnopqrstxyzABCDEFJKMNOPSTUXYZ?");
 #endif
             }
          } else {
@@ -243,6 +243,29 @@ typedef struct t {
  *    Since we can't declare this or take a sizeof it, we build it and
  *   manipulate it ourselves (see the end of the prescan routine).
  */
+/*
+ *   The output state that is carried over from one page to the next.
+ *   When pages are rendered in separate processes (option -J), each
+ *   process reports the state at the end of its pages, so they can
+ *   be put back together in order (see dosection.c).  The tpicused
+ *   and tpicset bits tell which of the tpic values were read before
+ *   being set, and which were set, while rendering those pages;
+ *   emposused and emposset do the same for the em: current point.
+ */
+struct pagestate {
+   int thispage;            /* number of pages output so far */
+   shalfword linepos;       /* where are we on the line being output? */
+   Boolean any_dir, jflag;
+   integer pathLen, shading, penSize;
+   double shadetp;
+   int tpicused, tpicset;
+   integer emx, emy;        /* the em: current point */
+   Boolean emposused, emposset;
+   int specialerrors;       /* errors in specials still to be reported */
+};
+#define TPIC_SHADING (1)
+#define TPIC_PENSIZE (2)
+#define TPIC_SHADETP (4)
 /*
  *   This is how we build up headers and other lists.
  */
@@ -41,6 +41,9 @@ struct empt {
 static struct empt **empoints = NULL;
 boolean emused = FALSE;  /* true if em points used on this page */
 integer emx, emy;
+/* whether emx and emy were read before being set, and were set,
+   since the last setemstate (see struct pagestate) */
+static Boolean emposused, emposset;
 
 struct emunit {
    const char *unit;
@@ -176,6 +179,7 @@ char *emp;
 #endif
            emx = hh;
            emy = vv;
+           emposset = TRUE;
         }
         else if (strncmp(emp, "lineto", 6) == 0) {
 #ifdef DEBUG
@@ -186,6 +190,8 @@ char *emp;
       fprintf(stderr, "em special: lineto %d,%d\n", hh, vv);
 #endif
 #endif
+	   if (!emposset)
+	      emposused = TRUE;
 	   cmdout("np");
 	   numout(emx);
 	   numout(emy);
@@ -196,6 +202,7 @@ char *emp;
 	   cmdout("st");
            emx = hh;
            emy = vv;
+           emposset = TRUE;
         }
 	else if (strncmp(emp, "point", 5) == 0) {
            if (empoints == NULL) {
@@ -1459,6 +1466,28 @@ emgraph(char *filename, float emwidth, float emheight)
 	    close_file(f);
 }
 
+/*
+ *   The em: part of the state carried from page to page.  The em
+ *   points are not part of it, since they are cleared on every page.
+ */
+void
+getemstate(struct pagestate *ps)
+{
+   ps->emx = emx;
+   ps->emy = emy;
+   ps->emposused = emposused;
+   ps->emposset = emposset;
+}
+
+void
+setemstate(struct pagestate *ps)
+{
+   emx = ps->emx;
+   emy = ps->emy;
+   emposused = ps->emposused;
+   emposset = ps->emposset;
+}
+
 #else
 void
 emspecial(char *p)
@@ -1466,4 +1495,16 @@ emspecial(char *p)
 	sprintf(errbuf,"emTeX specials not compiled in this version");
 	specerror(errbuf);
 }
+
+void
+getemstate(struct pagestate *ps)
+{
+   ps->emx = ps->emy = 0;
+   ps->emposused = ps->emposset = FALSE;
+}
+
+void
+setemstate(struct pagestate *ps)
+{
+}
 #endif /* EMTEX */
@@ -1602,6 +1602,16 @@ cleanprinter(void)
       fclose(bitfile);
    bitfile = NULL;
 }
+/*
+ *   Send the output to f, a plain file rather than a pipe, so that
+ *   cleanprinter closes it with fclose (used by page workers).
+ */
+void
+setoutput(FILE *f)
+{
+   bitfile = f;
+   popened = 0;
+}
 
 /* this tells dvips that it has no clue where it is. */
 static int thispage = 0;
@@ -1611,6 +1621,36 @@ psflush(void) {
    rulex = ruley = rhh = rvv = -314159265;
    lastfont = -1;
 }
+/*
+ *   Get and set the state carried from page to page, so that pages
+ *   can be output by separate processes (see dosection.c).
+ */
+void
+getpagestate(struct pagestate *ps)
+{
+   ps->thispage = thispage;
+   ps->linepos = linepos;
+   ps->any_dir = any_dir;
+   ps->jflag = jflag;
+#ifdef TPIC
+   gettpicstate(ps);
+#endif
+   getemstate(ps);
+   getspecialstate(ps);
+}
+void
+setpagestate(struct pagestate *ps)
+{
+   thispage = ps->thispage;
+   linepos = ps->linepos;
+   any_dir = ps->any_dir;
+   jflag = ps->jflag;
+#ifdef TPIC
+   settpicstate(ps);
+#endif
+   setemstate(ps);
+   setspecialstate(ps);
+}
 /*
  *   pageinit initializes the output variables.
  */
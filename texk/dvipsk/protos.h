@@ -32,6 +32,8 @@ extern int ParsePages(char *s);
 
 /* prototypes for functions from dospecial.c */
 extern void specerror(const char *s);
+extern void getspecialstate(struct pagestate *ps);
+extern void setspecialstate(struct pagestate *ps);
 extern void outbangspecials(void);
 extern void predospecial(int numbytes, Boolean scanning);
 extern void dospecial(int numbytes);
@@ -58,6 +60,8 @@ extern void SetShade(char *cp);
 extern void shadeLast(char *cp);
 extern void whitenLast(void);
 extern void blackenLast(void);
+extern void gettpicstate(struct pagestate *ps);
+extern void settpicstate(struct pagestate *ps);
 #endif /* TPIC */
 
 /* prototypes for functions from dviinput.c */
@@ -83,6 +87,8 @@ extern void *revlist(void *p);
 /* prototypes for functions from emspecial.c */
 extern void emclear(void);
 extern void emspecial(char *p);
+extern void getemstate(struct pagestate *ps);
+extern void setemstate(struct pagestate *ps);
 
 /* prototypes for functions from finclude.c */
 extern void scanfontcomments(const char *filename);
@@ -150,7 +156,10 @@ extern void nlcmdout(const char *s);
 extern void initprinter(sectiontype *sect);
 extern void setup(void);
 extern void cleanprinter(void);
+extern void setoutput(FILE *f);
 extern void psflush(void);
+extern void getpagestate(struct pagestate *ps);
+extern void setpagestate(struct pagestate *ps);
 extern void pageinit(void);
 extern void pageend(void);
 extern void drawrule(int rw, int rh);
@@ -204,6 +213,7 @@ extern int close_file(FILE *f);
 
 /* prototypes for functions from skippage.c */
 extern void skippage(void);
+extern void skippagebody(void);
 
 /* prototypes for functions from t1part.c */
 extern void *getmem(unsigned int size);
@@ -264,6 +274,8 @@ extern int secure;
 extern int secure_option;
 extern int collatedcopies;
 extern integer pagecopies;
+extern int pageworkers;
+extern Boolean pageworker;
 extern shalfword linepos;
 extern integer maxpages;
 extern Boolean notfirst, notlast;
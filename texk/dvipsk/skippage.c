@@ -11,24 +11,15 @@
 #include "protos.h"
 
 /*
- *   And now the big routine.
+ *   And now the big routine.  If prescan is 0, specials and font
+ *   definitions are skipped too rather than processed.
  */
-void
-skippage(void)
+static void
+skipcommands(Boolean prescan)
 {
    register shalfword cmd;
    register integer i;
 
-#ifdef DEBUG
-   if (dd(D_PAGE))
-#ifdef SHORTINT
-   fprintf(stderr,"Skipping page %ld\n", pagenum);
-#else   /* ~SHORTINT */
-   fprintf(stderr,"Skipping page %d\n", pagenum);
-#endif  /* ~SHORTINT */
-#endif  /* DEBUG */
-/* skipover(40); skip rest of bop command? how did this get in here? */
-   bopcolor(0);
    while ((cmd=dvibyte())!=140) {
      switch (cmd) {
 case 255: /* pTeX's dir or undefined */
@@ -66,15 +57,54 @@ case 143: case 148: case 153: case 157: case 162: case 167: case 235:
    cmd = dvibyte();
    break;
 /* specials */
-case 239: i = dvibyte(); predospecial(i, 0); break;
-case 240: i = twobytes(); predospecial(i, 0); break;
-case 241: i = threebytes(); predospecial(i, 0); break;
-case 242: i = signedquad(); predospecial(i, 0); break;
-/* font definition */
+case 239: i = dvibyte(); goto special;
+case 240: i = twobytes(); goto special;
+case 241: i = threebytes(); goto special;
+case 242: i = signedquad();
+special:
+   if (prescan)
+      predospecial(i, 0);
+   else
+      skipover(i);
+   break;
+/* font definition:  k[cmd-242], c[4], s[4], d[4], a[1], l[1], n[a+l] */
 case 243: case 244: case 245: case 246:
-   fontdef(cmd - 242);
+   if (prescan)
+      fontdef(cmd - 242);
+   else {
+      skipover(cmd - 230);
+      i = dvibyte();
+      i += dvibyte();
+      skipover(i);
+   }
    break;
 default:;
       }
    }
 }
+
+void
+skippage(void)
+{
+#ifdef DEBUG
+   if (dd(D_PAGE))
+#ifdef SHORTINT
+   fprintf(stderr,"Skipping page %ld\n", pagenum);
+#else   /* ~SHORTINT */
+   fprintf(stderr,"Skipping page %d\n", pagenum);
+#endif  /* ~SHORTINT */
+#endif  /* DEBUG */
+/* skipover(40); skip rest of bop command? how did this get in here? */
+   bopcolor(0);
+   skipcommands(1);
+}
+
+/*
+ *   Skip over the rest of a page that has been prescanned already,
+ *   without processing its specials or font definitions again.
+ */
+void
+skippagebody(void)
+{
+   skipcommands(0);
+}
@@ -0,0 +1,60 @@
+/*************************************************************************
+** BoundedCache.hpp                                                     **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#ifndef BOUNDEDCACHE_HPP
+#define BOUNDEDCACHE_HPP
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/** Keeps recently computed values identified by string keys. The size of the cache is
+ *  measured by the sum of the sizes of its values. If a new value would exceed the maximal
+ *  size, all entries are dropped in order to keep memory consumption low.
+ *  @tparam V type of the values; must provide a member function size()
+ *  @tparam MAX_SIZE maximal total size of the values kept in the cache */
+template <typename V, size_t MAX_SIZE=100000>
+class BoundedCache {
+	public:
+		/** Returns a pointer to the value stored for a given key or nullptr if there is none. */
+		const V* find (const std::string &key) const {
+			auto it = _valueMap.find(key);
+			return it != _valueMap.end() ? &it->second : nullptr;
+		}
+
+		/** Adds a value to the cache. If the cache would get too big, it's cleared first. */
+		void insert (const std::string &key, V &&value) {
+			if (_size + value.size() > MAX_SIZE) {
+				_valueMap.clear();
+				_size = 0;
+			}
+			_size += value.size();
+			_valueMap.emplace(key, std::move(value));
+		}
+
+		/** Returns the total size of the values currently kept in the cache. */
+		size_t size () const {return _size;}
+
+	private:
+		std::unordered_map<std::string, V> _valueMap;
+		size_t _size=0;
+};
+
+#endif
@@ -38,10 +38,12 @@ class CommandLine : public CL::CommandLine {
 		Option exactOpt {"exact", 'e', "compute exact glyph boxes"};
 		TypedOption<std::string, Option::ArgMode::REQUIRED> fontFormatOpt {"font-format", 'f', "format", "svg", "select file format of embedded fonts"};
 		TypedOption<std::string, Option::ArgMode::REQUIRED> fontmapOpt {"fontmap", 'm', "filenames", "evaluate (additional) font map files"};
+		TypedOption<double, Option::ArgMode::OPTIONAL> gradAdaptiveOpt {"grad-adaptive", '\0', "tolerance", 0.05, "adapt number of color gradient segments to color changes"};
 		Option gradOverlapOpt {"grad-overlap", '\0', "create overlapping color gradient segments"};
 		TypedOption<int, Option::ArgMode::REQUIRED> gradSegmentsOpt {"grad-segments", '\0', "number", 20, "number of color gradient segments per row"};
 		TypedOption<double, Option::ArgMode::REQUIRED> gradSimplifyOpt {"grad-simplify", '\0', "delta", 0.05, "reduce level of detail for small segments"};
 		TypedOption<int, Option::ArgMode::OPTIONAL> helpOpt {"help", 'h', "mode", 0, "print this summary of options and exit"};
+		TypedOption<unsigned, Option::ArgMode::REQUIRED> jobsOpt {"jobs", '\0', "number", 1, "convert pages in parallel using the given number of processes"};
 		Option keepOpt {"keep", '\0', "keep temporary files"};
 		TypedOption<std::string, Option::ArgMode::REQUIRED> libgsOpt {"libgs", '\0', "filename", "set name of Ghostscript shared library"};
 		TypedOption<std::string, Option::ArgMode::REQUIRED> linkmarkOpt {"linkmark", 'L', "style", "box", "select how to mark hyperlinked areas"};
@@ -58,6 +60,8 @@ class CommandLine : public CL::CommandLine {
 		Option pdfOpt {"pdf", 'P', "convert PDF file to SVG"};
 		TypedOption<int, Option::ArgMode::REQUIRED> precisionOpt {"precision", 'd', "number", 0, "set number of decimal points (0-6)"};
 		TypedOption<double, Option::ArgMode::OPTIONAL> progressOpt {"progress", '\0', "delay", 0.5, "enable progress indicator"};
+		Option psBatchOpt {"ps-batch", '\0', "execute consecutive PostScript specials together"};
+		Option psStatsOpt {"ps-stats", '\0', "report time spent in Ghostscript and callbacks"};
 		Option relativeOpt {"relative", 'R', "create relative path commands"};
 		TypedOption<double, Option::ArgMode::REQUIRED> rotateOpt {"rotate", 'r', "angle", "rotate page content clockwise"};
 		TypedOption<std::string, Option::ArgMode::REQUIRED> scaleOpt {"scale", 'c', "sx[,sy]", "scale page content"};
@@ -104,6 +108,9 @@ class CommandLine : public CL::CommandLine {
 #if !defined(DISABLE_WOFF)
 			{&fontFormatOpt, 1},
 #endif
+#if !defined(DISABLE_GS)
+			{&gradAdaptiveOpt, 1},
+#endif
 #if !defined(DISABLE_GS)
 			{&gradOverlapOpt, 1},
 #endif
@@ -130,6 +137,7 @@ class CommandLine : public CL::CommandLine {
 			{&zoomOpt, 2},
 			{&cacheOpt, 3},
 			{&exactOpt, 3},
+			{&jobsOpt, 3},
 			{&keepOpt, 3},
 #if !defined(HAVE_LIBGS) && !defined(DISABLE_GS)
 			{&libgsOpt, 3},
@@ -138,6 +146,12 @@ class CommandLine : public CL::CommandLine {
 			{&noMktexmfOpt, 3},
 			{&noSpecialsOpt, 3},
 			{&pageHashesOpt, 3},
+#if !defined(DISABLE_GS)
+			{&psBatchOpt, 3},
+#endif
+#if !defined(DISABLE_GS)
+			{&psStatsOpt, 3},
+#endif
 			{&traceAllOpt, 3},
 			{&colorOpt, 4},
 			{&helpOpt, 4},
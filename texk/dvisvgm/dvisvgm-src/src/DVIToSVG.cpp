@@ -19,11 +19,18 @@
 *************************************************************************/
 
 #include <config.h>
+#ifndef _WIN32
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
+#include <iostream>
 #include <set>
+#include <unordered_map>
 #include <sstream>
 #include "Calculator.hpp"
 #include "DVIToSVG.hpp"
@@ -41,6 +48,7 @@
 #include "SVGOutput.hpp"
 #include "utility.hpp"
 #include "version.hpp"
+#include "XMLString.hpp"
 #include "XXHashFunction.hpp"
 
 ///////////////////////////////////
@@ -71,6 +79,7 @@ using namespace std;
 char DVIToSVG::TRACE_MODE = 0;
 bool DVIToSVG::COMPUTE_PROGRESS = false;
 DVIToSVG::HashSettings DVIToSVG::PAGE_HASH_SETTINGS;
+unsigned DVIToSVG::JOBS = 1;
 
 
 DVIToSVG::DVIToSVG (istream &is, SVGOutputBase &out) : DVIReader(is), _out(out)
@@ -99,29 +108,32 @@ void DVIToSVG::convert (unsigned first, unsigned last, HashFunction *hashFunc) {
 		throw DVIException(oss.str());
 	}
 	last = min(last, numberOfPages());
-	bool computeHashes = (hashFunc && !_out.ignoresHashes());
-	string shortenedOptHash = XXH32HashFunction(PAGE_HASH_SETTINGS.optionsHash()).digestString();
 	for (unsigned i=first; i <= last; ++i) {
-		string dviHash, combinedHash;
-		if (computeHashes) {
-			computePageHash(i, *hashFunc);
-			dviHash = hashFunc->digestString();
-			hashFunc->update(PAGE_HASH_SETTINGS.optionsHash());
-			combinedHash = hashFunc->digestString();
-		}
-		const SVGOutput::HashTriple hashTriple(dviHash, shortenedOptHash, combinedHash);
+		const SVGOutput::HashTriple hashTriple = pageHashes(i, hashFunc);
 		string fname = _out.filename(i, numberOfPages(), hashTriple);
-		if (!dviHash.empty() && !PAGE_HASH_SETTINGS.isSet(HashSettings::P_REPLACE) && FileSystem::exists(fname)) {
+		if (skipPage(fname, hashTriple)) {
 			Message::mstream(false, Message::MC_PAGE_NUMBER) << "skipping page " << i;
 			Message::mstream().indent(1);
 			Message::mstream(false, Message::MC_PAGE_WRITTEN) << "\nfile " << fname << " exists\n";
 			Message::mstream().indent(0);
 		}
-		else {
+		else if (!reuseCachedPage(i, fname, hashTriple)) {
 			executePage(i);
 			_svg.removeRedundantElements();
 			embedFonts(_svg.rootNode());
-			bool success = _svg.write(_out.getPageStream(currentPageNumber(), numberOfPages(), hashTriple));
+			bool success;
+			auto actions = dynamic_cast<DVIToSVGActions*>(_actions.get());
+			if (_pageCache && !hashTriple.empty() && actions) {
+				// keep a copy of the SVG document in the page cache
+				ostringstream oss;
+				_svg.write(oss);
+				const string svg = oss.str();
+				success = bool(_out.getPageStream(currentPageNumber(), numberOfPages(), hashTriple) << svg);
+				if (!_pageCache->write(hashTriple.cmbHash(), actions->getPageCount(), svg, pageDependencies()))
+					Message::wstream(true) << "failed to write page " << i << " to the page cache\n";
+			}
+			else
+				success = _svg.write(_out.getPageStream(currentPageNumber(), numberOfPages(), hashTriple));
 			if (fname.empty())
 				fname = "<stdout>";
 			if (success)
@@ -135,6 +147,111 @@ void DVIToSVG::convert (unsigned first, unsigned last, HashFunction *hashFunc) {
 }
 
 
+/** Computes the hash values of a page used to create the name of the SVG file.
+ *  The values are kept so that each page is hashed only once.
+ *  @param[in] pageno number of page to compute the hashes for
+ *  @param[in] hashFunc pointer to function to be used to compute page hashes
+ *  @return the hash values (empty if hashes are not required) */
+SVGOutputBase::HashTriple DVIToSVG::pageHashes (unsigned pageno, HashFunction *hashFunc) {
+	auto it = _pageHashes.find(pageno);
+	if (it != _pageHashes.end())
+		return it->second;
+	string dviHash, combinedHash;
+	if (hashFunc && (!_out.ignoresHashes() || _pageCache)) {
+		computePageHash(pageno, *hashFunc);
+		dviHash = hashFunc->digestString();
+		hashFunc->update(PAGE_HASH_SETTINGS.optionsHash());
+		combinedHash = hashFunc->digestString();
+	}
+	string shortenedOptHash = XXH32HashFunction(PAGE_HASH_SETTINGS.optionsHash()).digestString();
+	SVGOutput::HashTriple hashTriple(dviHash, shortenedOptHash, combinedHash);
+	_pageHashes.emplace(pageno, hashTriple);
+	return hashTriple;
+}
+
+
+/** Returns true if the conversion of a page can be skipped because the SVG file
+ *  identified by the page hash already exists.
+ *  @param[in] fname name of the SVG file
+ *  @param[in] hashes hash values of the page */
+bool DVIToSVG::skipPage (const string &fname, const SVGOutputBase::HashTriple &hashes) const {
+	return !hashes.dviHash().empty() && !_out.ignoresHashes()
+		&& !PAGE_HASH_SETTINGS.isSet(HashSettings::P_REPLACE) && FileSystem::exists(fname);
+}
+
+
+/** Returns a string that identifies a font and the contents of its font file.
+ *  @param[in] font font to identify
+ *  @return "fontID fontname size filehash" */
+static string font_fingerprint (const Font *font) {
+	static unordered_map<string,string> fileHashes;  // font file path -> hash of file contents
+	string fileHash;
+	if (const char *path = font->path()) {
+		auto it = fileHashes.find(path);
+		if (it != fileHashes.end())
+			fileHash = it->second;
+		else {
+			ifstream ifs(path, ios::binary);
+			ostringstream oss;
+			oss << ifs.rdbuf();
+			fileHash = XXH64HashFunction(oss.str()).digestString();
+			fileHashes.emplace(path, fileHash);
+		}
+	}
+	return to_string(FontManager::instance().fontID(font)) + ' ' + font->name()
+		+ ' ' + XMLString(font->scaledSize()) + ' ' + fileHash;
+}
+
+
+/** Returns the fingerprints of all fonts the current page depends on. */
+PageCache::Dependencies DVIToSVG::pageDependencies () const {
+	set<string> fingerprints;
+	if (auto actions = dynamic_cast<const DVIToSVGActions*>(_actions.get())) {
+		for (const auto &fontchar : actions->getUsedChars()) {
+			fingerprints.insert(font_fingerprint(fontchar.first));
+			fingerprints.insert(font_fingerprint(fontchar.first->uniqueFont()));
+		}
+		for (const Font *font : actions->getUsedFonts())
+			fingerprints.insert(font_fingerprint(font));
+	}
+	return PageCache::Dependencies(fingerprints.begin(), fingerprints.end());
+}
+
+
+/** Writes the SVG document of a page previously stored in the page cache. This is
+ *  only done if the cache contains an entry for the combined page hash and if none
+ *  of the fonts the page depends on has changed since the entry was created.
+ *  @param[in] pageno number of page to write
+ *  @param[in] fname name of the SVG file
+ *  @param[in] hashes hash values of the page
+ *  @return true if the page has been written */
+bool DVIToSVG::reuseCachedPage (unsigned pageno, const string &fname, const SVGOutputBase::HashTriple &hashes) {
+	auto actions = dynamic_cast<DVIToSVGActions*>(_actions.get());
+	if (!_pageCache || hashes.empty() || !actions)
+		return false;
+	string svg;
+	PageCache::Dependencies deps;
+	if (!_pageCache->read(hashes.cmbHash(), actions->getPageCount()+1, svg, deps))
+		return false;
+	for (const string &dep : deps) {
+		int fontID = atoi(dep.c_str());
+		const Font *font = FontManager::instance().getFontById(fontID);
+		if (!font || font_fingerprint(font) != dep)
+			return false;
+	}
+	actions->setPageCount(actions->getPageCount()+1);
+	Message::mstream(false, Message::MC_PAGE_NUMBER) << "processing page " << pageno;
+	Message::mstream().indent(1);
+	Message::mstream(false) << "\ntaking SVG data from page cache";
+	if (_out.getPageStream(pageno, numberOfPages(), hashes) << svg)
+		Message::mstream(false, Message::MC_PAGE_WRITTEN) << "\noutput written to " << (fname.empty() ? "<stdout>" : fname) << '\n';
+	else
+		Message::wstream(true) << "failed to write output to " << fname << '\n';
+	Message::mstream().indent(0);
+	return true;
+}
+
+
 /** Creates a HashFunction object for a given algorithm name.
  *  @param[in] algo name of hash algorithm
  *  @return pointer to hash function
@@ -170,11 +287,16 @@ void DVIToSVG::convert (const string &rangestr, pair<int,int> *pageinfo) {
 	}
 
 	unique_ptr<HashFunction> hashFunc;
-	if (!PAGE_HASH_SETTINGS.algorithm().empty())  // name of hash algorithm present?
+	if (!PAGE_HASH_SETTINGS.algorithm().empty()) {  // name of hash algorithm present?
 		hashFunc = create_hash_function(PAGE_HASH_SETTINGS.algorithm());
+		if (PAGE_HASH_SETTINGS.isSet(HashSettings::P_CACHE) && PhysicalFont::CACHE_PATH)
+			_pageCache = util::make_unique<PageCache>(string(PhysicalFont::CACHE_PATH)+"/pages");
+	}
 
-	for (const auto &range : ranges)
-		convert(range.first, range.second, hashFunc.get());
+	if (!convertConcurrently(ranges, hashFunc.get())) {
+		for (const auto &range : ranges)
+			convert(range.first, range.second, hashFunc.get());
+	}
 	if (pageinfo) {
 		pageinfo->first = ranges.numberOfPages();
 		pageinfo->second = numberOfPages();
@@ -182,6 +304,126 @@ void DVIToSVG::convert (const string &rangestr, pair<int,int> *pageinfo) {
 }
 
 
+/** Converts the selected pages by several worker processes running in parallel.
+ *  The pages are split into JOBS consecutive chunks of roughly equal size, and each
+ *  chunk is converted by a forked child process. Since the children are created after
+ *  the DVI file has been pre-scanned and the page hashes have been computed, they all
+ *  start with the same state, i.e. the fonts and glyphs loaded so far are shared
+ *  copy-on-write, while each worker operates on its own DVIReader state, SVG tree, and
+ *  temporary folder. State carried from page to page by specials, like the current
+ *  color or PostScript definitions, can't be passed from one worker to the next.
+ *  Therefore, the pages are converted sequentially if any page preceding the last
+ *  chunk contains such a special, so that the output is always the same as that of
+ *  a sequential conversion.
+ *  @param[in] ranges pages to convert
+ *  @param[in] hashFunc pointer to function to be used to compute page hashes
+ *  @return true if the pages have been processed by worker processes, false if
+ *          they must be converted sequentially by the caller */
+bool DVIToSVG::convertConcurrently (const PageRanges &ranges, HashFunction *hashFunc) {
+#ifdef _WIN32
+	return false;
+#else
+	size_t numPages = ranges.numberOfPages();
+	if (JOBS < 2 || numPages < 2 || _out.filename(1, 1).empty())  // no parallel processing if writing to stdout
+		return false;
+
+	// Distribute the selected pages among the workers. Since the page elements are
+	// numbered consecutively, we also need the number of pages actually converted
+	// prior to each chunk.
+	size_t numChunks = min(size_t(JOBS), numPages);
+	vector<PageRanges> chunks(numChunks);
+	vector<int> pageCounts(numChunks, 0);
+	size_t chunkIndex=0, chunkPages=0;
+	int pageCount=0;
+	auto actions = dynamic_cast<DVIToSVGActions*>(_actions.get());
+	for (const auto &range : ranges) {
+		for (int i=range.first; i <= range.second; i++) {
+			size_t chunkSize = numPages/numChunks + (chunkIndex < numPages%numChunks ? 1 : 0);
+			if (chunkPages == chunkSize) {
+				pageCounts[++chunkIndex] = pageCount;
+				chunkPages = 0;
+			}
+			if (chunkIndex+1 < numChunks && (!actions || actions->getStatefulPages().count(i) > 0)) {
+				Message::mstream(false, Message::MC_PAGE_NUMBER) << "page " << i << " contains specials that may affect the following pages, converting pages sequentially\n";
+				return false;
+			}
+			chunks[chunkIndex].addRange(i);
+			chunkPages++;
+			const SVGOutputBase::HashTriple hashTriple = pageHashes(i, hashFunc);
+			if (!skipPage(_out.filename(i, numberOfPages(), hashTriple), hashTriple))
+				pageCount++;
+		}
+	}
+	// The workers must not share the file position of the DVI input stream,
+	// so each one gets its own copy of the DVI data.
+	istream &is = getInputStream();
+	is.clear();
+	is.seekg(0);
+	ostringstream oss;
+	oss << is.rdbuf();
+	const string dvidata = oss.str();
+	is.clear();
+
+	Message::mstream(false, Message::MC_PAGE_NUMBER) << "converting " << numPages << " pages using " << numChunks << " processes\n";
+	cout.flush();
+	cerr.flush();
+	vector<pid_t> pids;
+	size_t failures=0;
+	for (size_t i=0; i < numChunks; i++) {
+		pid_t pid = fork();
+		if (pid > 0)
+			pids.push_back(pid);
+		else if (pid < 0) {
+			Message::estream(true) << "failed to create worker process\n";
+			failures += numChunks-i;
+			break;
+		}
+		else {  // worker process
+			int status = 0;
+			// Temporary files, e.g. those created by FontWriter and Metafont, are named
+			// after the fonts, so the workers must not share the temporary folder.
+			string tmpdir = FileSystem::tmpdir()+"worker-"+to_string(getpid());
+			if (FileSystem::mkdir(tmpdir))
+				FileSystem::TMPDIR = tmpdir;
+			istringstream iss(dvidata);
+			replaceStream(iss);
+			if (actions)
+				actions->setPageCount(pageCounts[i]);
+			try {
+				for (const auto &range : chunks[i])
+					convert(range.first, range.second, hashFunc);
+				_out.finish();
+			}
+			catch (SignalException &e) {
+				status = 2;
+			}
+			catch (exception &e) {
+				Message::estream(true) << e.what() << '\n';
+				status = 1;
+			}
+			if (FileSystem::TMPDIR == tmpdir && !PhysicalFont::KEEP_TEMP_FILES)
+				FileSystem::rmdir(tmpdir);
+			// Leave without running the exit handlers and static destructors, which
+			// belong to the parent process, but don't lose any buffered output.
+			cout.flush();
+			cerr.flush();
+			fflush(nullptr);
+			_exit(status);
+		}
+	}
+	for (pid_t pid : pids) {
+		int status;
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failures++;
+	}
+	SignalHandler::instance().check();
+	if (failures > 0)
+		throw MessageException("conversion failed in " + to_string(failures) + " of " + to_string(numChunks) + " worker processes");
+	return true;
+#endif
+}
+
+
 /** Writes the hash values of a selected set of pages to an output stream.
  *  @param[in] rangestr string describing the pages to convert
  *  @param[in,out] os stream the output is written to */
@@ -558,7 +800,8 @@ void DVIToSVG::HashSettings::setParameters (const string &paramstr) {
 	auto paramnames = util::split(paramstr, ",");
 	map<string, Parameter> paramMap = {
 		{"list", P_LIST},
-		{"replace", P_REPLACE}
+		{"replace", P_REPLACE},
+		{"cache", P_CACHE}
 	};
 	for (string &name : paramnames) {
 		name = util::trim(name);
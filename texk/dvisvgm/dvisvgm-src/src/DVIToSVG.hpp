@@ -23,19 +23,22 @@
 
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include "DVIReader.hpp"
+#include "PageCache.hpp"
+#include "SVGOutput.hpp"
 #include "SVGTree.hpp"
 
 struct DVIActions;
-struct SVGOutputBase;
 class HashFunction;
+class PageRanges;
 
 class DVIToSVG : public DVIReader {
 	public:
 		class HashSettings {
 			public:
-				enum Parameter {P_LIST, P_REPLACE};
+				enum Parameter {P_LIST, P_REPLACE, P_CACHE};
 				void setParameters (const std::string &paramstr);
 				void setOptionHash (const std::string &optHash) {_optHash = optHash;}
 				std::string algorithm () const {return _algo;}
@@ -69,10 +72,16 @@ class DVIToSVG : public DVIReader {
 		static bool COMPUTE_PROGRESS;  ///< if true, an action to handle the progress ratio of a page is triggered
 		static char TRACE_MODE;
 		static HashSettings PAGE_HASH_SETTINGS;
+		static unsigned JOBS;  ///< number of worker processes used to convert the selected pages
 
 	protected:
 		DVIToSVG (const DVIToSVG&) =delete;
 		void convert (unsigned firstPage, unsigned lastPage, HashFunction *hashFunc);
+		bool convertConcurrently (const PageRanges &ranges, HashFunction *hashFunc);
+		SVGOutputBase::HashTriple pageHashes (unsigned pageno, HashFunction *hashFunc);
+		bool skipPage (const std::string &fname, const SVGOutputBase::HashTriple &hashes) const;
+		bool reuseCachedPage (unsigned pageno, const std::string &fname, const SVGOutputBase::HashTriple &hashes);
+		PageCache::Dependencies pageDependencies () const;
 		int executeCommand () override;
 		void enterBeginPage (unsigned pageno, const std::vector<int32_t> &c);
 		void leaveEndPage (unsigned pageno);
@@ -100,6 +109,8 @@ class DVIToSVG : public DVIReader {
 		SVGTree _svg;
 		SVGOutputBase &_out;
 		std::unique_ptr<DVIActions> _actions;
+		std::unique_ptr<PageCache> _pageCache;  ///< cache of previously converted pages (0 if disabled)
+		std::unordered_map<unsigned,SVGOutputBase::HashTriple> _pageHashes;  ///< hashes of the pages computed so far
 		std::string _bboxFormatString;  ///< bounding box size/format set by the user
 		std::string _transCmds;         ///< page transformation commands set by the user
 		double _pageHeight, _pageWidth; ///< global page height and width stored in the postamble
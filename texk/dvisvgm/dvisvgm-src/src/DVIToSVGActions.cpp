@@ -91,6 +91,7 @@ string DVIToSVGActions::getBBoxFormatString () const {
  *  @param[in] vertical true if we're in vertical mode
  *  @param[in] font font to be used */
 void DVIToSVGActions::setChar (double x, double y, unsigned c, bool vertical, const Font &font) {
+	flushSpecials();  // output of preceding specials must precede the character
 	// If we use SVG fonts there is no need to record all font name/char/size combinations
 	// because the SVG font mechanism handles this automatically. It's sufficient to
 	// record font names and chars. The various font sizes can be ignored here.
@@ -165,6 +166,7 @@ void DVIToSVGActions::setChar (double x, double y, unsigned c, bool vertical, co
  *  @param[in] height length of the vertical edges
  *  @param[in] width length of the horizontal edges */
 void DVIToSVGActions::setRule (double x, double y, double height, double width) {
+	flushSpecials();
 	// (x,y) is the lower left corner of the rectangle
 	auto rect = util::make_unique<XMLElementNode>("rect");
 	rect->addAttribute("x", x);
@@ -201,8 +203,11 @@ void DVIToSVGActions::setFont (int num, const Font &font) {
  *  @param[in] preprocessing if true, the DVI file is being pre-processed */
 void DVIToSVGActions::special (const string &spc, double dvi2bp, bool preprocessing) {
 	try {
-		if (preprocessing)
+		if (preprocessing) {
+			if (SpecialManager::instance().carriesPageState(spc))
+				_statefulPages.insert(getCurrentPageNumber());
 			SpecialManager::instance().preprocess(spc, *this);
+		}
 		else
 			SpecialManager::instance().process(spc, dvi2bp, *this);
 		// @@ output message in case of unsupported specials?
@@ -21,6 +21,7 @@
 #ifndef DVITOSVGACTIONS_HPP
 #define DVITOSVGACTIONS_HPP
 
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include "BoundingBox.hpp"
@@ -54,11 +55,11 @@ class DVIToSVGActions : public DVIActions, public SpecialActions {
 		Color getColor () const override                        {return _svg.getColor();}
 		int getDVIStackDepth() const override                   {return _dvireader->stackDepth();}
 		unsigned getCurrentPageNumber() const override          {return _dvireader->currentPageNumber();}
-		void appendToPage(std::unique_ptr<XMLNode> &&node) override  {_svg.appendToPage(std::move(node));}
+		void appendToPage(std::unique_ptr<XMLNode> &&node) override  {flushSpecials(); _svg.appendToPage(std::move(node));}
 		void appendToDefs(std::unique_ptr<XMLNode> &&node) override  {_svg.appendToDefs(std::move(node));}
-		void prependToPage(std::unique_ptr<XMLNode> &&node) override {_svg.prependToPage(std::move(node));}
-		void pushContextElement (std::unique_ptr<XMLElementNode> &&node) override {_svg.pushContextElement(std::move(node));}
-		void popContextElement () override                      {_svg.popContextElement();}
+		void prependToPage(std::unique_ptr<XMLNode> &&node) override {flushSpecials(); _svg.prependToPage(std::move(node));}
+		void pushContextElement (std::unique_ptr<XMLElementNode> &&node) override {flushSpecials(); _svg.pushContextElement(std::move(node));}
+		void popContextElement () override                      {flushSpecials(); _svg.popContextElement();}
 		void setTextOrientation(bool vertical) override         {_svg.setVertical(vertical);}
 		void moveToX (double x, bool forceSVGMove) override;
 		void moveToY (double y, bool forceSVGMove) override;
@@ -82,6 +83,12 @@ class DVIToSVGActions : public DVIActions, public SpecialActions {
 		CharMap& getUsedChars () const        {return _usedChars;}
 		const FontSet& getUsedFonts () const  {return _usedFonts;}
 		void setDVIReader (BasicDVIReader &r) {_dvireader = &r;}
+		void setPageCount (int count)         {_pageCount = count;}
+		int getPageCount () const             {return _pageCount;}
+		const std::set<unsigned>& getStatefulPages () const {return _statefulPages;}
+
+	protected:
+		void flushSpecials () const {SpecialManager::instance().flushPendingOutput();}
 
 	private:
 		SVGTree &_svg;
@@ -93,6 +100,7 @@ class DVIToSVGActions : public DVIActions, public SpecialActions {
 		FontSet _usedFonts;
 		Color _bgcolor;
 		BoxMap _boxes;
+		std::set<unsigned> _statefulPages;  ///< pages with specials that may affect subsequent pages
 };
 
 
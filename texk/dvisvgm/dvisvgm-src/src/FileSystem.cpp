@@ -36,6 +36,9 @@ using namespace std;
 
 #ifdef _WIN32
 	#include <direct.h>
+	#include <fcntl.h>
+	#include <io.h>
+	#include <sys/stat.h>
 	#include "windows.hpp"
 	const char *FileSystem::DEVNULL = "nul";
 	const char FileSystem::PATHSEP = '\\';
@@ -47,6 +50,16 @@ using namespace std;
 	#include <sys/types.h>
 	const char *FileSystem::DEVNULL = "/dev/null";
 	const char FileSystem::PATHSEP = '/';
+
+	/** Returns the permissions of a file created the usual way. The umask can only
+	 *  be queried by changing it, which affects all threads of the process. Therefore,
+	 *  it's read only once at startup, before any threads are running. */
+	static mode_t default_file_mode () {
+		mode_t mask = umask(0);
+		umask(mask);
+		return 0666 & ~mask;
+	}
+	static const mode_t DEFAULT_FILE_MODE = default_file_mode();
 #endif
 
 
@@ -119,6 +132,34 @@ bool FileSystem::rename (const string &oldname, const string &newname) {
 }
 
 
+/** Creates a new empty file whose name consists of a given prefix followed by
+ *  some unique characters. Files that are to replace another one can be written
+ *  to such a file first and then renamed, so that concurrent processes neither
+ *  get in each other's way nor see a partially written file.
+ *  @param[in] prefix path of the file to create without the unique suffix
+ *  @return name of the created file or an empty string on failure */
+string FileSystem::createUniqueFile (const string &prefix) {
+	string fname = prefix+"XXXXXX";
+#ifdef _WIN32
+	if (_mktemp_s(&fname[0], fname.length()+1) != 0)
+		return "";
+	int fd = _open(fname.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY, _S_IREAD | _S_IWRITE);
+	if (fd < 0)
+		return "";
+	_close(fd);
+#else
+	int fd = mkstemp(&fname[0]);
+	if (fd < 0)
+		return "";
+	// mkstemp creates the file readable by its owner only; grant the permissions
+	// a file created the usual way would have
+	fchmod(fd, DEFAULT_FILE_MODE);
+	close(fd);
+#endif
+	return fname;
+}
+
+
 uint64_t FileSystem::filesize (const string &fname) {
 #ifdef _WIN32
 	// unfortunately, stat doesn't work properly under Windows
@@ -30,6 +30,7 @@ class FileSystem
 		~FileSystem ();
 		static bool remove (const std::string &fname);
 		static bool rename (const std::string &oldname, const std::string &newname);
+		static std::string createUniqueFile (const std::string &prefix);
 		static bool copy (const std::string &src, const std::string &dest, bool remove_src=false);
 		static uint64_t filesize (const std::string &fname);
 		static std::string adaptPathSeperators (std::string path);
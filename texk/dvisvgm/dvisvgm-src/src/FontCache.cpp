@@ -22,74 +22,198 @@
 #include <cstring>
 #include <fstream>
 #include <iomanip>
+#include <set>
 #include <sstream>
 #include "CRC32.hpp"
 #include "FileSystem.hpp"
 #include "FontCache.hpp"
 #include "Glyph.hpp"
 #include "Pair.hpp"
-#include "StreamReader.hpp"
 #include "StreamWriter.hpp"
 
+#ifdef _WIN32
+	#include "windows.hpp"
+#else
+	#include <fcntl.h>
+	#include <sys/file.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 using namespace std;
 
-const uint8_t FontCache::FORMAT_VERSION = 5;
+const uint8_t FontCache::FORMAT_VERSION = 6;
+const char *FontCache::FILENAME = "fontcache.fgc";
 
+/* Layout of the cache file (all numbers are stored in big-endian byte order):
+ *
+ *   header:  "FGC" version
+ *   followed by any number of font records:
+ *     size       (4 bytes)  number of record bytes following this field
+ *     checksum   (4 bytes)  CRC32 of the remaining record bytes
+ *     fontname   (zero-terminated string)
+ *     numglyphs  (4 bytes)
+ *     index      (numglyphs entries of 8 bytes) character code and offset of the glyph
+ *                data relative to the end of the index, sorted by character code
+ *     glyph data (for each glyph: 2 bytes number of path commands followed by the commands) */
 
-static Pair32 read_pair (int bytes, StreamReader &sr) {
-	int32_t x = sr.readSigned(bytes);
-	int32_t y = sr.readSigned(bytes);
-	return Pair32(x, y);
-}
+static const size_t HEADER_SIZE = 4;
 
 
-/** Removes all data from the cache. This does not affect the cache files. */
-void FontCache::clear () {
-	_glyphs.clear();
-	_fontname.clear();
+static uint32_t get_unsigned (const char *p, int n) {
+	uint32_t ret = 0;
+	for (int i=0; i < n; i++)
+		ret = (ret << 8) | uint8_t(p[i]);
+	return ret;
 }
 
 
-/** Assigns glyph data to a character and adds it to the cache.
- *  @param[in] c character code
- *  @param[in] glyph font glyph data */
-void FontCache::setGlyph (int c, const Glyph &glyph) {
-	_glyphs[c] = glyph;
-	_changed = true;
+static int32_t get_signed (const char *p, int n) {
+	uint32_t ret = get_unsigned(p, n);
+	if (n < 4 && (ret & (1 << (8*n-1))))  // negative value?
+		ret |= 0xffffffff << (8*n);
+	return int32_t(ret);
 }
 
 
-/** Returns the corresponding glyph data of a given character of the current font.
- *  @param[in] c character code
- *  @return font glyph data (0 if no matching data was found) */
-const Glyph* FontCache::getGlyph (int c) const {
-	auto it = _glyphs.find(c);
-	return (it != _glyphs.end()) ? &it->second : 0;
+static string header_string (uint8_t version) {
+	return string("FGC")+char(version);
 }
 
 
-/** Writes the current cache data to a file (only if anything changed after
- *  the last call of read()).
- *  @param[in] fontname name of current font
- *  @param[in] dir directory where the cache file should go
- *  @return true if writing was successful */
-bool FontCache::write (const string &fontname, const string &dir) const {
-	if (!_changed)
-		return true;
+/** Opens a file for appending and holds an exclusive lock on it while the
+ *  object exists. The lock only coordinates writers of the cache file, readers
+ *  map the file without taking it. */
+class LockedFile {
+	public:
+		explicit LockedFile (const string &path) {
+#ifdef _WIN32
+			// Windows doesn't allow replacing a file opened this way, so the file
+			// can't be exchanged behind our back after it was opened
+			_handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (_handle != INVALID_HANDLE_VALUE) {
+				// lock a byte far beyond the end of the file so that reading
+				// the file isn't blocked
+				OVERLAPPED ov = {};
+				ov.Offset = ov.OffsetHigh = 0xffffffff;
+				if (!LockFileEx(_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &ov)) {
+					CloseHandle(_handle);
+					_handle = INVALID_HANDLE_VALUE;
+				}
+			}
+#else
+			// The file may have been replaced by another process between opening
+			// and locking it. Records appended to the old file would get lost then.
+			for (int i=0; i < 10 && _fd < 0; i++) {
+				_fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+				if (_fd < 0)
+					break;
+				struct stat st1, st2;
+				if (flock(_fd, LOCK_EX) != 0 || fstat(_fd, &st1) != 0 || stat(path.c_str(), &st2) != 0
+					 || st1.st_dev != st2.st_dev || st1.st_ino != st2.st_ino) {
+					close(_fd);
+					_fd = -1;
+				}
+			}
+#endif
+		}
 
-	if (!fontname.empty()) {
-		string dirstr = dir.empty() ? FileSystem::getcwd() : dir;
-		ostringstream oss;
-		oss << dirstr << '/' << fontname << ".fgd";
-		ofstream ofs(oss.str(), ios::binary);
-		return write(fontname, ofs);
-	}
-	return false;
-}
+		~LockedFile () {
+#ifdef _WIN32
+			if (_handle != INVALID_HANDLE_VALUE)
+				CloseHandle(_handle);  // also releases the lock
+#else
+			if (_fd >= 0)
+				close(_fd);  // also releases the lock
+#endif
+		}
 
+		LockedFile (const LockedFile &file) =delete;
+		LockedFile& operator = (const LockedFile &file) =delete;
+
+#ifdef _WIN32
+		bool isOpen () const {return _handle != INVALID_HANDLE_VALUE;}
+#else
+		bool isOpen () const {return _fd >= 0;}
+#endif
+
+		/** Reads the first bytes of the file.
+		 *  @param[out] buf takes the bytes read
+		 *  @param[in] n number of bytes to read
+		 *  @return number of bytes read */
+		size_t readHead (char *buf, size_t n) const {
+			size_t count=0;
+#ifdef _WIN32
+			OVERLAPPED ov = {};
+			DWORD len;
+			if (ReadFile(_handle, buf, DWORD(n), &len, &ov))
+				count = len;
+#else
+			while (count < n) {
+				ssize_t len = pread(_fd, buf+count, n-count, count);
+				if (len <= 0)
+					break;
+				count += len;
+			}
+#endif
+			return count;
+		}
 
-bool FontCache::write (const string &dir) const {
-	return _fontname.empty() ? false : write(_fontname, dir);
+		/** Writes data to the end of the file.
+		 *  @return true on success */
+		bool append (const string &data) const {
+			const char *p = data.data();
+			size_t remaining = data.length();
+#ifdef _WIN32
+			LARGE_INTEGER zero = {};
+			if (!SetFilePointerEx(_handle, zero, nullptr, FILE_END))
+				return false;
+			while (remaining > 0) {
+				DWORD len;
+				if (!WriteFile(_handle, p, DWORD(remaining), &len, nullptr) || len == 0)
+					return false;
+				p += len;
+				remaining -= len;
+			}
+#else
+			while (remaining > 0) {
+				ssize_t len = write(_fd, p, remaining);
+				if (len <= 0)
+					return false;
+				p += len;
+				remaining -= len;
+			}
+#endif
+			return true;
+		}
+
+	private:
+#ifdef _WIN32
+		HANDLE _handle = INVALID_HANDLE_VALUE;
+#else
+		int _fd = -1;
+#endif
+};
+
+
+/** Writes a new file and replaces a given one by it. Processes that currently
+ *  map the old file into memory are not affected.
+ *  @param[in] path path of the file to replace
+ *  @param[in] parts data to write, concatenated
+ *  @return true on success */
+static bool replace_file (const string &path, const vector<pair<const char*,size_t>> &parts) {
+	string tmppath = FileSystem::createUniqueFile(path+".tmp");
+	if (tmppath.empty())
+		return false;
+	ofstream ofs(tmppath, ios::binary);
+	for (const auto &part : parts)
+		ofs.write(part.first, part.second);
+	ofs.close();
+	if (!ofs || !FileSystem::rename(tmppath, path)) {
+		FileSystem::remove(tmppath);
+		return false;
+	}
+	return true;
 }
 
 
@@ -117,135 +241,303 @@ static int max_int_size (const Pair<int32_t> *pairs, size_t n) {
 }
 
 
-/** Writes the current cache data to a stream (only if anything changed after
- *  the last call of read()).
+/** Decodes the outline of a single glyph.
+ *  @param[in] p pointer to the encoded path commands
+ *  @param[in] len number of bytes available
+ *  @param[out] glyph the decoded glyph
+ *  @return true on success */
+static bool decode_glyph (const char *p, size_t len, Glyph &glyph) {
+	if (len < 2)
+		return false;
+	const char *end = p+len;
+	uint16_t numcmds = get_unsigned(p, 2);
+	p += 2;
+	while (numcmds-- > 0 && p < end) {
+		uint8_t cmdval = *p++;
+		uint8_t cmdchar = (cmdval & 0x1f) + 'A';
+		int bytes = cmdval >> 5;
+		int numpoints = 0;
+		switch (cmdchar) {
+			case 'C': numpoints = 3; break;
+			case 'L':
+			case 'M': numpoints = 1; break;
+			case 'Q': numpoints = 2; break;
+			case 'Z': break;
+			default : return false;
+		}
+		if (p+2*numpoints*bytes > end)
+			return false;
+		Pair32 points[3];
+		for (int i=0; i < numpoints; i++) {
+			points[i] = Pair32(get_signed(p, bytes), get_signed(p+bytes, bytes));
+			p += 2*bytes;
+		}
+		switch (cmdchar) {
+			case 'C': glyph.cubicto(points[0], points[1], points[2]); break;
+			case 'L': glyph.lineto(points[0]); break;
+			case 'M': glyph.moveto(points[0]); break;
+			case 'Q': glyph.conicto(points[0], points[1]); break;
+			case 'Z': glyph.closepath();
+		}
+	}
+	return true;
+}
+
+
+/** Returns the path of the cache file located in a given directory. */
+string FontCache::filepath (const string &dir) {
+	return (dir.empty() ? FileSystem::getcwd() : dir) + "/" + FILENAME;
+}
+
+
+/** Removes all data of the current font from the cache. This does not affect the cache file. */
+void FontCache::clear () {
+	_glyphs.clear();
+	_fontname.clear();
+	_index = nullptr;
+	_numIndexEntries = 0;
+	_glyphDataSize = 0;
+}
+
+
+/** Assigns glyph data to a character and adds it to the cache.
+ *  @param[in] c character code
+ *  @param[in] glyph font glyph data */
+void FontCache::setGlyph (int c, const Glyph &glyph) {
+	_glyphs[c] = glyph;
+	_changed = true;
+}
+
+
+/** Looks up the encoded outline of a character in the index of the current font record.
+ *  @param[in] c character code
+ *  @param[out] len number of bytes of the encoded outline
+ *  @return pointer to the encoded outline (0 if the glyph is not present) */
+const char* FontCache::findGlyphData (int c, size_t *len) const {
+	if (!_index || c < 0)
+		return nullptr;
+	uint32_t left=0, right=_numIndexEntries;
+	while (left < right) {  // binary search in index
+		uint32_t mid = left+(right-left)/2;
+		uint32_t midchar = get_unsigned(_index+8*mid, 4);
+		if (midchar == uint32_t(c)) {
+			const char *glyphData = _index+8*_numIndexEntries;
+			size_t offset = get_unsigned(_index+8*mid+4, 4);
+			size_t next = (mid+1 < _numIndexEntries) ? get_unsigned(_index+8*(mid+1)+4, 4) : _glyphDataSize;
+			if (offset > next || next > _glyphDataSize)
+				return nullptr;
+			if (len)
+				*len = next-offset;
+			return glyphData+offset;
+		}
+		if (midchar < uint32_t(c))
+			left = mid+1;
+		else
+			right = mid;
+	}
+	return nullptr;
+}
+
+
+/** Returns the corresponding glyph data of a given character of the current font.
+ *  Glyphs present in the cache file are decoded on first access.
+ *  @param[in] c character code
+ *  @return font glyph data (0 if no matching data was found) */
+const Glyph* FontCache::getGlyph (int c) const {
+	auto it = _glyphs.find(c);
+	if (it != _glyphs.end())
+		return &it->second;
+	size_t len;
+	if (const char *data = findGlyphData(c, &len)) {
+		Glyph glyph;
+		if (decode_glyph(data, len, glyph))
+			return &(_glyphs[c] = std::move(glyph));
+	}
+	return nullptr;
+}
+
+
+/** Maps the cache file into memory and collects the offsets of the font records.
+ *  If the file is already mapped and didn't grow in the meantime, nothing happens.
+ *  @param[in] path path of the cache file
+ *  @return true if the cache file is present and valid */
+bool FontCache::mapCacheFile (const string &path) {
+	if (_mappedFile.isOpen() && path == _mappedPath && FileSystem::filesize(path) == _mappedFile.size())
+		return !_records.empty();
+	_index = nullptr;
+	_records.clear();
+	_verifiedRecords.clear();
+	_mappedPath = path;
+	if (!_mappedFile.open(path))
+		return false;
+	const char *data = _mappedFile.data();
+	size_t size = _mappedFile.size();
+	if (size < HEADER_SIZE || string(data, HEADER_SIZE) != header_string(FORMAT_VERSION))
+		return false;
+	size_t pos = HEADER_SIZE;
+	while (pos+8 < size) {
+		size_t recsize = get_unsigned(data+pos, 4);
+		if (recsize < 9 || pos+4+recsize > size)  // incomplete record?
+			break;
+		const char *name = data+pos+8;
+		if (const char *nameend = static_cast<const char*>(memchr(name, 0, recsize-4)))
+			_records[string(name, nameend)] = pos;
+		pos += 4+recsize;
+	}
+	return !_records.empty();
+}
+
+
+/** Checks the integrity of a font record.
+ *  @param[in] rec pointer to the beginning of the record
+ *  @param[out] index pointer to the index of the record
+ *  @param[out] numglyphs number of glyphs stored in the record
+ *  @param[out] glyphDataSize number of bytes occupied by the encoded outlines
+ *  @param[in] verifyChecksum if false, the checksum is assumed to be correct
+ *  @return true if the record is valid */
+static bool check_record (const char *rec, const char **index, uint32_t *numglyphs, size_t *glyphDataSize, bool verifyChecksum=true) {
+	uint32_t recsize = get_unsigned(rec, 4);
+	if (verifyChecksum && CRC32::compute(reinterpret_cast<const uint8_t*>(rec+8), recsize-4) != get_unsigned(rec+4, 4))
+		return false;
+	const char *end = rec+4+recsize;
+	const char *p = rec+8;
+	p += strlen(p)+1;  // skip fontname
+	if (p+4 > end)
+		return false;
+	*numglyphs = get_unsigned(p, 4);
+	*index = p+4;
+	if (*index+8*size_t(*numglyphs) > end)
+		return false;
+	*glyphDataSize = end-(*index+8*size_t(*numglyphs));
+	return true;
+}
+
+
+/** Appends the glyph data of the current font to the cache file (only if anything changed
+ *  after the last call of read()). Glyphs already stored in the cache file are copied
+ *  without decoding them.
  *  @param[in] fontname name of current font
- *  @param[in] os output stream
+ *  @param[in] dir directory where the cache file is located
  *  @return true if writing was successful */
-bool FontCache::write (const string &fontname, ostream &os) const {
+bool FontCache::write (const string &fontname, const string &dir) const {
 	if (!_changed)
 		return true;
-	if (!os)
+	if (fontname.empty())
 		return false;
 
-	StreamWriter sw(os);
-	CRC32 crc32;
+	ostringstream oss;
+	StreamWriter sw(oss);
 
 	struct WriteActions : Glyph::Actions {
-		WriteActions (StreamWriter &sw, CRC32 &crc32) : _sw(sw), _crc32(crc32) {}
+		WriteActions (StreamWriter &sw) : _sw(sw) {}
 
 		void draw (char cmd, const Glyph::Point *points, int n) override {
 			int bytes = max_int_size(points, n);
-			int cmdchar = (bytes << 5) | (cmd - 'A');
-			_sw.writeUnsigned(cmdchar, 1, _crc32);
+			_sw.writeUnsigned((bytes << 5) | (cmd - 'A'), 1);
 			for (int i=0; i < n; i++) {
-				_sw.writeSigned(points[i].x(), bytes, _crc32);
-				_sw.writeSigned(points[i].y(), bytes, _crc32);
+				_sw.writeSigned(points[i].x(), bytes);
+				_sw.writeSigned(points[i].y(), bytes);
 			}
 		}
 		StreamWriter &_sw;
-		CRC32 &_crc32;
-	} actions(sw, crc32);
-
-	sw.writeUnsigned(FORMAT_VERSION, 1, crc32);
-	sw.writeUnsigned(0, 4);  // space for checksum
-	sw.writeString(fontname, crc32, true);
-	sw.writeUnsigned(_glyphs.size(), 4, crc32);
-	for (const auto &charglyphpair : _glyphs) {
-		const Glyph &glyph = charglyphpair.second;
-		sw.writeUnsigned(charglyphpair.first, 4, crc32);
-		sw.writeUnsigned(glyph.size(), 2, crc32);
-		glyph.iterate(actions, false);
+	} actions(sw);
+
+	// collect the character codes of all glyphs to be written
+	set<int> charcodes;
+	for (const auto &charglyphpair : _glyphs)
+		charcodes.insert(charglyphpair.first);
+	if (fontname == _fontname) {
+		for (uint32_t i=0; i < _numIndexEntries; i++)
+			charcodes.insert(int(get_unsigned(_index+8*i, 4)));
+	}
+	// encode the glyph outlines
+	vector<pair<int,size_t>> index;
+	for (int c : charcodes) {
+		index.emplace_back(c, size_t(oss.tellp()));
+		auto it = _glyphs.find(c);
+		if (it != _glyphs.end()) {
+			sw.writeUnsigned(it->second.size(), 2);
+			it->second.iterate(actions, false);
+		}
+		else {
+			size_t len;
+			if (const char *data = findGlyphData(c, &len))
+				oss.write(data, len);
+			else
+				sw.writeUnsigned(0, 2);  // empty glyph
+		}
+	}
+	string glyphData = oss.str();
+	oss.str("");
+	sw.writeString(fontname, true);
+	sw.writeUnsigned(index.size(), 4);
+	for (const auto &entry : index) {
+		sw.writeUnsigned(entry.first, 4);
+		sw.writeUnsigned(entry.second, 4);
 	}
-	os.seekp(1);
-	sw.writeUnsigned(crc32.get(), 4);  // insert CRC32 checksum
-	os.seekp(0, ios::end);
+	string record = oss.str()+glyphData;
+	uint32_t crc = CRC32::compute(reinterpret_cast<const uint8_t*>(record.data()), record.length());
+	oss.str("");
+	sw.writeUnsigned(record.length()+4, 4);
+	sw.writeUnsigned(crc, 4);
+	record.insert(0, oss.str());
+
+	// Append the record to the cache file. The lock keeps the records of concurrent
+	// processes from interleaving. If the file is new, a header is written first.
+	// If it has an incompatible format, it's replaced by a new one.
+	string path = filepath(dir);
+	LockedFile file(path);
+	if (!file.isOpen())
+		return false;
+	char header[HEADER_SIZE];
+	size_t headerSize = file.readHead(header, HEADER_SIZE);
+	string expectedHeader = header_string(FORMAT_VERSION);
+	bool success;
+	if (headerSize == HEADER_SIZE && string(header, HEADER_SIZE) == expectedHeader)
+		success = file.append(record);
+	else if (headerSize == 0)
+		success = file.append(expectedHeader+record);
+	else
+		success = replace_file(path, {{expectedHeader.data(), HEADER_SIZE}, {record.data(), record.length()}});
+	if (!success)
+		return false;
+	_changed = false;
 	return true;
 }
 
 
-/** Reads font glyph information from a file.
- *  @param[in] fontname name of font data to read
- *  @param[in] dir directory where the cache files are located
- *  @return true if reading was successful */
-bool FontCache::read (const string &fontname, const string &dir) {
-	if (fontname.empty())
-		return false;
-	if (_fontname == fontname)
-		return true;
-	clear();
-	string dirstr = dir.empty() ? FileSystem::getcwd() : dir;
-	ostringstream oss;
-	oss << dirstr << '/' << fontname << ".fgd";
-	ifstream ifs(oss.str(), ios::binary);
-	return read(fontname, ifs);
+bool FontCache::write (const string &dir) const {
+	return _fontname.empty() ? false : write(_fontname, dir);
 }
 
 
-/** Reads font glyph information from a stream.
+/** Selects a font of the cache file. Its glyphs are decoded on demand by getGlyph().
  *  @param[in] fontname name of font data to read
- *  @param[in] is input stream to read the glyph data from
- *  @return true if reading was successful */
-bool FontCache::read (const string &fontname, istream &is) {
+ *  @param[in] dir directory where the cache file is located
+ *  @return true if the font is present in the cache */
+bool FontCache::read (const string &fontname, const string &dir) {
+	if (fontname.empty())
+		return false;
 	if (_fontname == fontname)
 		return true;
 	clear();
 	_fontname = fontname;
-	if (!is)
-		return false;
-
-	StreamReader sr(is);
-	CRC32 crc32;
-	if (sr.readUnsigned(1, crc32) != FORMAT_VERSION)
+	_changed = false;
+	if (!mapCacheFile(filepath(dir)))
 		return false;
-
-	uint32_t crc32_cmp = sr.readUnsigned(4);
-	crc32.update(is);
-	if (crc32.get() != crc32_cmp)
+	auto it = _records.find(fontname);
+	if (it == _records.end())
 		return false;
-
-	is.clear();
-	is.seekg(5);  // continue reading after checksum
-
-	string fname = sr.readString();
-	if (fname != fontname)
+	const char *index;
+	uint32_t numglyphs;
+	size_t glyphDataSize;
+	bool verified = (_verifiedRecords.find(it->second) != _verifiedRecords.end());
+	if (!check_record(_mappedFile.data()+it->second, &index, &numglyphs, &glyphDataSize, !verified))
 		return false;
-
-	uint32_t num_glyphs = sr.readUnsigned(4);
-	while (num_glyphs-- > 0) {
-		uint32_t c = sr.readUnsigned(4);  // character code
-		uint16_t s = sr.readUnsigned(2);  // number of path commands
-		Glyph &glyph = _glyphs[c];
-		while (s-- > 0) {
-			uint8_t cmdval = sr.readUnsigned(1);
-			uint8_t cmdchar = (cmdval & 0x1f) + 'A';
-			int bytes = cmdval >> 5;
-			switch (cmdchar) {
-				case 'C': {
-					Pair32 p1 = read_pair(bytes, sr);
-					Pair32 p2 = read_pair(bytes, sr);
-					Pair32 p3 = read_pair(bytes, sr);
-					glyph.cubicto(p1, p2, p3);
-					break;
-				}
-				case 'L':
-					glyph.lineto(read_pair(bytes, sr));
-					break;
-				case 'M':
-					glyph.moveto(read_pair(bytes, sr));
-					break;
-				case 'Q': {
-					Pair32 p1 = read_pair(bytes, sr);
-					Pair32 p2 = read_pair(bytes, sr);
-					glyph.conicto(p1, p2);
-					break;
-				}
-				case 'Z':
-					glyph.closepath();
-			}
-		}
-	}
-	_changed = false;
+	_verifiedRecords.insert(it->second);
+	_index = index;
+	_numIndexEntries = numglyphs;
+	_glyphDataSize = glyphDataSize;
 	return true;
 }
 
@@ -262,87 +554,91 @@ bool FontCache::fontinfo (const string &dirname, vector<FontInfo> &infos, vector
 		vector<string> fnames;
 		FileSystem::collect(dirname, fnames);
 		for (const string &fname : fnames) {
-			if (fname[0] == 'f' && fname.length() > 5 && fname.substr(fname.length()-4) == ".fgd") {
-				FontInfo info;
-				string path = dirname+"/"+(fname.substr(1));
-				ifstream ifs(path, ios::binary);
-				if (fontinfo(ifs, info))
+			// per-font cache files of format version 5 and below are no longer used
+			if (fname[0] == 'f' && fname.length() > 5 && fname.substr(fname.length()-4) == ".fgd")
+				invalid.emplace_back(fname.substr(1));
+		}
+		FontCache cache;
+		string path = filepath(dirname);
+		if (cache.mapCacheFile(path)) {
+			map<string,size_t> sortmap(cache._records.begin(), cache._records.end());
+			for (const auto &strpospair : sortmap) {
+				const char *rec = cache._mappedFile.data()+strpospair.second;
+				const char *index;
+				uint32_t numglyphs;
+				size_t glyphDataSize;
+				if (check_record(rec, &index, &numglyphs, &glyphDataSize)) {
+					FontInfo info;
+					info.name = strpospair.first;
+					info.version = FORMAT_VERSION;
+					info.checksum = get_unsigned(rec+4, 4);
+					info.numchars = numglyphs;
+					info.numbytes = get_unsigned(rec, 4)+4;
+					info.numcmds = 0;
+					const char *glyphData = index+8*numglyphs;
+					for (uint32_t i=0; i < numglyphs; i++) {
+						size_t offset = get_unsigned(index+8*i+4, 4);
+						if (offset+2 <= glyphDataSize)
+							info.numcmds += get_unsigned(glyphData+offset, 2);
+					}
 					infos.emplace_back(move(info));
-				else
-					invalid.emplace_back(fname.substr(1));
+				}
 			}
 		}
+		else if (FileSystem::exists(path) && (!cache._mappedFile.isOpen() || cache._mappedFile.size() > HEADER_SIZE))
+			invalid.emplace_back(FILENAME);
 	}
 	return !infos.empty();
 }
 
 
-/** Collects font cache information of a single font.
- *  @param[in]  is input stream of the cache file
- *  @param[out] info the collected data
- *  @return true if data could be read, false if cache file is unavailable, outdated, or corrupted */
-bool FontCache::fontinfo (std::istream &is, FontInfo &info) {
-	info.name.clear();
-	info.numchars = info.numbytes = info.numcmds = 0;
-	if (is) {
-		is.clear();
-		is.seekg(0);
-		try {
-			StreamReader sr(is);
-			CRC32 crc32;
-			if ((info.version = sr.readUnsigned(1, crc32)) != FORMAT_VERSION)
-				return false;
-
-			info.checksum = sr.readUnsigned(4);
-			crc32.update(is);
-			if (crc32.get() != info.checksum)
-				return false;
-
-			is.clear();
-			is.seekg(5);  // continue reading after checksum
-
-			info.name = sr.readString();
-			info.numchars = sr.readUnsigned(4);
-			for (uint32_t i=0; i < info.numchars; i++) {
-				sr.readUnsigned(4);  // character code
-				uint16_t s = sr.readUnsigned(2);  // number of path commands
-				while (s-- > 0) {
-					uint8_t cmdval = sr.readUnsigned(1);
-					uint8_t cmdchar = (cmdval & 0x1f) + 'A';
-					int bytes = cmdval >> 5;
-					int bc = 0;
-					switch (cmdchar) {
-						case 'C': bc = 6*bytes; break;
-						case 'H':
-						case 'L':
-						case 'M':
-						case 'T':
-						case 'V': bc = 2*bytes; break;
-						case 'Q':
-						case 'S': bc = 4*bytes; break;
-						case 'Z': break;
-						default : return false;
-					}
-					info.numbytes += bc+1; // command length + command
-					info.numcmds++;
-					is.seekg(bc, ios::cur);
-				}
-				info.numbytes += 6; // number of path commands + char code
-			}
-			info.numbytes += 6+info.name.length(); // version + 0-byte + fontname + number of chars
-		}
-		catch (StreamReaderException &e) {
-			return false;
+/** Rewrites the cache file so that it only contains the valid and most recent font records.
+ *  @param[in] dirname path to font cache directory
+ *  @return number of bytes removed */
+size_t FontCache::compact (const string &dirname, const vector<FontInfo> &infos) {
+	string path = filepath(dirname);
+	// keep others from appending records while the file is rewritten
+	LockedFile file(path);
+	MemoryMappedFile mmf(path);
+	if (!file.isOpen() || !mmf.isOpen() || mmf.size() <= HEADER_SIZE)
+		return 0;
+	set<string> validFonts;
+	for (const FontInfo &info : infos)
+		validFonts.insert(info.name);
+	// collect the most recent records of the valid fonts
+	map<string, const char*> records;
+	const char *data = mmf.data();
+	size_t pos = HEADER_SIZE;
+	while (pos+8 < mmf.size()) {
+		size_t recsize = get_unsigned(data+pos, 4);
+		if (recsize < 9 || pos+4+recsize > mmf.size())
+			break;
+		const char *name = data+pos+8;
+		if (const char *nameend = static_cast<const char*>(memchr(name, 0, recsize-4))) {
+			if (validFonts.find(string(name, nameend)) != validFonts.end())
+				records[string(name, nameend)] = data+pos;
 		}
+		pos += 4+recsize;
 	}
-	return true;
+	size_t size = HEADER_SIZE;
+	for (const auto &entry : records)
+		size += get_unsigned(entry.second, 4)+4;
+	if (size >= mmf.size())
+		return 0;
+	string header = header_string(FORMAT_VERSION);
+	vector<pair<const char*,size_t>> parts{{header.data(), HEADER_SIZE}};
+	for (const auto &entry : records)
+		parts.emplace_back(entry.second, get_unsigned(entry.second, 4)+4);
+	if (!replace_file(path, parts))
+		return 0;
+	return mmf.size()-size;
 }
 
 
 /** Collects font cache information and write it to a stream.
  *  @param[in] dirname path to font cache directory
  *  @param[in] os output is written to this stream
- *  @param[in] purge if true, outdated and corrupted cache files are removed */
+ *  @param[in] purge if true, outdated and corrupted cache files are removed and the cache file is compacted */
 void FontCache::fontinfo (const string &dirname, ostream &os, bool purge) {
 	if (!dirname.empty()) {
 		ios::fmtflags osflags(os.flags());
@@ -352,16 +648,13 @@ void FontCache::fontinfo (const string &dirname, ostream &os, bool purge) {
 			os << "cache is empty\n";
 		else {
 			os << "cache format version " << infos[0].version << endl;
-			map<string, const FontInfo*> sortmap;
-			for (const FontInfo &info : infos)
-				sortmap[info.name] = &info;
-			for (const auto &strinfopair : sortmap) {
+			for (const FontInfo &info : infos) {
 				os	<< dec << setfill(' ') << left
-					<< setw(10) << left  << strinfopair.second->name
-					<< setw(5)  << right << strinfopair.second->numchars << " glyph" << (strinfopair.second->numchars == 1 ? ' ':'s')
-					<< setw(10) << right << strinfopair.second->numcmds  << " cmd"   << (strinfopair.second->numcmds == 1 ? ' ':'s')
-					<< setw(12) << right << strinfopair.second->numbytes << " byte"  << (strinfopair.second->numbytes == 1 ? ' ':'s')
-					<< setw(6) << "crc:" << setw(8) << hex << right << setfill('0') << strinfopair.second->checksum
+					<< setw(10) << left  << info.name
+					<< setw(5)  << right << info.numchars << " glyph" << (info.numchars == 1 ? ' ':'s')
+					<< setw(10) << right << info.numcmds  << " cmd"   << (info.numcmds == 1 ? ' ':'s')
+					<< setw(12) << right << info.numbytes << " byte"  << (info.numbytes == 1 ? ' ':'s')
+					<< setw(6) << "crc:" << setw(8) << hex << right << setfill('0') << info.checksum
 					<< endl;
 			}
 		}
@@ -371,6 +664,8 @@ void FontCache::fontinfo (const string &dirname, ostream &os, bool purge) {
 				if (FileSystem::remove(path))
 					os << "invalid cache file " << str << " removed\n";
 			}
+			if (size_t bytes = compact(dirname, infos))
+				os << dec << bytes << " bytes of outdated cache data removed\n";
 		}
 		os.flags(osflags);  // restore format flags
 	}
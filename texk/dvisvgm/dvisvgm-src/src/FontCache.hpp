@@ -23,43 +23,64 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "Glyph.hpp"
+#include "MemoryMappedFile.hpp"
 
 
+/** Stores the glyph outlines of bitmap fonts traced by dvisvgm. The glyphs of all fonts
+ *  are kept in a single cache file which is mapped into memory. It consists of a sequence
+ *  of font records, each containing an index of the character codes followed by the
+ *  encoded outlines. Thus, glyphs can be looked up by their offsets without parsing any
+ *  data not required. New or modified fonts are appended to the file so that concurrent
+ *  readers are not affected. A font record supersedes all preceding records of the same
+ *  font. */
 class FontCache {
 	public:
 		struct FontInfo {
 			std::string name;   // fontname
 			uint16_t version;   // file format version
-			uint32_t checksum;  // CRC32 checksum of file data
+			uint32_t checksum;  // CRC32 checksum of font record
 			uint32_t numchars;  // number of characters
 			uint32_t numbytes;  // number of bytes
 			uint32_t numcmds;   // number of path commands
 		};
 
 	public:
-		FontCache () : _changed(false) {}
+		FontCache () : _index(nullptr), _numIndexEntries(0), _glyphDataSize(0), _changed(false) {}
 		~FontCache () {clear();}
 		bool read (const std::string &fontname, const std::string &dir);
-		bool read (const std::string &fontname, std::istream &is);
 		bool write (const std::string &dir) const;
 		bool write (const std::string &fontname, const std::string &dir) const;
-		bool write (const std::string &fontname, std::ostream &os) const;
 		const Glyph* getGlyph (int c) const;
 		void setGlyph (int c, const Glyph &glyph);
 		void clear ();
 		const std::string& fontname () const {return _fontname;}
 
+		static std::string filepath (const std::string &dir);
 		static bool fontinfo (const std::string &dirname, std::vector<FontInfo> &infos, std::vector<std::string> &invalid);
-		static bool fontinfo (std::istream &is, FontInfo &info);
 		static void fontinfo (const std::string &dirname, std::ostream &os, bool purge=false);
 
+	protected:
+		bool mapCacheFile (const std::string &path);
+		const char* findGlyphData (int c, size_t *len=nullptr) const;
+		static size_t compact (const std::string &dirname, const std::vector<FontInfo> &infos);
+
 	private:
 		static const uint8_t FORMAT_VERSION;
+		static const char *FILENAME;
 		std::string _fontname;
-		std::map<int, Glyph> _glyphs;
-		bool _changed;
+		mutable std::map<int, Glyph> _glyphs;   ///< decoded and added glyphs of the current font
+		MemoryMappedFile _mappedFile;           ///< contents of the cache file
+		std::string _mappedPath;                ///< path of the mapped cache file
+		std::unordered_map<std::string, size_t> _records;  ///< fontname -> offset of most recent font record
+		std::unordered_set<size_t> _verifiedRecords;       ///< offsets of font records with verified checksum
+		const char *_index;                     ///< index of the current font record (in mapped memory)
+		uint32_t _numIndexEntries;              ///< number of glyphs present in the current font record
+		size_t _glyphDataSize;                  ///< number of bytes occupied by the glyph outlines of the current font record
+		mutable bool _changed;
 };
 
 #endif
@@ -20,6 +20,8 @@
 
 #include <algorithm>
 #include <array>
+#include <ostream>
+#include "FileSystem.hpp"
 #include "FontWriter.hpp"
 #include "Message.hpp"
 #include "utility.hpp"
@@ -66,26 +68,60 @@ vector<string> FontWriter::supportedFormats () {
 }
 
 
+/** Removes the font files stored in subdirectory "fonts" of the cache directory.
+ *  The files are identified by hashes only, so there is no way to tell outdated
+ *  from current ones. Since the directory grows with each new font subset, it is
+ *  emptied completely, and the files are created again when needed.
+ *  @param[in] dirname path to the cache directory
+ *  @param[in] os the number of removed files is reported to this stream */
+void FontWriter::purgeCache (const string &dirname, ostream &os) {
+	string fontdir = dirname+"/fonts";
+	vector<string> entries;
+	uint64_t bytes=0;
+	int count=0;
+	FileSystem::collect(fontdir, entries);
+	for (const string &entry : entries) {
+		if (entry[0] != 'f')
+			continue;
+		string path = fontdir+"/"+entry.substr(1);
+		uint64_t size = FileSystem::filesize(path);
+		if (FileSystem::remove(path)) {
+			bytes += size;
+			count++;
+		}
+	}
+	if (count > 0)
+		os << count << " cached font file" << (count == 1 ? "" : "s") << " (" << bytes << " bytes) removed\n";
+}
+
+
 #include <config.h>
 
 #ifdef DISABLE_WOFF
 // dummy functions used if WOFF support is disabled
 FontWriter::FontWriter (const PhysicalFont &font) : _font(font) {}
 std::string FontWriter::createFontFile (FontFormat format, const set<int> &charcodes, GFGlyphTracer::Callback *cb) const {return "";}
+std::future<std::string> FontWriter::createCSSFontFace (FontFormat format, const set<int> &charcodes, GFGlyphTracer::Callback *cb) const {
+	promise<string> css;
+	css.set_value("");
+	return css.get_future();
+}
 bool FontWriter::writeCSSFontFace (FontFormat format, const set<int> &charcodes, ostream &os, GFGlyphTracer::Callback *cb) const {return false;}
 #else
 #include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <system_error>
 #include <woff2/encode.h>
 #include "ffwrapper.h"
 #include "Bezier.hpp"
-#include "FileSystem.hpp"
 #include "Font.hpp"
 #include "Glyph.hpp"
+#include "HashFunction.hpp"
 #include "TTFAutohint.hpp"
 #include "TrueTypeFont.hpp"
+#include "version.hpp"
 
 
 FontWriter::FontWriter (const PhysicalFont &font) : _font(font) {
@@ -129,13 +165,9 @@ struct SFDActions : Glyph::Actions {
 };
 
 
-/** Creates a Spline Font Database (SFD) file describing the font and its glyphs.
+/** Writes a Spline Font Database (SFD) describing the font and its glyphs.
  *  https://fontforge.github.io/sfdformat.html */
-static void writeSFD (const string &sfdname, const PhysicalFont &font, const set<int> &charcodes, GFGlyphTracer::Callback *cb) {
-	ofstream sfd(sfdname);
-	if (!sfd)
-		throw FontWriterException("failed writing SFD file "+sfdname);
-
+static void writeSFD (ostream &sfd, const PhysicalFont &font, const set<int> &charcodes, GFGlyphTracer::Callback *cb) {
 	sfd <<
 		"SplineFontDB: 3.0\n"
 		"FontName: " << font.name() << '\n';
@@ -178,7 +210,15 @@ static void writeSFD (const string &sfdname, const PhysicalFont &font, const set
 			"EndSplineSet\n"
 			"EndChar\n";
 	}
-	sfd.flush();
+}
+
+
+/** Creates a Spline Font Database (SFD) file describing the font and its glyphs. */
+static void writeSFD (const string &sfdname, const PhysicalFont &font, const set<int> &charcodes, GFGlyphTracer::Callback *cb) {
+	ofstream sfd(sfdname);
+	if (!sfd)
+		throw FontWriterException("failed writing SFD file "+sfdname);
+	writeSFD(sfd, font, charcodes, cb);
 	sfd.close();
 	if (sfd.fail())
 		throw FontWriterException("failed writing SFD file "+sfdname);
@@ -243,6 +283,119 @@ string FontWriter::createFontFile (FontFormat format, const set<int> &charcodes,
 }
 
 
+/** Returns the path of the cache file holding the font data created from a given SFD.
+ *  Since the SFD completely describes the glyphs to be embedded, a font subset already
+ *  compressed on a previous page or in a previous run can be identified by its hash.
+ *  @param[in] format target font format
+ *  @param[in] sfd SFD data of the font subset
+ *  @return path of the cache file or an empty string if caching is disabled */
+string FontWriter::cacheFilePath (FontFormat format, const string &sfd) {
+	if (!PhysicalFont::CACHE_PATH)
+		return "";
+	string dirname = string(PhysicalFont::CACHE_PATH)+"/fonts";
+	if (!FileSystem::exists(dirname) && !FileSystem::mkdir(dirname))
+		return "";
+	auto hashFunc = HashFunction::create("xxh64", sfd);
+	hashFunc->update(string(PROGRAM_VERSION) + (AUTOHINT_FONTS ? "-ah" : ""));
+	return dirname+"/"+hashFunc->digestString()+"."+fontFormatInfo(format)->formatstr_short;
+}
+
+
+/** Returns a CSS font-face rule containing the given font data. */
+string FontWriter::cssFontFace (const string &fontname, FontFormat format, const string &fontdata) {
+	const FontFormatInfo *info = fontFormatInfo(format);
+	ostringstream oss;
+	oss << "@font-face{"
+		<< "font-family:" << fontname << ';'
+		<< "src:url(data:" << info->mimetype << ";base64,";
+	util::base64_copy(fontdata.begin(), fontdata.end(), ostreambuf_iterator<char>(oss));
+	oss << ") format('" << info->formatstr_long << "');}\n";
+	return oss.str();
+}
+
+
+/** Creates a CSS font-face rule that contains the WOFF/TTF font data. The SFD and TTF data
+ *  are created immediately, while the WOFF/WOFF2 compression, which is usually the most
+ *  time-consuming step, runs in a separate thread if possible. Font data already
+ *  created in a previous run is taken from the cache.
+ *  @param[in] format target font format
+ *  @param[in] charcodes character codes of the glyphs to be considered
+ *  @param[in] cb callback object that allows to react to events triggered by the glyph tracer
+ *  @return future providing the CSS font-face rule (empty if the format is not supported) */
+future<string> FontWriter::createCSSFontFace (FontFormat format, const set<int> &charcodes, GFGlyphTracer::Callback *cb) const {
+	promise<string> css;
+	if (format != FontFormat::TTF && format != FontFormat::WOFF && format != FontFormat::WOFF2) {
+		css.set_value("");
+		return css.get_future();
+	}
+	ostringstream sfd;
+	writeSFD(sfd, _font, charcodes, cb);
+	string cachepath = cacheFilePath(format, sfd.str());
+	if (!cachepath.empty() && FileSystem::exists(cachepath)) {
+		string fontdata = util::read_file_contents(cachepath);
+		if (!fontdata.empty()) {
+			css.set_value(cssFontFace(_font.name(), format, fontdata));
+			return css.get_future();
+		}
+	}
+	string basename = FileSystem::tmpdir()+_font.name()+"-tmp";
+	string sfdname = basename+".sfd";
+	string ttfname = basename+".ttf";
+	ofstream sfdfile(sfdname);
+	sfdfile << sfd.str();
+	sfdfile.close();
+	if (sfdfile.fail())
+		throw FontWriterException("failed writing SFD file "+sfdname);
+	bool ok = createTTFFile(sfdname, ttfname);
+	if (!PhysicalFont::KEEP_TEMP_FILES)
+		FileSystem::remove(sfdname);
+	if (!ok)
+		throw FontWriterException("failed writing ttf file "+ttfname);
+	auto ttf = make_shared<TrueTypeFont>(ttfname);
+	string fontdata;
+	if (format == FontFormat::TTF)
+		fontdata = util::read_file_contents(ttfname);
+	if (!PhysicalFont::KEEP_TEMP_FILES)
+		FileSystem::remove(ttfname);
+	string fontname = _font.name();
+	auto compress = [=]() {
+		string data = fontdata;
+		if (format != FontFormat::TTF) {
+			ostringstream oss;
+			if (format == FontFormat::WOFF)
+				ttf->writeWOFF(oss);
+			else if (!ttf->writeWOFF2(oss))
+				throw FontWriterException("failed creating woff2 data of font '"+fontname+"'");
+			data = oss.str();
+		}
+		if (!cachepath.empty()) {
+			// write to a temporary file of a unique name first to prevent other processes
+			// from reading incomplete data or writing to the same file
+			string tmppath = FileSystem::createUniqueFile(cachepath+".tmp");
+			if (!tmppath.empty()) {
+				ofstream ofs(tmppath, ios::binary);
+				ofs << data;
+				ofs.close();
+				if (ofs.fail() || !FileSystem::rename(tmppath, cachepath))
+					FileSystem::remove(tmppath);
+			}
+		}
+		return cssFontFace(fontname, format, data);
+	};
+	if (format == FontFormat::TTF) {
+		css.set_value(compress());
+		return css.get_future();
+	}
+	try {
+		return async(launch::async, compress);
+	}
+	catch (system_error&) {
+		// threads not available: compress the data when the result is requested
+		return async(launch::deferred, compress);
+	}
+}
+
+
 /** Writes a CSS font-face rule to an output stream that references or contains the WOFF/TTF font data.
  * @param[in] format target font format
  * @param[in] charcodes character codes of the glyphs to be considered
@@ -250,22 +403,9 @@ string FontWriter::createFontFile (FontFormat format, const set<int> &charcodes,
  * @param[in] cb callback object that allows to react to events triggered by the glyph tracer
  * @return true on success */
 bool FontWriter::writeCSSFontFace (FontFormat format, const set<int> &charcodes, ostream &os, GFGlyphTracer::Callback *cb) const {
-	if (const FontFormatInfo *info = fontFormatInfo(format)) {
-		string filename = createFontFile(format, charcodes, cb);
-		ifstream ifs(filename, ios::binary);
-		if (ifs) {
-			os << "@font-face{"
-				<< "font-family:" << _font.name() << ';'
-				<< "src:url(data:" << info->mimetype << ";base64,";
-			util::base64_copy(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>(), ostreambuf_iterator<char>(os));
-			os << ") format('" << info->formatstr_long << "');}\n";
-			ifs.close();
-			if (!PhysicalFont::KEEP_TEMP_FILES)
-				FileSystem::remove(filename);
-			return true;
-		}
-	}
-	return false;
+	string css = createCSSFontFace(format, charcodes, cb).get();
+	os << css;
+	return !css.empty();
 }
 
 #endif // !DISABLE_WOFF
@@ -21,6 +21,7 @@
 #ifndef FONTWRITER_HPP
 #define FONTWRITER_HPP
 
+#include <future>
 #include <ostream>
 #include <set>
 #include <string>
@@ -38,9 +39,11 @@ class FontWriter {
 	public:
 		FontWriter (const PhysicalFont &font);
 		std::string createFontFile (FontFormat format, const std::set<int> &charcodes, GFGlyphTracer::Callback *cb=0) const;
+		std::future<std::string> createCSSFontFace (FontFormat format, const std::set<int> &charcodes, GFGlyphTracer::Callback *cb=0) const;
 		bool writeCSSFontFace (FontFormat format, const std::set<int> &charcodes, std::ostream &os, GFGlyphTracer::Callback *cb=0) const;
 		static FontFormat toFontFormat (std::string formatstr);
 		static std::vector<std::string> supportedFormats ();
+		static void purgeCache (const std::string &dirname, std::ostream &os);
 
 	protected:
 		struct FontFormatInfo {
@@ -51,6 +54,8 @@ class FontWriter {
 		};
 		static const FontFormatInfo* fontFormatInfo (FontFormat format);
 		bool createTTFFile (const std::string &sfdname, const std::string &ttfname) const;
+		static std::string cacheFilePath (FontFormat format, const std::string &sfd);
+		static std::string cssFontFace (const std::string &fontname, FontFormat format, const std::string &fontdata);
 
 	private:
 		const PhysicalFont &_font;
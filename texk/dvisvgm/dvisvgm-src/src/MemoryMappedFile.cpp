@@ -0,0 +1,107 @@
+/*************************************************************************
+** MemoryMappedFile.cpp                                                 **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#include <config.h>
+#ifdef _WIN32
+	#include "windows.hpp"
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include "MemoryMappedFile.hpp"
+
+using namespace std;
+
+
+/** Maps a file into memory. A previously mapped file is released.
+ *  @param[in] fname name of file to map
+ *  @return true on success */
+bool MemoryMappedFile::open (const string &fname) {
+	close();
+#ifdef _WIN32
+	HANDLE fh = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fh == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER filesize;
+	if (!GetFileSizeEx(fh, &filesize)) {
+		CloseHandle(fh);
+		return false;
+	}
+	_fileHandle = fh;
+	_size = size_t(filesize.QuadPart);
+	if (_size > 0) {
+		HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mh) {
+			close();
+			return false;
+		}
+		_mapHandle = mh;
+		_data = static_cast<const char*>(MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0));
+		if (!_data) {
+			close();
+			return false;
+		}
+	}
+#else
+	int fd = ::open(fname.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		::close(fd);
+		return false;
+	}
+	_size = size_t(st.st_size);
+	if (_size > 0) {
+		void *addr = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED) {
+			::close(fd);
+			_size = 0;
+			return false;
+		}
+		_data = static_cast<const char*>(addr);
+	}
+	::close(fd);  // the mapping remains valid after closing the file descriptor
+#endif
+	_isOpen = true;
+	return true;
+}
+
+
+/** Releases the memory mapping. */
+void MemoryMappedFile::close () {
+#ifdef _WIN32
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapHandle)
+		CloseHandle(_mapHandle);
+	if (_fileHandle)
+		CloseHandle(_fileHandle);
+	_mapHandle = _fileHandle = nullptr;
+#else
+	if (_data)
+		munmap(const_cast<char*>(_data), _size);
+#endif
+	_data = nullptr;
+	_size = 0;
+	_isOpen = false;
+}
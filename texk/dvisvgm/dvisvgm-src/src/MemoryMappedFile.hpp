@@ -0,0 +1,51 @@
+/*************************************************************************
+** MemoryMappedFile.hpp                                                 **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#ifndef MEMORYMAPPEDFILE_HPP
+#define MEMORYMAPPEDFILE_HPP
+
+#include <string>
+
+/** Provides read-only access to the contents of a file by mapping it into memory.
+ *  The mapping is shared, i.e. concurrent readers of the same file don't need
+ *  to load its contents separately. */
+class MemoryMappedFile {
+	public:
+		MemoryMappedFile () =default;
+		explicit MemoryMappedFile (const std::string &fname) {open(fname);}
+		MemoryMappedFile (const MemoryMappedFile &mmf) =delete;
+		~MemoryMappedFile () {close();}
+		bool open (const std::string &fname);
+		void close ();
+		bool isOpen () const      {return _isOpen;}
+		const char* data () const {return _data;}
+		size_t size () const      {return _size;}
+
+	private:
+		const char *_data=nullptr;  ///< pointer to the mapped file contents
+		size_t _size=0;             ///< number of mapped bytes
+		bool _isOpen=false;
+#ifdef _WIN32
+		void *_fileHandle=nullptr;
+		void *_mapHandle=nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*************************************************************************
+** MemoryPool.hpp                                                       **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#ifndef MEMORYPOOL_HPP
+#define MEMORYPOOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/** Allocator for memory blocks of a fixed size. The blocks are taken from larger chunks
+ *  that are allocated on demand. Released blocks are kept in a free list and handed out
+ *  again by subsequent allocations, so that objects frequently created and destroyed
+ *  don't cause separate heap allocations. The chunks are only returned to the heap
+ *  when the pool is destroyed. The pool is not thread-safe.
+ *  @tparam BLOCK_SIZE size of the memory blocks in bytes
+ *  @tparam BLOCKS_PER_CHUNK number of blocks allocated at once */
+template <size_t BLOCK_SIZE, size_t BLOCKS_PER_CHUNK=1024>
+class MemoryPool {
+	union Block {
+		Block *next;  ///< next free block
+		alignas(std::max_align_t) char data[BLOCK_SIZE];
+	};
+
+	public:
+		MemoryPool () =default;
+		MemoryPool (const MemoryPool &pool) =delete;
+
+		/** Returns a pointer to an unused memory block of size BLOCK_SIZE. */
+		void* allocate () {
+			if (!_freeList) {
+				_chunks.emplace_back(new Block[BLOCKS_PER_CHUNK]);
+				Block *chunk = _chunks.back().get();
+				for (size_t i=0; i < BLOCKS_PER_CHUNK-1; i++)
+					chunk[i].next = &chunk[i+1];
+				chunk[BLOCKS_PER_CHUNK-1].next = nullptr;
+				_freeList = chunk;
+			}
+			Block *block = _freeList;
+			_freeList = block->next;
+			return block;
+		}
+
+		/** Gives a block back to the pool so that it can be reused.
+		 *  @param[in] ptr pointer to a block previously returned by allocate() */
+		void release (void *ptr) {
+			if (ptr) {
+				Block *block = static_cast<Block*>(ptr);
+				block->next = _freeList;
+				_freeList = block;
+			}
+		}
+
+		/** Returns the total number of blocks managed by the pool. */
+		size_t capacity () const {return _chunks.size()*BLOCKS_PER_CHUNK;}
+
+	private:
+		std::vector<std::unique_ptr<Block[]>> _chunks;
+		Block *_freeList=nullptr;
+};
+
+#endif
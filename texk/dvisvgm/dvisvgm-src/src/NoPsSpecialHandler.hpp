@@ -29,6 +29,7 @@ class NoPsSpecialHandler : public SpecialHandler {
 		bool process (const std::string &prefix, std::istream &is, SpecialActions &actions) override;
 		const char* name () const override {return 0;}
 		const char* info () const override {return 0;}
+		bool carriesPageState () const override {return false;}
 		std::vector<const char*> prefixes() const override;
 
 	protected:
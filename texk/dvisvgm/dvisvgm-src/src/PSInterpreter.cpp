@@ -19,16 +19,18 @@
 *************************************************************************/
 
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
 #include "FileFinder.hpp"
-#include "InputReader.hpp"
 #include "Message.hpp"
 #include "PSFilter.hpp"
 #include "PSInterpreter.hpp"
 #include "SignalHandler.hpp"
+#include "System.hpp"
 
 using namespace std;
 
@@ -118,6 +120,7 @@ bool PSInterpreter::execute (const char *str, size_t len, bool flush) {
 		return complete;
 	}
 
+	double t = _collectStats ? System::time() : 0;
 	// feed Ghostscript with code chunks that are not larger than 64KB
 	// => see documentation of gsapi_run_string_foo()
 	const char *p=str;
@@ -138,6 +141,10 @@ bool PSInterpreter::execute (const char *str, size_t len, bool flush) {
 		// force writing contents of output buffer
 		_gs.run_string_continue("\nflush ", 7, 0, &status);
 	}
+	if (_collectStats) {
+		_stats.gsTime += System::time()-t;
+		_stats.executions++;
+	}
 	return complete;
 }
 
@@ -204,20 +211,27 @@ int GSDLLCALL PSInterpreter::output (void *inst, const char *buf, int len) {
 			vector<char> &linebuf = self->_linebuf;  // just a shorter name...
 			if ((*last == '\n' || !self->active()) || self->_inError) {
 				if (linelength + linebuf.size() > 1) {  // prefix "dvi." plus final newline
-					SplittedCharInputBuffer ib(linebuf.empty() ? 0 : &linebuf[0], linebuf.size(), first, linelength);
-					BufferInputReader in(ib);
 					if (self->_inError)
 						self->_errorMessage += string(first, linelength);
 					else {
-						in.skipSpace();
-						if (in.check("Unrecoverable error: ")) {
-							self->_errorMessage.clear();
-							while (!in.eof())
-								self->_errorMessage += in.get();
+						// join the line parts and evaluate the resulting zero-terminated string in place
+						linebuf.insert(linebuf.end(), first, last+1);
+						linebuf.push_back('\0');
+						const char *p = &linebuf[0];
+						while (isspace(static_cast<unsigned char>(*p)))
+							p++;
+						if (strncmp(p, "Unrecoverable error: ", 21) == 0) {
+							self->_errorMessage = p+21;
 							self->_inError = true;
 						}
-						else if (in.check("dvi."))
-							self->callActions(in);
+						else if (strncmp(p, "dvi.", 4) == 0) {
+							double t = self->_collectStats ? System::time() : 0;
+							self->callActions(p+4, &linebuf.back());
+							if (self->_collectStats) {
+								self->_stats.callbackTime += System::time()-t;
+								self->_stats.callbacks++;
+							}
+						}
 					}
 				}
 				linebuf.clear();
@@ -226,11 +240,8 @@ int GSDLLCALL PSInterpreter::output (void *inst, const char *buf, int len) {
 				// save remaining characters and prepend them to the next incoming chunk of characters
 				if (linebuf.size() + linelength > MAXLEN)
 					linebuf.clear();   // don't care for long lines
-				else {
-					size_t currsize = linebuf.size();
-					linebuf.resize(currsize+linelength);
-					memcpy(&linebuf[currsize], first, linelength);
-				}
+				else
+					linebuf.insert(linebuf.end(), first, last+1);
 			}
 		}
 	}
@@ -238,10 +249,27 @@ int GSDLLCALL PSInterpreter::output (void *inst, const char *buf, int len) {
 }
 
 
+static const char* skip_space (const char *p) {
+	while (isspace(static_cast<unsigned char>(*p)))
+		p++;
+	return p;
+}
+
+
+/** Returns a pointer to the first character following the string token starting at p. */
+static const char* skip_token (const char *p) {
+	while (*p && !isspace(static_cast<unsigned char>(*p)) && isprint(static_cast<unsigned char>(*p)))
+		p++;
+	return p;
+}
+
+
 /** Evaluates a command emitted by Ghostscript and invokes the corresponding
- *  method of interface class PSActions.
- *  @param[in] in reader pointing to the next command */
-void PSInterpreter::callActions (InputReader &in) {
+ *  method of interface class PSActions. The operands are converted directly from
+ *  the received character data without creating intermediate string objects.
+ *  @param[in] first pointer to the first character of the command
+ *  @param[in] last pointer to the terminating zero byte of the command */
+void PSInterpreter::callActions (const char *first, const char *last) {
 	struct Operator {
 		int pcount;       // number of parameters (< 0 : variable number of parameters)
 		void (PSActions::*handler)(vector<double> &p);  // operation handler
@@ -289,39 +317,34 @@ void PSInterpreter::callActions (InputReader &in) {
 		{"translate",      { 2, &PSActions::translate}},
 	};
 	if (_actions) {
-		in.skipSpace();
-		auto it = operators.find(in.getWord());
+		const char *p = skip_space(first);
+		const char *q = p;
+		while (isalpha(static_cast<unsigned char>(*q)))
+			q++;
+		auto it = operators.find(string(p, q));
 		if (it != operators.end()) {
 			if (!it->second.handler) { // raw string data received?
 				_rawData.clear();
-				in.skipSpace();
-				while (!in.eof()) {
-					_rawData.emplace_back(in.getString());
-					in.skipSpace();
+				for (p=skip_space(q); p < last; p=skip_space(q)) {
+					q = skip_token(p);
+					_rawData.emplace_back(p, q);
 				}
 			}
 			else {
-				// collect parameters
-				vector<string> params;
+				// convert the parameters to doubles
+				vector<double> v;
 				int pcount = it->second.pcount;
-				if (pcount < 0) {       // variable number of parameters?
-					in.skipSpace();
-					while (!in.eof()) {  // read all available parameters
-						params.emplace_back(in.getString());
-						in.skipSpace();
-					}
-				}
-				else {   // fix number of parameters
-					for (int i=0; i < pcount; i++) {
-						in.skipSpace();
-						params.emplace_back(in.getString());
-					}
+				for (int i=0; pcount < 0 || i < pcount; i++) {
+					p = skip_space(q);
+					if (pcount < 0 && p == last)  // all available parameters read?
+						break;
+					char *numend;
+					double val = strtod(p, &numend);
+					if (numend == p)
+						throw PSException("invalid operand of operator '"+it->first+"' received");
+					v.push_back(val);
+					q = skip_token(numend);
 				}
-				// convert parameter strings to doubles
-				vector<double> v(params.size());
-				transform(params.begin(), params.end(), v.begin(), [](const string &str) {
-					return stod(str);
-				});
 				// call operator handler
 				(_actions->*it->second.handler)(v);
 				_actions->executed();
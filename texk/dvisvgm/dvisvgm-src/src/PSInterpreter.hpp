@@ -89,6 +89,15 @@ class PSFilter;
 class PSInterpreter {
 	enum Mode {PS_NONE, PS_RUNNING, PS_QUIT};
 
+	public:
+		/** Runtime statistics collected if enabled by collectStatistics(). */
+		struct Statistics {
+			unsigned executions=0;    ///< number of code chunks passed to Ghostscript
+			unsigned callbacks=0;     ///< number of operator callbacks received from Ghostscript
+			double gsTime=0;          ///< time in seconds spent inside Ghostscript (including the callbacks)
+			double callbackTime=0;    ///< time in seconds spent in the callback handlers
+		};
+
 	public:
 		explicit PSInterpreter (PSActions *actions=0);
 		PSInterpreter (const PSInterpreter &psi) =delete;
@@ -104,6 +113,8 @@ class PSInterpreter {
 		int pdfPageCount (const std::string &fname);
 		BoundingBox pdfPageBox (const std::string &fname, int pageno);
 		const std::vector<std::string>& rawData () const {return _rawData;}
+		void collectStatistics (bool collect)  {_collectStats = collect;}
+		const Statistics& statistics () const  {return _stats;}
 
 	protected:
 		void init ();
@@ -113,7 +124,7 @@ class PSInterpreter {
 		static int GSDLLCALL error (void *inst, const char *buf, int len);
 
 		void checkStatus (int status);
-		void callActions (InputReader &cib);
+		void callActions (const char *first, const char *last);
 
 	private:
 		Ghostscript _gs;
@@ -125,6 +136,8 @@ class PSInterpreter {
 		std::string _errorMessage;         ///< text of error message
 		bool _inError=false;               ///< true if scanning error message
 		bool _initialized=false;           ///< true if PSInterpreter has been completely initialized
+		bool _collectStats=false;          ///< true if runtime statistics are collected
+		Statistics _stats;                 ///< runtime statistics
 		std::vector<std::string> _rawData; ///< raw data received
 		static const char *PSDEFS;         ///< initial PostScript definitions
 };
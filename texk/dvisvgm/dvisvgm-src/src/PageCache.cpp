@@ -0,0 +1,133 @@
+/*************************************************************************
+** PageCache.cpp                                                        **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#include <config.h>
+#include <fstream>
+#include <sstream>
+#include "CRC32.hpp"
+#include "FileSystem.hpp"
+#include "PageCache.hpp"
+#include "StreamReader.hpp"
+#include "StreamWriter.hpp"
+#include "version.hpp"
+
+using namespace std;
+
+const uint8_t PageCache::FORMAT_VERSION = 1;
+
+
+/** Returns the path of the cache file assigned to a given page hash. */
+string PageCache::filepath (const string &hash) const {
+	return _dirname + "/" + hash + ".dpc";
+}
+
+
+/** Returns the position and length of the page number in the ID of the page element. */
+static pair<size_t,size_t> page_number_location (const string &svg, int pageno) {
+	string number = to_string(pageno);
+	size_t pos = svg.find("<g id='page"+number+"'");
+	if (pos == string::npos)
+		return {string::npos, 0};
+	return {pos+11, number.length()};
+}
+
+
+/** Writes a converted page to the cache. If an entry for the given hash already exists,
+ *  it's replaced.
+ *  Format: "DPC" version[1] crc32[4] dvisvgm-version[n] numdeps[2] deps[...] numpos[4] numlen[1] svglen[4] svg[svglen]
+ *  @param[in] hash combined hash of the DVI page data and the command-line options
+ *  @param[in] pageno number assigned to the page element
+ *  @param[in] svg the SVG document of the page
+ *  @param[in] deps identifiers of the fonts the page depends on
+ *  @return true on success */
+bool PageCache::write (const string &hash, int pageno, const string &svg, const Dependencies &deps) const {
+	if (!FileSystem::exists(_dirname) && !FileSystem::mkdir(_dirname))
+		return false;
+	ostringstream oss;
+	StreamWriter sw(oss);
+	sw.writeString(PROGRAM_VERSION, true);
+	sw.writeUnsigned(deps.size(), 2);
+	for (const string &dep : deps)
+		sw.writeString(dep, true);
+	auto location = page_number_location(svg, pageno);
+	sw.writeUnsigned(location.first == string::npos ? 0xffffffff : location.first, 4);
+	sw.writeUnsigned(location.second, 1);
+	sw.writeUnsigned(svg.length(), 4);
+	sw.writeString(svg);
+	string data = oss.str();
+
+	// Write to a temporary file first and rename it afterwards, so that concurrent
+	// processes never read a partially written entry.
+	string path = filepath(hash);
+	string tmppath = FileSystem::createUniqueFile(path+".tmp");
+	if (tmppath.empty())
+		return false;
+	ofstream ofs(tmppath, ios::binary);
+	StreamWriter fsw(ofs);
+	fsw.writeString("DPC");
+	fsw.writeUnsigned(FORMAT_VERSION, 1);
+	fsw.writeUnsigned(CRC32::compute(reinterpret_cast<const uint8_t*>(data.data()), data.length()), 4);
+	fsw.writeString(data);
+	ofs.close();
+	if (!ofs || !FileSystem::rename(tmppath, path)) {
+		FileSystem::remove(tmppath);
+		return false;
+	}
+	return true;
+}
+
+
+/** Reads a page from the cache.
+ *  @param[in] hash combined hash of the DVI page data and the command-line options
+ *  @param[in] pageno number to be assigned to the page element
+ *  @param[out] svg the SVG document of the page
+ *  @param[out] deps identifiers of the fonts the page depends on
+ *  @return true if a valid entry was found */
+bool PageCache::read (const string &hash, int pageno, string &svg, Dependencies &deps) const {
+	ifstream ifs(filepath(hash), ios::binary);
+	if (!ifs)
+		return false;
+	StreamReader sr(ifs);
+	if (sr.readString(3) != "DPC" || sr.readUnsigned(1) != FORMAT_VERSION)
+		return false;
+	uint32_t crc32 = sr.readUnsigned(4);
+	ostringstream oss;
+	oss << ifs.rdbuf();
+	string data = oss.str();
+	if (CRC32::compute(reinterpret_cast<const uint8_t*>(data.data()), data.length()) != crc32)
+		return false;
+
+	istringstream iss(data);
+	sr.replaceStream(iss);
+	if (sr.readString() != PROGRAM_VERSION)  // entries created by other versions of dvisvgm are outdated
+		return false;
+	deps.clear();
+	for (uint32_t numdeps = sr.readUnsigned(2); numdeps > 0; numdeps--)
+		deps.emplace_back(sr.readString());
+	uint32_t numpos = sr.readUnsigned(4);
+	uint32_t numlen = sr.readUnsigned(1);
+	uint32_t svglen = sr.readUnsigned(4);
+	svg = sr.readString(svglen);
+	if (!iss)
+		return false;
+	if (numpos != 0xffffffff && numpos+numlen <= svg.length())
+		svg.replace(numpos, numlen, to_string(pageno));
+	return true;
+}
@@ -0,0 +1,49 @@
+/*************************************************************************
+** PageCache.hpp                                                        **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#ifndef PAGECACHE_HPP
+#define PAGECACHE_HPP
+
+#include <string>
+#include <vector>
+
+/** Persistent cache of converted DVI pages. Each entry is stored in a separate file named
+ *  after the combined hash of the DVI page data and the command-line options affecting
+ *  the SVG output. Besides the SVG document, an entry records the fonts the page depends on
+ *  so that an entry can be rejected if one of these fonts has changed since it was created.
+ *  Since the ID of the page element depends on the number of pages converted before, the
+ *  page number is stored separately and replaced when reading an entry. */
+class PageCache {
+	public:
+		using Dependencies = std::vector<std::string>;
+
+	public:
+		explicit PageCache (const std::string &dirname) : _dirname(dirname) {}
+		bool read (const std::string &hash, int pageno, std::string &svg, Dependencies &deps) const;
+		bool write (const std::string &hash, int pageno, const std::string &svg, const Dependencies &deps) const;
+		std::string filepath (const std::string &hash) const;
+		const std::string& dirname () const {return _dirname;}
+
+	private:
+		static const uint8_t FORMAT_VERSION;
+		std::string _dirname;
+};
+
+#endif
@@ -35,6 +35,7 @@ class PapersizeSpecialHandler : public SpecialHandler {
 		bool process (const std::string &prefix, std::istream &is, SpecialActions &actions) override;
 		const char* info () const override {return "special to set the page size";}
 		const char* name () const override {return "papersize";}
+		bool carriesPageState () const override {return false;}
 		std::vector<const char*> prefixes() const override;
 		void storePaperSize (unsigned pageno, Length width, Length height);
 		void reset () {_pageSizes.clear();}
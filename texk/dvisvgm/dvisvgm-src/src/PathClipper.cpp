@@ -19,6 +19,7 @@
 *************************************************************************/
 
 #include "Bezier.hpp"
+#include "BoundedCache.hpp"
 #include "PathClipper.hpp"
 
 using namespace std;
@@ -311,13 +312,158 @@ inline PolyFillType polyFillType (CurvedPath::WindingRule wr) {
 }
 
 
-/** Computes the intersection of to curved paths.
+/** Cache of previously computed intersections. Documents often apply the same
+ *  clipping paths repeatedly, e.g. on every page of a presentation. */
+using IntersectionCache = BoundedCache<CurvedPath>;
+
+
+/** Checks whether a path describes a single axis-aligned rectangle.
+ *  @param[in] path path to check
+ *  @param[out] rect the rectangle described by the path
+ *  @return true if the path is a rectangle */
+static bool is_rectangle (const CurvedPath &path, BoundingBox &rect) {
+	struct RectActions : CurvedPath::Actions {
+		void moveto (const CurvedPath::Point &p) override {
+			if (points.empty())
+				points.push_back(p);
+			else
+				failed = true;  // more than one subpath
+		}
+		void lineto (const CurvedPath::Point &p) override {
+			if (points.empty() || closed)
+				failed = true;
+			else if (p != points.back())
+				points.push_back(p);
+		}
+		void conicto (const CurvedPath::Point &p1, const CurvedPath::Point &p2) override {failed = true;}
+		void cubicto (const CurvedPath::Point &p1, const CurvedPath::Point &p2, const CurvedPath::Point &p3) override {failed = true;}
+		void closepath () override {closed = true;}
+		bool quit () override {return failed || points.size() > 5;}
+		vector<CurvedPath::Point> points;
+		bool closed=false;
+		bool failed=false;
+	} actions;
+	path.iterate(actions, false);
+	vector<CurvedPath::Point> &points = actions.points;
+	if (points.size() == 5 && points.front() == points.back())
+		points.pop_back();
+	if (actions.failed || points.size() != 4)
+		return false;
+	rect = BoundingBox();
+	for (const CurvedPath::Point &p : points)
+		rect.embed(p);
+	if (rect.width() == 0 || rect.height() == 0)
+		return false;
+	// all vertices must be corners of the box and all edges must be axis-aligned
+	for (size_t i=0; i < 4; i++) {
+		const CurvedPath::Point &p = points[i], &q = points[(i+1)%4];
+		if ((p.x() != rect.minX() && p.x() != rect.maxX()) || (p.y() != rect.minY() && p.y() != rect.maxY()))
+			return false;
+		if ((p.x() == q.x()) == (p.y() == q.y()))
+			return false;
+	}
+	return true;
+}
+
+
+/** Returns true if box2 lies completely inside box1. */
+static bool contains (const BoundingBox &box1, const BoundingBox &box2) {
+	return box1.minX() <= box2.minX() && box1.maxX() >= box2.maxX()
+		&& box1.minY() <= box2.minY() && box1.maxY() >= box2.maxY();
+}
+
+
+/** Computes the intersection of two paths without polygon clipping if possible.
+ *  This applies to paths with disjoint bounding boxes, to pairs of axis-aligned
+ *  rectangles, and to rectangles enclosing the other path. The latter simply
+ *  results in an unmodified copy of the enclosed path.
+ *  @param[in] p1 first curved path
+ *  @param[in] p2 second curved path
+ *  @param[out] result intersection of p1 and p2
+ *  @return true if the intersection was computed */
+bool PathClipper::intersectTrivial (const CurvedPath &p1, const CurvedPath &p2, CurvedPath &result) const {
+	BoundingBox bbox1, bbox2;
+	p1.computeBBox(bbox1);
+	p2.computeBBox(bbox2);
+	BoundingBox commonBox = bbox1;
+	// The bounding boxes enclose all control points and thus the paths too.
+	// If the boxes don't overlap (or only touch), the intersection is empty.
+	if (!commonBox.intersect(bbox2) || commonBox.width() <= 0 || commonBox.height() <= 0)
+		return true;
+	BoundingBox rect1, rect2;
+	bool isRect1 = is_rectangle(p1, rect1);
+	bool isRect2 = is_rectangle(p2, rect2);
+	if (isRect1 && isRect2) {
+		result.moveto(commonBox.minX(), commonBox.minY());
+		result.lineto(commonBox.maxX(), commonBox.minY());
+		result.lineto(commonBox.maxX(), commonBox.maxY());
+		result.lineto(commonBox.minX(), commonBox.maxY());
+		result.closepath();
+		return true;
+	}
+	// the enclosed path can only be taken over if its fill rule is retained
+	if (isRect1 && p2.windingRule() == result.windingRule() && contains(rect1, bbox2)) {
+		append(p2, result);
+		return true;
+	}
+	if (isRect2 && p1.windingRule() == result.windingRule() && contains(rect2, bbox1)) {
+		append(p1, result);
+		return true;
+	}
+	return false;
+}
+
+
+/** Appends the commands of a path to another one. */
+void PathClipper::append (const CurvedPath &path, CurvedPath &result) {
+	result._commands.insert(result._commands.end(), path._commands.begin(), path._commands.end());
+}
+
+
+/** Returns a key that uniquely identifies the intersection of two paths. */
+string PathClipper::cacheKey (const CurvedPath &p1, const CurvedPath &p2) {
+	string key;
+	for (const CurvedPath *path : {&p1, &p2}) {
+		key += (path->windingRule() == CurvedPath::WindingRule::NON_ZERO ? 'n' : 'e');
+		for (const CurvedPath::Command &cmd : path->_commands) {
+			key += char(cmd.type);
+			for (int i=0; i < cmd.numParams(); i++) {
+				double coords[2] = {cmd.params[i].x(), cmd.params[i].y()};
+				key.append(reinterpret_cast<const char*>(coords), sizeof(coords));
+			}
+		}
+	}
+	return key;
+}
+
+
+/** Computes the intersection of to curved paths. Previously computed
+ *  intersections are taken from a cache.
  *  @param[in] p1 first curved path
  *  @param[in] p2 second curved path
  *  @param[out] result intersection of p1 and p2 */
 void PathClipper::intersect (const CurvedPath &p1, const CurvedPath &p2, CurvedPath &result) {
-	if (p1.size() < 2 || p2.size() < 2)
+	if (p1.size() < 2 || p2.size() < 2 || intersectTrivial(p1, p2, result))
 		return;
+	string key = cacheKey(p1, p2);
+	static IntersectionCache cache;
+	if (const CurvedPath *cachedPath = cache.find(key))
+		append(*cachedPath, result);
+	else {
+		CurvedPath path(result.windingRule());
+		intersectPolygons(p1, p2, path);
+		append(path, result);
+		cache.insert(key, std::move(path));
+	}
+}
+
+
+/** Computes the intersection of to curved paths by approximating them with
+ *  polygons and reconstructing the curved segments afterwards.
+ *  @param[in] p1 first curved path
+ *  @param[in] p2 second curved path
+ *  @param[out] result intersection of p1 and p2 */
+void PathClipper::intersectPolygons (const CurvedPath &p1, const CurvedPath &p2, CurvedPath &result) {
 	Clipper clipper;
 	Polygons polygons;
 	flatten(p1, polygons);
@@ -41,6 +41,10 @@ class PathClipper
 		void intersect (const CurvedPath &p1, const CurvedPath &p2, CurvedPath &result);
 
 	protected:
+		bool intersectTrivial (const CurvedPath &p1, const CurvedPath &p2, CurvedPath &result) const;
+		void intersectPolygons (const CurvedPath &p1, const CurvedPath &p2, CurvedPath &result);
+		static void append (const CurvedPath &path, CurvedPath &result);
+		static std::string cacheKey (const CurvedPath &p1, const CurvedPath &p2);
 		void flatten (const CurvedPath &gp, ClipperLib::Paths &polygons);
 //		void divide (IntPoint &p1, IntPoint &p2, IntPoint &ip);
 		void reconstruct (const ClipperLib::Path &polygon, CurvedPath &path);
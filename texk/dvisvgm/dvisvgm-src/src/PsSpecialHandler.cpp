@@ -21,6 +21,7 @@
 #include <array>
 #include <cmath>
 #include <fstream>
+#include <iomanip>
 #include <memory>
 #include <sstream>
 #include "EPSFile.hpp"
@@ -43,6 +44,10 @@ bool PsSpecialHandler::COMPUTE_CLIPPATHS_INTERSECTIONS = false;
 bool PsSpecialHandler::SHADING_SEGMENT_OVERLAP = false;
 int PsSpecialHandler::SHADING_SEGMENT_SIZE = 20;
 double PsSpecialHandler::SHADING_SIMPLIFY_DELTA = 0.01;
+bool PsSpecialHandler::SHADING_ADAPTIVE = false;
+double PsSpecialHandler::SHADING_ADAPTIVE_TOLERANCE = 0.05;
+bool PsSpecialHandler::BATCH_SPECIALS = false;
+bool PsSpecialHandler::PRINT_STATISTICS = false;
 
 
 PsSpecialHandler::PsSpecialHandler () : _psi(this), _actions(), _previewFilter(_psi), _xmlnode(), _savenode()
@@ -60,6 +65,7 @@ PsSpecialHandler::~PsSpecialHandler () {
  *  PS specials. */
 void PsSpecialHandler::initialize () {
 	if (_psSection == PS_NONE) {
+		_psi.collectStatistics(PRINT_STATISTICS);
 		initgraphics();
 		// execute dvips prologue/header files
 		for (const char *fname : {"tex.pro", "texps.pro", "special.pro", "color.pro"})
@@ -164,6 +170,45 @@ void PsSpecialHandler::executeAndSync (istream &is, bool updatePos) {
 }
 
 
+/** Appends the code of a literal PS special to the code whose execution has been deferred.
+ *  Since literal specials don't change the DVI position, consecutive ones can be passed
+ *  to Ghostscript in a single chunk which saves the overhead of several interpreter calls.
+ *  The pending code is executed by flushPendingOutput() which is triggered before any
+ *  other content is added to the page.
+ *  @param[in] is stream to read the PS code from */
+void PsSpecialHandler::deferLiteralSpecial (istream &is) {
+	ostringstream oss;
+	if (_actions) {
+		// same as moveToDVIPos() and executeAndSync(is, false) but without executing the code
+		const double x = _actions->getX();
+		const double y = _actions->getY();
+		oss << '\n' << x << ' ' << y << " moveto ";
+		_currentpoint = DPair(x, y);
+	}
+	oss << "\n@beginspecial @setspecial ";
+	if (_actions && _actions->getColor() != _currentcolor) {
+		double r, g, b;
+		_actions->getColor().getRGB(r, g, b);
+		oss << '\n' << r << ' ' << g << ' ' << b << " setrgbcolor ";
+	}
+	_pendingCode += oss.str();
+	_pendingCode.append(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+	_pendingCode += "\n\n@endspecial ";
+	if (_pendingCode.length() > 0xffff)
+		flushPendingOutput();
+}
+
+
+/** Executes the code of literal specials collected by deferLiteralSpecial(). */
+void PsSpecialHandler::flushPendingOutput () {
+	if (!_pendingCode.empty()) {
+		string code = std::move(_pendingCode);
+		_pendingCode.clear();
+		_psi.execute(code);
+	}
+}
+
+
 void PsSpecialHandler::preprocess (const string &prefix, istream &is, SpecialActions &actions) {
 	initialize();
 	if (_psSection != PS_HEADERS)
@@ -193,7 +238,11 @@ bool PsSpecialHandler::process (const string &prefix, istream &is, SpecialAction
 	if (_psSection != PS_BODY)
 		enterBodySection();
 
-	if (prefix == "\"" || prefix == "pst:") {
+	bool literal = (prefix == "\"" || prefix == "pst:");
+	if (literal && BATCH_SPECIALS && !_previewFilter.active())
+		deferLiteralSpecial(is);
+	else if (literal) {
+		flushPendingOutput();
 		// read and execute literal PostScript code (isolated by a wrapping save/restore pair)
 		moveToDVIPos();
 		_psi.execute("\n@beginspecial @setspecial ");
@@ -201,6 +250,7 @@ bool PsSpecialHandler::process (const string &prefix, istream &is, SpecialAction
 		_psi.execute("\n@endspecial ");
 	}
 	else if (prefix == "psfile=" || prefix == "PSfile=" || prefix == "pdffile=") {
+		flushPendingOutput();
 		if (_actions) {
 			StreamInputReader in(is);
 			const string fname = in.getQuotedString(in.peek() == '"' ? "\"" : nullptr);
@@ -210,6 +260,7 @@ bool PsSpecialHandler::process (const string &prefix, istream &is, SpecialAction
 		}
 	}
 	else if (prefix == "ps::") {
+		flushPendingOutput();
 		if (_actions)
 			_actions->finishLine();  // reset DVI position on next DVI command
 		if (is.peek() == '[') {
@@ -237,6 +288,7 @@ bool PsSpecialHandler::process (const string &prefix, istream &is, SpecialAction
 		}
 	}
 	else { // ps: ... or PST: ...
+		flushPendingOutput();
 		if (_actions)
 			_actions->finishLine();
 		moveToDVIPos();
@@ -463,6 +515,22 @@ void PsSpecialHandler::dviEndPage (unsigned, SpecialActions &actions) {
 		initgraphics();  // reset graphics state to default values
 		_psSection = PS_HEADERS;
 	}
+	if (PRINT_STATISTICS) {
+		const PSInterpreter::Statistics &stats = _psi.statistics();
+		if (stats.executions > _pageStats.executions) {
+			// report the values collected since the previous page
+			double gsTime = stats.gsTime-_pageStats.gsTime;
+			double callbackTime = stats.callbackTime-_pageStats.callbackTime;
+			ostringstream oss;
+			oss << fixed << setprecision(1)
+				<< "\nPostScript: " << (stats.executions-_pageStats.executions) << " Ghostscript calls ("
+				<< (gsTime-callbackTime)*1000 << " ms), "
+				<< (stats.callbacks-_pageStats.callbacks) << " callbacks ("
+				<< callbackTime*1000 << " ms)";
+			Message::mstream() << oss.str();
+			_pageStats = stats;
+		}
+	}
 }
 
 ///////////////////////////////////////////////////////
@@ -1004,7 +1072,10 @@ void PsSpecialHandler::processSequentialPatchMesh (int shadingTypeID, ColorSpace
 			callback.patchSegment(outline, bgcolor);
 		}
 #endif
-		patch->approximate(SHADING_SEGMENT_SIZE, SHADING_SEGMENT_OVERLAP, SHADING_SIMPLIFY_DELTA, callback);
+		if (SHADING_ADAPTIVE)
+			patch->approximateAdaptive(SHADING_SEGMENT_SIZE, SHADING_SEGMENT_OVERLAP, SHADING_SIMPLIFY_DELTA, SHADING_ADAPTIVE_TOLERANCE, callback);
+		else
+			patch->approximate(SHADING_SEGMENT_SIZE, SHADING_SEGMENT_OVERLAP, SHADING_SIMPLIFY_DELTA, callback);
 		if (!_xmlnode) {
 			// update bounding box
 			BoundingBox bbox;
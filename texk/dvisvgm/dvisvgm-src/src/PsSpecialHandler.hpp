@@ -89,6 +89,8 @@ class PsSpecialHandler : public SpecialHandler, protected PSActions {
 		bool process (const std::string &prefix, std::istream &is, SpecialActions &actions) override;
 		void setDviScaleFactor (double dvi2bp) override {_previewFilter.setDviScaleFactor(dvi2bp);}
 		void enterBodySection ();
+		bool hasPendingOutput () const override {return !_pendingCode.empty();}
+		void flushPendingOutput () override;
 		PSInterpreter& psInterpreter () {return _psi;}
 
 	public:
@@ -96,12 +98,17 @@ class PsSpecialHandler : public SpecialHandler, protected PSActions {
 		static bool SHADING_SEGMENT_OVERLAP;
 		static int SHADING_SEGMENT_SIZE;
 		static double SHADING_SIMPLIFY_DELTA;
+		static bool SHADING_ADAPTIVE;
+		static double SHADING_ADAPTIVE_TOLERANCE;
+		static bool BATCH_SPECIALS;
+		static bool PRINT_STATISTICS;
 
 	protected:
 		void initialize ();
 		void initgraphics ();
 		void moveToDVIPos ();
 		void executeAndSync (std::istream &is, bool updatePos);
+		void deferLiteralSpecial (std::istream &is);
 		void processHeaderFile (const char *fname);
 		void imgfile (FileType type, const std::string &fname, const std::map<std::string,std::string> &attr);
 		void dviEndPage (unsigned pageno, SpecialActions &actions) override;
@@ -163,6 +170,8 @@ class PsSpecialHandler : public SpecialHandler, protected PSActions {
 		XMLElementNode *_xmlnode;   ///< if != 0, created SVG elements are appended to this node
 		XMLElementNode *_savenode;  ///< pointer to temporaryly store _xmlnode
 		std::string _headerCode;    ///< collected literal PS header code
+		std::string _pendingCode;   ///< code of literal specials whose execution has been deferred
+		PSInterpreter::Statistics _pageStats;  ///< statistics values at the end of the previous page
 		Path _path;
 		DPair _currentpoint;        ///< current PS position in bp units
 		Color _currentcolor;        ///< current stroke/fill color
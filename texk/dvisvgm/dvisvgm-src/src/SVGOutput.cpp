@@ -195,3 +195,10 @@ string SVGOutput::expandFormatString (string str, int page, int numPages, const
 bool SVGOutput::ignoresHashes () const {
 	return _stdout || (!_pattern.empty() && _pattern.find("%h") == string::npos);
 }
+
+
+/** Closes the output stream of the current page. */
+void SVGOutput::finish () {
+	_osptr.reset();
+	_page = -1;
+}
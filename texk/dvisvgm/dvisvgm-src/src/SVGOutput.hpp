@@ -48,6 +48,7 @@ struct SVGOutputBase {
 	virtual std::ostream& getPageStream (int page, int numPages, const HashTriple &hashes=HashTriple()) const =0;
 	virtual std::string filename (int page, int numPages, const HashTriple &hashes=HashTriple()) const =0;
 	virtual bool ignoresHashes () const {return true;}
+	virtual void finish () {}
 };
 
 
@@ -60,6 +61,7 @@ class SVGOutput : public SVGOutputBase {
 		std::ostream& getPageStream (int page, int numPages, const HashTriple &hash=HashTriple()) const override;
 		std::string filename (int page, int numPages, const HashTriple &hash=HashTriple()) const override;
 		bool ignoresHashes () const override;
+		void finish () override;
 
 	protected:
 		std::string expandFormatString (std::string str, int page, int numPages, const HashTriple &hashes) const;
@@ -20,7 +20,10 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <iterator>
 #include <sstream>
+#include <thread>
 #include "BoundingBox.hpp"
 #include "DependencyGraph.hpp"
 #include "DVIToSVG.hpp"
@@ -46,6 +49,10 @@ bool SVGTree::RELATIVE_PATH_CMDS=false;
 bool SVGTree::MERGE_CHARS=true;
 bool SVGTree::ADD_COMMENTS=false;
 double SVGTree::ZOOM_FACTOR=1.0;
+bool SVGTree::STREAM_PAGE_CONTENT=true;
+
+// minimal number of new page children required to trigger their serialization
+static const size_t PAGE_FLUSH_THRESHOLD=64;
 
 
 SVGTree::SVGTree () : _charHandler(SVGCharHandlerFactory::createHandler()) {
@@ -64,6 +71,11 @@ void SVGTree::reset () {
 	_doc.setRootNode(std::move(rootNode));
 	_page = _defs = nullptr;
 	_styleCDataNode = nullptr;
+	_pageContextElement = nullptr;
+	_serializedPageNode = nullptr;
+	_numPageChildren = 0;
+	_flushedClipPathIDs.clear();
+	_fontFaces.clear();
 }
 
 
@@ -120,6 +132,9 @@ void SVGTree::newPage (int pageno) {
 	_root->append(std::move(pageNode));
 	while (!_contextElementStack.empty())
 		_contextElementStack.pop();
+	_pageContextElement = nullptr;
+	_serializedPageNode = nullptr;
+	_numPageChildren = 0;
 }
 
 
@@ -134,6 +149,7 @@ void SVGTree::appendToDefs (unique_ptr<XMLNode> &&node) {
 
 
 void SVGTree::appendToPage (unique_ptr<XMLNode> &&node) {
+	flushPageContent();
 	XMLElementNode *parent = _contextElementStack.empty() ? _page : _contextElementStack.top();
 	parent->append(std::move(node));
 	_charHandler->setInitialContextNode(parent);
@@ -208,6 +224,7 @@ static string font_info (const Font &font) {
 
 
 void SVGTree::appendFontStyles (const unordered_set<const Font*> &fonts) {
+	appendFontFaces();
 	if (CREATE_CSS && USE_FONTS && !fonts.empty() && _page) {
 		map<int, const Font*> sortmap;
 		for (const Font *font : fonts)
@@ -246,10 +263,15 @@ void SVGTree::append (const PhysicalFont &font, const set<int> &chars, GFGlyphTr
 
 	if (USE_FONTS) {
 		if (FONT_FORMAT != FontWriter::FontFormat::SVG) {
-			ostringstream style;
+			// limit the number of font files compressed concurrently
+			auto pending = [](const future<string> &fontFace) {
+				return fontFace.wait_for(chrono::seconds(0)) == future_status::timeout;
+			};
+			size_t maxJobs = max(1u, thread::hardware_concurrency());
+			while (size_t(count_if(_fontFaces.begin(), _fontFaces.end(), pending)) >= maxJobs)
+				find_if(_fontFaces.begin(), _fontFaces.end(), pending)->wait();
 			FontWriter fontWriter(font);
-			if (fontWriter.writeCSSFontFace(FONT_FORMAT, chars, style, callback))
-				styleCDataNode()->append(style.str());
+			_fontFaces.emplace_back(fontWriter.createCSSFontFace(FONT_FORMAT, chars, callback));
 		}
 		else {
 			if (ADD_COMMENTS) {
@@ -299,9 +321,12 @@ void SVGTree::append (const PhysicalFont &font, const set<int> &chars, GFGlyphTr
 
 /** Pushes a new context element that will take all following nodes added to the page. */
 void SVGTree::pushContextElement (unique_ptr<XMLElementNode> &&node) {
+	flushPageContent();
 	XMLElementNode *nodePtr = node.get();
-	if (_contextElementStack.empty())
+	if (_contextElementStack.empty()) {
 		_page->append(std::move(node));
+		_pageContextElement = nodePtr;
+	}
 	else
 		_contextElementStack.top()->append(std::move(node));
 	_contextElementStack.push(nodePtr);
@@ -313,6 +338,8 @@ void SVGTree::pushContextElement (unique_ptr<XMLElementNode> &&node) {
 void SVGTree::popContextElement () {
 	if (!_contextElementStack.empty())
 		_contextElementStack.pop();
+	if (_contextElementStack.empty())
+		_pageContextElement = nullptr;
 	_charHandler->setInitialContextNode(_page);
 }
 
@@ -348,6 +375,8 @@ void SVGTree::removeRedundantElements () {
 		string idref = extract_id_from_url(elem->getAttributeValue("clip-path"));
 		idTree.removeDependencyPath(idref);
 	}
+	for (const string &idref : _flushedClipPathIDs)
+		idTree.removeDependencyPath(idref);
 	descendants.clear();
 	for (const string &str : idTree.getKeys()) {
 		XMLElementNode *node = _defs->getFirstDescendant("clipPath", "id", str.c_str());
@@ -356,6 +385,19 @@ void SVGTree::removeRedundantElements () {
 }
 
 
+/** Adds the CSS font-face rules of the fonts created by append() to the style element.
+ *  The rules are added in the order the fonts were appended, i.e. this method waits
+ *  until all fonts still being created are finished. */
+void SVGTree::appendFontFaces () {
+	for (future<string> &fontFace : _fontFaces) {
+		string css = fontFace.get();
+		if (!css.empty())
+			styleCDataNode()->append(std::move(css));
+	}
+	_fontFaces.clear();
+}
+
+
 XMLCDataNode* SVGTree::styleCDataNode () {
 	if (!_styleCDataNode) {
 		auto styleNode = util::make_unique<XMLElementNode>("style");
@@ -367,3 +409,60 @@ XMLCDataNode* SVGTree::styleCDataNode () {
 	}
 	return _styleCDataNode;
 }
+
+
+/** Replaces the completed child nodes of the page element by their serialized XML
+ *  representation. This way, the memory occupied by the subtrees of these nodes can
+ *  be released early which considerably reduces the size of the SVG tree if a page
+ *  consists of a large number of elements. Nodes that might still be extended, i.e. the
+ *  most recently appended child and the outermost context element, are left untouched.
+ *  The same applies to nodes prepended to the page after the first serialization. */
+void SVGTree::flushPageContent () {
+	if (!STREAM_PAGE_CONTENT || !_page || _page->children().size() < _numPageChildren+PAGE_FLUSH_THRESHOLD)
+		return;
+	const XMLElementNode::ChildList &children = _page->children();
+	auto first = children.begin();
+	if (_serializedPageNode) {
+		while (first->get() != _serializedPageNode)
+			++first;
+		++first;
+	}
+	else {
+		// the serialized sequence must start with a non-text node
+		while (first != children.end() && dynamic_cast<XMLTextNode*>(first->get()))
+			++first;
+	}
+	const XMLNode *openNode = _pageContextElement ? _pageContextElement : children.back().get();
+	auto last = first;
+	while (last != children.end() && last->get() != openNode)
+		++last;
+	// the serialized sequence must end with a non-text node
+	while (last != first && dynamic_cast<XMLTextNode*>(prev(last)->get()))
+		--last;
+	if (first == last) {
+		_numPageChildren = children.size();
+		return;
+	}
+	vector<XMLNode*> nodes;
+	for (auto it=first; it != last; ++it)
+		nodes.push_back(it->get());
+	if (!_serializedPageNode) {
+		auto serializedNode = util::make_unique<XMLSerializedNode>();
+		_serializedPageNode = serializedNode.get();
+		_page->insertBefore(std::move(serializedNode), nodes.front());
+	}
+	for (XMLNode *node : nodes) {
+		// keep track of the referenced clip paths required by removeRedundantElements()
+		if (auto elem = dynamic_cast<XMLElementNode*>(node)) {
+			vector<XMLElementNode*> descendants;
+			if (elem->hasAttribute("clip-path"))
+				descendants.push_back(elem);
+			elem->getDescendants(nullptr, "clip-path", descendants);
+			for (const XMLElementNode *descendant : descendants)
+				_flushedClipPathIDs.insert(extract_id_from_url(descendant->getAttributeValue("clip-path")));
+		}
+		_serializedPageNode->append(*node);
+		_page->remove(node);
+	}
+	_numPageChildren = children.size();
+}
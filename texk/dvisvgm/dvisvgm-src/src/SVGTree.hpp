@@ -21,11 +21,13 @@
 #ifndef SVGTREE_HPP
 #define SVGTREE_HPP
 
+#include <future>
 #include <map>
 #include <memory>
 #include <set>
 #include <stack>
 #include <unordered_set>
+#include <vector>
 #include "Color.hpp"
 #include "FontWriter.hpp"
 #include "GFGlyphTracer.hpp"
@@ -51,7 +53,7 @@ class SVGTree {
 		void prependToPage (std::unique_ptr<XMLNode> &&node);
 		void appendToDoc (std::unique_ptr<XMLNode> &&node)  {_doc.append(std::move(node));}
 		void appendToRoot (std::unique_ptr<XMLNode> &&node) {_root->append(std::move(node));}
-		void appendChar (int c, double x, double y) {_charHandler->appendChar(c, x, y);}
+		void appendChar (int c, double x, double y) {flushPageContent(); _charHandler->appendChar(c, x, y);}
 		void appendFontStyles (const std::unordered_set<const Font*> &fonts);
 		void append (const PhysicalFont &font, const std::set<int> &chars, GFGlyphTracer::Callback *callback=0);
 		void pushContextElement (std::unique_ptr<XMLElementNode> &&node);
@@ -72,6 +74,8 @@ class SVGTree {
 
 	protected:
 		XMLCDataNode* styleCDataNode ();
+		void flushPageContent ();
+		void appendFontFaces ();
 
 	public:
 		static bool USE_FONTS;           ///< if true, create font references and don't draw paths directly
@@ -82,6 +86,7 @@ class SVGTree {
 		static bool MERGE_CHARS;         ///< whether to merge chars with common properties into the same <text> tag
 		static bool ADD_COMMENTS;        ///< add comments with additional information
 		static double ZOOM_FACTOR;       ///< factor applied to width/height attribute
+		static bool STREAM_PAGE_CONTENT; ///< serialize completed page elements immediately rather than keeping them in the tree
 
 	private:
 		XMLDocument _doc;
@@ -89,6 +94,11 @@ class SVGTree {
 		XMLCDataNode *_styleCDataNode;
 		std::unique_ptr<SVGCharHandler> _charHandler;
 		std::stack<XMLElementNode*> _contextElementStack;
+		XMLElementNode *_pageContextElement;     ///< outermost context element (direct child of the page element)
+		XMLSerializedNode *_serializedPageNode;  ///< serialized representation of the completed page elements
+		size_t _numPageChildren;                 ///< number of page children present after the last flush
+		std::set<std::string> _flushedClipPathIDs;  ///< IDs of clip paths referenced by serialized page elements
+		std::vector<std::future<std::string>> _fontFaces;  ///< CSS font-face rules of fonts being created concurrently
 };
 
 #endif
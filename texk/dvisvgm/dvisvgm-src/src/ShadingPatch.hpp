@@ -42,6 +42,9 @@ class ShadingPatch {
 		virtual ~ShadingPatch () =default;
 		virtual int psShadingType () const =0;
 		virtual void approximate (int gridsize, bool overlap, double delta, Callback &callback) const =0;
+		virtual void approximateAdaptive (int gridsize, bool overlap, double delta, double tolerance, Callback &callback) const {
+			approximate(gridsize, overlap, delta, callback);
+		}
 		virtual void getBBox (BoundingBox &bbox) const =0;
 		virtual void getBoundaryPath (GraphicsPath<double> &path) const =0;
 		virtual void setPoints (const PointVec &points, int edgeflag, ShadingPatch *patch) =0;
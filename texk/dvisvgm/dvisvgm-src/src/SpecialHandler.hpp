@@ -50,6 +50,9 @@ class SpecialHandler {
 		virtual void dviBeginPage (unsigned pageno, SpecialActions &actions) {}
 		virtual void dviEndPage (unsigned pageno, SpecialActions &actions) {}
 		virtual void dviMovedTo (double x, double y, SpecialActions &actions) {}
+		virtual bool hasPendingOutput () const {return false;}  ///< true if the output of processed specials has been deferred
+		virtual void flushPendingOutput () {}                   ///< creates the deferred output
+		virtual bool carriesPageState () const {return true;}  ///< true if the specials may affect the output of subsequent pages
 };
 
 #endif
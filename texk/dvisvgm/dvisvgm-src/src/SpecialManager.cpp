@@ -40,6 +40,7 @@ SpecialManager& SpecialManager::instance() {
 void SpecialManager::unregisterHandlers () {
 	_handlerPool.clear();
 	_handlersByPrefix.clear();
+	_pendingHandler = nullptr;
 }
 
 
@@ -121,6 +122,17 @@ void SpecialManager::preprocess (const string &special, SpecialActions &actions)
 }
 
 
+/** Returns true if a special is evaluated by a handler whose state may carry over
+ *  to subsequent pages so that the special can affect their output too.
+ *  @param[in] special the special expression */
+bool SpecialManager::carriesPageState (const string &special) const {
+	istringstream iss(special);
+	if (SpecialHandler *handler = findHandlerByPrefix(extract_prefix(iss)))
+		return handler->carriesPageState();
+	return false;
+}
+
+
 /** Executes a special command.
  *  @param[in] special the special expression
  *  @param[in] dvi2bp factor to convert DVI units to PS points
@@ -132,13 +144,28 @@ bool SpecialManager::process (const string &special, double dvi2bp, SpecialActio
 	const string prefix = extract_prefix(iss);
 	bool success=false;
 	if (SpecialHandler *handler = findHandlerByPrefix(prefix)) {
+		if (handler != _pendingHandler)
+			flushPendingOutput();
 		handler->setDviScaleFactor(dvi2bp);
 		success = handler->process(prefix, iss, actions);
+		_pendingHandler = handler->hasPendingOutput() ? handler : nullptr;
 	}
 	return success;
 }
 
 
+/** Lets the special handler that deferred the output of previously processed
+ *  specials create the pending SVG elements. This must be done before any other
+ *  content is added to the current page in order to preserve the drawing order. */
+void SpecialManager::flushPendingOutput () const {
+	if (_pendingHandler) {
+		SpecialHandler *handler = _pendingHandler;
+		_pendingHandler = nullptr;  // prevent recursion if the handler appends nodes to the page
+		handler->flushPendingOutput();
+	}
+}
+
+
 void SpecialManager::notifyPreprocessingFinished () const {
 	for (auto &handler : _handlerPool)
 		handler->dviPreprocessingFinished();
@@ -146,12 +173,14 @@ void SpecialManager::notifyPreprocessingFinished () const {
 
 
 void SpecialManager::notifyBeginPage (unsigned pageno, SpecialActions &actions) const {
+	flushPendingOutput();
 	for (auto &handler : _handlerPool)
 		handler->dviBeginPage(pageno, actions);
 }
 
 
 void SpecialManager::notifyEndPage (unsigned pageno, SpecialActions &actions) const {
+	flushPendingOutput();
 	for (auto &handler : _handlerPool)
 		handler->dviEndPage(pageno, actions);
 }
@@ -41,11 +41,13 @@ class SpecialManager {
 		void registerHandlers (std::vector<std::unique_ptr<SpecialHandler>> &handlers, const char *ignorelist);
 		void unregisterHandlers ();
 		void preprocess (const std::string &special, SpecialActions &actions) const;
+		bool carriesPageState (const std::string &special) const;
 		bool process (const std::string &special, double dvi2bp, SpecialActions &actions) const;
 		void notifyPreprocessingFinished () const;
 		void notifyBeginPage (unsigned pageno, SpecialActions &actions) const;
 		void notifyEndPage (unsigned pageno, SpecialActions &actions) const;
 		void notifyPositionChange (double x, double y, SpecialActions &actions) const;
+		void flushPendingOutput () const;
 		void writeHandlerInfo (std::ostream &os) const;
 		SpecialHandler* findHandlerByName (const std::string &name) const;
 
@@ -57,6 +59,7 @@ class SpecialManager {
 	private:
 		HandlerPool _handlerPool;      ///< stores pointers to all handlers
 		HandlerMap _handlersByPrefix;  ///< pointers to handlers for corresponding prefixes
+		mutable SpecialHandler *_pendingHandler=nullptr;  ///< handler with deferred output, if any
 };
 
 #endif
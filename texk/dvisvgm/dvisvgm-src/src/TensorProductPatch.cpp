@@ -18,7 +18,10 @@
 ** along with this program; if not, see <http://www.gnu.org/licenses/>. **
 *************************************************************************/
 
+#include <cmath>
+#include <string>
 #include <valarray>
+#include "BoundedCache.hpp"
 #include "TensorProductPatch.hpp"
 
 using namespace std;
@@ -342,6 +345,36 @@ void TensorProductPatch::approximateRow (double v1, double inc, bool overlap, do
 }
 
 
+/** Single segment of an approximated patch. */
+struct ApproximationSegment {
+	GraphicsPath<double> path;
+	Color color;
+};
+using ApproximationSegments = vector<ApproximationSegment>;
+
+/** Stores the segments of recently approximated patches so that identical patches,
+ *  e.g. shadings repeated on several pages, don't have to be processed again. */
+using ApproximationCache = BoundedCache<ApproximationSegments>;
+
+
+/** Patch callback that records the computed segments before passing them on to another callback. */
+class ApproximationRecorder : public ShadingPatch::Callback {
+	public:
+		explicit ApproximationRecorder (ShadingPatch::Callback &callback) : _callback(callback) {}
+
+		void patchSegment (GraphicsPath<double> &path, const Color &color) override {
+			_segments.push_back({path, color});
+			_callback.patchSegment(path, color);
+		}
+
+		ApproximationSegments& segments () {return _segments;}
+
+	private:
+		ShadingPatch::Callback &_callback;
+		ApproximationSegments _segments;
+};
+
+
 /** Approximate the patch by dividing it into a grid of segments that are filled with the
  *  average color of the corresponding region. The boundary of each segment consists of
  *  four Bézier curves, too. In order to prevent visual gaps between neighbored segments due
@@ -377,6 +410,178 @@ void TensorProductPatch::approximate (int gridsize, bool overlap, double delta,
 }
 
 
+/** Approximate the patch by dividing it into segments whose number depends on the color
+ *  variation across the patch. The rows and columns are only refined as far as necessary to
+ *  keep the color difference of neighbored segments below delta, and adjacent segments of
+ *  the same color are merged. Since the computed segments are cached, identical patches,
+ *  e.g. shadings repeated on several pages, are processed only once.
+ *  @param[in] gridsize maximal number of segments per row/column
+ *  @param[in] overlap if true, enlarge each segment to overlap with its right and bottom neighbors
+ *  @param[in] delta maximal color difference of neighbored segments (color components range from 0 to 1)
+ *  @param[in] tolerance maximal distance (in PS points) between segment boundaries and their
+ *             straight-line approximations
+ *  @param[in] callback object notified */
+void TensorProductPatch::approximateAdaptive (int gridsize, bool overlap, double delta, double tolerance, Callback &callback) const {
+	if (_colors[0] == _colors[1] && _colors[1] == _colors[2] && _colors[2] == _colors[3]) {
+		// simple case: monochromatic patch
+		GraphicsPath<double> path;
+		getBoundaryPath(path);
+		callback.patchSegment(path, _colors[0]);
+		return;
+	}
+	// build the cache key from the patch data and the approximation parameters
+	string key;
+	auto append = [&key](const void *data, size_t size) {
+		key.append(static_cast<const char*>(data), size);
+	};
+	for (int i=0; i < 4; i++) {
+		for (int j=0; j < 4; j++) {
+			double x = _points[i][j].x(), y = _points[i][j].y();
+			append(&x, sizeof(x));
+			append(&y, sizeof(y));
+		}
+		uint32_t rgb = uint32_t(_colors[i]);
+		append(&rgb, sizeof(rgb));
+	}
+	int colorspace = int(colorSpace());
+	append(&colorspace, sizeof(colorspace));
+	append(&gridsize, sizeof(gridsize));
+	append(&delta, sizeof(delta));
+	append(&tolerance, sizeof(tolerance));
+	key += (overlap ? '1' : '0');
+
+	static ApproximationCache cache;
+	if (const ApproximationSegments *segments = cache.find(key)) {
+		for (const ApproximationSegment &segment : *segments) {
+			GraphicsPath<double> path = segment.path;  // the callback is allowed to modify the path
+			callback.patchSegment(path, segment.color);
+		}
+	}
+	else {
+		ApproximationRecorder recorder(callback);
+		approximateNonUniform(gridsize, overlap, delta, tolerance, recorder);
+		cache.insert(key, std::move(recorder.segments()));
+	}
+}
+
+
+/** Returns the number of segments required to split a color transition of a given
+ *  extent into steps not greater than delta. */
+static int segment_count (double colordiff, double delta, int maxcount) {
+	if (delta <= 0)
+		return maxcount;
+	return max(1, min(maxcount, int(ceil(colordiff/delta))));
+}
+
+
+/** Divides the patch into rows and columns whose number depends on the local color variation.
+ *  Since the vertex colors are interpolated bilinearly, the colors change linearly along the
+ *  isoparametric curves. Thus, the required number of segments can be computed directly from
+ *  the color differences at the boundaries of the rows. As the rows are divided differently,
+ *  the segments get the vertices of the neighbored rows on their common boundaries too.
+ *  Otherwise, the approximated outlines wouldn't meet exactly at these T-junctions. */
+void TensorProductPatch::approximateNonUniform (int gridsize, bool overlap, double delta, double tolerance, Callback &callback) const {
+	ColorGetter getComponents;
+	ColorSetter setComponents;
+	colorQueryFuncs(getComponents, setComponents);
+	valarray<double> comp[4];
+	for (int i=0; i < 4; i++)
+		(_colors[i].*getComponents)(comp[i]);
+
+	valarray<double> udiff1 = comp[1]-comp[0];  // color difference along the lower boundary
+	valarray<double> udiff2 = comp[3]-comp[2];  // color difference along the upper boundary
+	double vdiff = max(abs(comp[2]-comp[0]).max(), abs(comp[3]-comp[1]).max());
+	const int rows = segment_count(vdiff, delta, gridsize);
+	const double vinc = 1.0/rows;
+	// compute the segments of all rows, joining adjacent segments of the same color
+	vector<vector<double>> ubreaks(rows);  // u values where the segments start, followed by 1
+	vector<vector<Color>> colors(rows);
+	vector<double> uincs(rows);
+	for (int i=0; i < rows; i++) {
+		double v1 = snap(i*vinc);
+		double v2 = snap((i+1)*vinc);
+		double udiff = max(abs(udiff1*(1-v1) + udiff2*v1).max(), abs(udiff1*(1-v2) + udiff2*v2).max());
+		const int cols = segment_count(udiff, delta, gridsize);
+		uincs[i] = 1.0/cols;
+		for (int j=0; j < cols; j++) {
+			double u1 = snap(j*uincs[i]);
+			double u2 = snap((j+1)*uincs[i]);
+			Color segcolor = averageColor(colorAt(u1, v1), colorAt(u2, v1), colorAt(u1, v2), colorAt(u2, v2));
+			if (j == 0 || segcolor != colors[i].back()) {
+				ubreaks[i].push_back(u1);
+				colors[i].push_back(segcolor);
+			}
+		}
+		ubreaks[i].push_back(1);
+	}
+	// collects the segment starts of row i lying inside the interval (u1,u2)
+	auto inner_breaks = [&](int i, double u1, double u2) {
+		vector<double> breaks;
+		if (!overlap && i >= 0 && i < rows) {  // overlapping rows don't share their boundaries
+			for (double u : ubreaks[i])
+				if (u > u1 && u < u2)
+					breaks.push_back(u);
+		}
+		return breaks;
+	};
+	for (int i=0; i < rows; i++) {
+		double v1 = snap(i*vinc);
+		double v2 = snap((i+1)*vinc);
+		double ov2 = (overlap && v2 < 1) ? snap(v2+vinc) : v2;
+		for (size_t j=0; j < colors[i].size(); j++) {
+			double u1 = ubreaks[i][j];
+			double u2 = ubreaks[i][j+1];
+			if (overlap && u2 < 1)
+				u2 = snap(u2+uincs[i]);
+			approximateSegment(u1, u2, v1, ov2, inner_breaks(i-1, u1, u2), inner_breaks(i+1, u1, u2), tolerance, colors[i][j], callback);
+		}
+	}
+}
+
+
+/** Creates a single segment covering the region P([u1,u2],[v1,v2]) of the patch. Its outline
+ *  is made up of the corresponding sections of the isoparametric curves. Sections that deviate
+ *  less than tolerance from a straight line are replaced by line segments.
+ *  @param[in] ubreaks1 ascending u values where the lower edge gets additional vertices
+ *  @param[in] ubreaks2 ascending u values where the upper edge gets additional vertices */
+void TensorProductPatch::approximateSegment (double u1, double u2, double v1, double v2, const vector<double> &ubreaks1, const vector<double> &ubreaks2, double tolerance, const Color &color, Callback &callback) const {
+	Bezier hbezier1, hbezier2, vbezier1, vbezier2;
+	horizontalCurve(v1, hbezier1);
+	horizontalCurve(v2, hbezier2);
+	verticalCurve(u1, vbezier1);
+	verticalCurve(u2, vbezier2);
+	vector<Bezier> edges;
+	double u = u1;
+	for (double ubreak : ubreaks1) {
+		edges.emplace_back(hbezier1, u, ubreak);
+		u = ubreak;
+	}
+	edges.emplace_back(hbezier1, u, u2);
+	edges.emplace_back(vbezier2, v1, v2);
+	u = u2;
+	for (auto it=ubreaks2.rbegin(); it != ubreaks2.rend(); ++it) {
+		edges.emplace_back(hbezier2, *it, u);
+		edges.back().reverse();
+		u = *it;
+	}
+	edges.emplace_back(hbezier2, u1, u);
+	edges.back().reverse();
+	edges.emplace_back(vbezier1, v1, v2);
+	edges.back().reverse();
+	GraphicsPath<double> path;
+	path.moveto(edges[0].point(0));
+	vector<DPair> points;
+	for (size_t i=0; i < edges.size(); i++) {
+		if (edges[i].reduceDegree(tolerance, points) > 1)
+			path.cubicto(edges[i].point(1), edges[i].point(2), edges[i].point(3));
+		else if (points.size() > 1 && i < edges.size()-1)  // last straight edge is drawn by closepath
+			path.lineto(edges[i].point(3));
+	}
+	path.closepath();
+	callback.patchSegment(path, color);
+}
+
+
 void TensorProductPatch::getBBox (BoundingBox &bbox) const {
 	Bezier bezier;
 	BoundingBox bezierBox;
@@ -58,13 +58,16 @@ class TensorProductPatch : public ShadingPatch
 		DPair blossomValue (double u1, double u2, double u3, double v1, double v2, double v3) const;
 		DPair blossomValue (double u[3], double v[3]) const {return blossomValue(u[0], u[1], u[2], v[0], v[1], v[2]);}
 		void approximate (int gridsize, bool overlap, double delta, Callback &callback) const override;
+		void approximateAdaptive (int gridsize, bool overlap, double delta, double tolerance, Callback &callback) const override;
 		void getBBox (BoundingBox &bbox) const override;
 		int numPoints (int edgeflag) const override {return edgeflag == 0 ? 16 : 12;}
 		int numColors (int edgeflag) const override {return edgeflag == 0 ? 4 : 2;}
 
 	protected:
 		Color averageColor (const Color &c1, const Color &c2, const Color &c3, const Color &c4) const;
+		void approximateNonUniform (int gridsize, bool overlap, double delta, double tolerance, Callback &callback) const;
 		void approximateRow (double v1, double inc, bool overlap, double delta, const std::vector<Bezier> &beziers, Callback &callback) const;
+		void approximateSegment (double u1, double u2, double v1, double v2, const std::vector<double> &ubreaks1, const std::vector<double> &ubreaks2, double tolerance, const Color &color, Callback &callback) const;
 		void setFirstMatrixColumn (const DPair source[4], bool reverse);
 		void setFirstMatrixColumn (DPair source[4][4], int col, bool reverse);
 
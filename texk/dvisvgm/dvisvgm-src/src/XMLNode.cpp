@@ -22,6 +22,8 @@
 #include <map>
 #include <list>
 #include <sstream>
+#include <unordered_set>
+#include "MemoryPool.hpp"
 #include "utility.hpp"
 #include "XMLNode.hpp"
 #include "XMLString.hpp"
@@ -29,7 +31,36 @@
 using namespace std;
 
 
-XMLElementNode::XMLElementNode (const string &n) : _name(n) {
+// Pools providing the memory for element and text nodes. The pools are created on
+// first use so that they outlive all nodes, including those held by static objects.
+// Like the table of interned names below, they are not synchronized, i.e. XML nodes
+// must only be created and destroyed by a single thread. dvisvgm converts the pages
+// in one thread per process (option --jobs forks worker processes).
+static MemoryPool<sizeof(XMLElementNode)>& element_pool () {
+	static MemoryPool<sizeof(XMLElementNode)> pool;
+	return pool;
+}
+
+
+static MemoryPool<sizeof(XMLTextNode)>& text_pool () {
+	static MemoryPool<sizeof(XMLTextNode)> pool;
+	return pool;
+}
+
+
+/** Returns a unique instance of a given element or attribute name. Since SVG documents
+ *  contain only a small number of different names, all elements and attributes can
+ *  share the same string objects rather than keeping their own copies.
+ *  The table is not thread-safe (see above).
+ *  @param[in] name name to look up
+ *  @return reference to the interned name (valid until the program terminates) */
+const string& XMLElementNode::internName (const string &name) {
+	static unordered_set<string> names;
+	return *names.insert(name).first;
+}
+
+
+XMLElementNode::XMLElementNode (const string &n) : _name(&internName(n)) {
 }
 
 
@@ -42,11 +73,25 @@ XMLElementNode::XMLElementNode (const XMLElementNode &node)
 
 
 XMLElementNode::XMLElementNode (XMLElementNode &&node)
-	: _name(std::move(node._name)), _attributes(std::move(node._attributes)), _children(std::move(node._children))
+	: _name(node._name), _attributes(std::move(node._attributes)), _children(std::move(node._children))
 {
 }
 
 
+void* XMLElementNode::operator new (size_t size) {
+	// nodes of derived types are allocated on the heap as usual
+	return size == sizeof(XMLElementNode) ? element_pool().allocate() : ::operator new(size);
+}
+
+
+void XMLElementNode::operator delete (void *ptr, size_t size) {
+	if (size == sizeof(XMLElementNode))
+		element_pool().release(ptr);
+	else
+		::operator delete(ptr);
+}
+
+
 void XMLElementNode::clear () {
 	_attributes.clear();
 	_children.clear();
@@ -56,8 +101,12 @@ void XMLElementNode::clear () {
 void XMLElementNode::addAttribute (const string &name, const string &value) {
 	if (Attribute *attr = getAttribute(name))
 		attr->value = value;
-	else
+	else {
+		// most elements get a few attributes, so avoid repeated reallocations
+		if (_attributes.empty())
+			_attributes.reserve(4);
 		_attributes.emplace_back(Attribute(name, value));
+	}
 }
 
 
@@ -199,9 +248,9 @@ XMLElementNode* XMLElementNode::getFirstDescendant (const char *name, const char
 
 
 ostream& XMLElementNode::write (ostream &os) const {
-	os << '<' << _name;
+	os << '<' << *_name;
 	for (const auto &attrib : _attributes)
-		os << ' ' << attrib.name << "='" << attrib.value << '\'';
+		os << ' ' << *attrib.name << "='" << attrib.value << '\'';
 	if (_children.empty())
 		os << "/>";
 	else {
@@ -218,7 +267,7 @@ ostream& XMLElementNode::write (ostream &os) const {
 					os << '\n';
 			}
 		}
-		os << "</" << _name << '>';
+		os << "</" << *_name << '>';
 	}
 	return os;
 }
@@ -242,7 +291,7 @@ const char* XMLElementNode::getAttributeValue (const std::string& name) const {
 
 XMLElementNode::Attribute* XMLElementNode::getAttribute (const string &name) {
 	auto it = find_if(_attributes.begin(), _attributes.end(), [&](const Attribute &attr) {
-		return attr.name == name;
+		return *attr.name == name;
 	});
 	return it != _attributes.end() ? &(*it) : nullptr;
 }
@@ -250,7 +299,7 @@ XMLElementNode::Attribute* XMLElementNode::getAttribute (const string &name) {
 
 const XMLElementNode::Attribute* XMLElementNode::getAttribute (const string &name) const {
 	auto it = find_if(_attributes.begin(), _attributes.end(), [&](const Attribute &attr) {
-		return attr.name == name;
+		return *attr.name == name;
 	});
 	return it != _attributes.end() ? &(*it) : nullptr;
 }
@@ -258,6 +307,19 @@ const XMLElementNode::Attribute* XMLElementNode::getAttribute (const string &nam
 
 //////////////////////
 
+void* XMLTextNode::operator new (size_t size) {
+	return size == sizeof(XMLTextNode) ? text_pool().allocate() : ::operator new(size);
+}
+
+
+void XMLTextNode::operator delete (void *ptr, size_t size) {
+	if (size == sizeof(XMLTextNode))
+		text_pool().release(ptr);
+	else
+		::operator delete(ptr);
+}
+
+
 void XMLTextNode::append (unique_ptr<XMLNode> &&node) {
 	if (!node)
 		return;
@@ -303,3 +365,18 @@ void XMLCDataNode::append (string &&str) {
 	else
 		_data += str;
 }
+
+/////////////////////////////////////////////////////////////////////
+
+/** Appends the XML representation of a node. Line breaks are inserted between
+ *  consecutive non-text nodes in the same way as done by XMLElementNode::write.
+ *  @param[in] node node to be serialized */
+void XMLSerializedNode::append (const XMLNode &node) {
+	bool isText = (dynamic_cast<const XMLTextNode*>(&node) != nullptr);
+	if (!_data.empty() && !_textAtEnd && !isText)
+		_data += '\n';
+	ostringstream oss;
+	node.write(oss);
+	_data += oss.str();
+	_textAtEnd = isText;
+}
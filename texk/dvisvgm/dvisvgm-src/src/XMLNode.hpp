@@ -42,8 +42,8 @@ class XMLNode {
 class XMLElementNode : public XMLNode {
 	public:
 		struct Attribute {
-			Attribute (const std::string &nam, const std::string &val) : name(nam), value(val) {}
-			std::string name;
+			Attribute (const std::string &nam, const std::string &val) : name(&internName(nam)), value(val) {}
+			const std::string *name;  ///< interned attribute name
 			std::string value;
 		};
 		using ChildList = std::deque<std::unique_ptr<XMLNode>>;
@@ -52,6 +52,8 @@ class XMLElementNode : public XMLNode {
 		XMLElementNode (const std::string &name);
 		XMLElementNode (const XMLElementNode &node);
 		XMLElementNode (XMLElementNode &&node);
+		static void* operator new (size_t size);
+		static void operator delete (void *ptr, size_t size);
 		std::unique_ptr<XMLNode> clone () const override {return util::make_unique<XMLElementNode>(*this);}
 		void clear () override;
 		void addAttribute (const std::string &name, const std::string &value);
@@ -69,13 +71,15 @@ class XMLElementNode : public XMLNode {
 		std::ostream& write (std::ostream &os) const override;
 		bool empty () const                  {return _children.empty();}
 		const ChildList& children () const   {return _children;}
-		const std::string& getName () const  {return _name;}
+		const std::string& getName () const  {return *_name;}
+		static const std::string& internName (const std::string &name);
+
 	protected:
 		Attribute* getAttribute (const std::string &name);
 		const Attribute* getAttribute (const std::string &name) const;
 
 	private:
-		std::string _name;     // element name (<name a1="v1" .. an="vn">...</name>)
+		const std::string *_name;  // interned element name (<name a1="v1" .. an="vn">...</name>)
 		std::vector<Attribute> _attributes;
 		ChildList _children;   // child nodes
 };
@@ -85,6 +89,8 @@ class XMLTextNode : public XMLNode {
 	public:
 		XMLTextNode (const std::string &str) : _text(str) {}
 		XMLTextNode (std::string &&str) : _text(std::move(str)) {}
+		static void* operator new (size_t size);
+		static void operator delete (void *ptr, size_t size);
 		std::unique_ptr<XMLNode> clone () const override {return util::make_unique<XMLTextNode>(*this);}
 		void clear () override {_text.clear();}
 		void append (std::unique_ptr<XMLNode> &&node);
@@ -127,6 +133,24 @@ class XMLCDataNode : public XMLNode {
 };
 
 
+/** Node holding the serialized XML representation of a sequence of sibling nodes.
+ *  It allows for replacing completed subtrees by their much more compact textual
+ *  representation. The sequence must start and end with a non-text node so that
+ *  XMLElementNode::write inserts the same line breaks as for the original nodes. */
+class XMLSerializedNode : public XMLNode {
+	public:
+		std::unique_ptr<XMLNode> clone () const override {return util::make_unique<XMLSerializedNode>(*this);}
+		void clear () override {_data.clear(); _textAtEnd = false;}
+		void append (const XMLNode &node);
+		std::ostream& write (std::ostream &os) const override {return os << _data;}
+		bool empty () const {return _data.empty();}
+
+	private:
+		std::string _data;
+		bool _textAtEnd=false;  ///< true if the last node appended was a text node
+};
+
+
 inline std::ostream& operator << (std::ostream &os, const XMLElementNode &node) {return node.write(os);}
 inline std::ostream& operator << (std::ostream &os, const XMLTextNode &node) {return node.write(os);}
 inline std::ostream& operator << (std::ostream &os, const XMLCommentNode &node) {return node.write(os);}
@@ -109,8 +109,11 @@ static bool set_cache_dir (const CommandLine &args) {
 	if (args.cacheOpt.given() && !args.cacheOpt.value().empty()) {
 		if (args.cacheOpt.value() == "none")
 			PhysicalFont::CACHE_PATH = 0;
-		else if (FileSystem::exists(args.cacheOpt.value()))
-			PhysicalFont::CACHE_PATH = args.cacheOpt.value().c_str();
+		else if (FileSystem::exists(args.cacheOpt.value())) {
+			static string cachepath;  // value() returns a temporary copy, so keep the path here
+			cachepath = args.cacheOpt.value();
+			PhysicalFont::CACHE_PATH = cachepath.c_str();
+		}
 		else
 			Message::wstream(true) << "cache directory '" << args.cacheOpt.value() << "' does not exist (caching disabled)\n";
 	}
@@ -128,8 +131,10 @@ static bool set_cache_dir (const CommandLine &args) {
 	if (args.cacheOpt.given() && args.cacheOpt.value().empty()) {
 		cout << "cache directory: " << (PhysicalFont::CACHE_PATH ? PhysicalFont::CACHE_PATH : "(none)") << '\n';
 		try {
-			if (PhysicalFont::CACHE_PATH)
+			if (PhysicalFont::CACHE_PATH) {
 				FontCache::fontinfo(PhysicalFont::CACHE_PATH, cout, true);
+				FontWriter::purgeCache(PhysicalFont::CACHE_PATH, cout);
+			}
 		}
 		catch (StreamReaderException &e) {
 			Message::wstream(true) << "failed reading cache data\n";
@@ -349,6 +354,7 @@ static void set_variables (const CommandLine &cmdline) {
 	SVGTree::MERGE_CHARS = !cmdline.noMergeOpt.given();
 	SVGTree::ADD_COMMENTS = cmdline.commentsOpt.given();
 	DVIToSVG::TRACE_MODE = cmdline.traceAllOpt.given() ? (cmdline.traceAllOpt.value() ? 'a' : 'm') : 0;
+	DVIToSVG::JOBS = max(1u, cmdline.jobsOpt.value());
 	Message::LEVEL = cmdline.verbosityOpt.value();
 	PhysicalFont::EXACT_BBOX = cmdline.exactOpt.given();
 	PhysicalFont::KEEP_TEMP_FILES = cmdline.keepOpt.given();
@@ -358,6 +364,10 @@ static void set_variables (const CommandLine &cmdline) {
 	PsSpecialHandler::SHADING_SEGMENT_OVERLAP = cmdline.gradOverlapOpt.given();
 	PsSpecialHandler::SHADING_SEGMENT_SIZE = max(1, cmdline.gradSegmentsOpt.value());
 	PsSpecialHandler::SHADING_SIMPLIFY_DELTA = cmdline.gradSimplifyOpt.value();
+	PsSpecialHandler::SHADING_ADAPTIVE = cmdline.gradAdaptiveOpt.given();
+	PsSpecialHandler::SHADING_ADAPTIVE_TOLERANCE = cmdline.gradAdaptiveOpt.value();
+	PsSpecialHandler::BATCH_SPECIALS = cmdline.psBatchOpt.given();
+	PsSpecialHandler::PRINT_STATISTICS = cmdline.psStatsOpt.given();
 }
 
 
@@ -22,6 +22,10 @@
 #include <fstream>
 #include "FileSystem.hpp"
 
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
 #ifndef SRCDIR
 #define SRCDIR "."
 #endif
@@ -71,6 +75,28 @@ TEST(FileSystemTest, rename) {
 }
 
 
+TEST(FileSystemTest, createUniqueFile) {
+	string tmpfile1 = FileSystem::createUniqueFile("out.tmp");
+	string tmpfile2 = FileSystem::createUniqueFile("out.tmp");
+	ASSERT_FALSE(tmpfile1.empty());
+	ASSERT_FALSE(tmpfile2.empty());
+	EXPECT_NE(tmpfile1, tmpfile2);
+	EXPECT_EQ(tmpfile1.substr(0, 7), "out.tmp");
+	EXPECT_TRUE(FileSystem::isFile(tmpfile1));
+	EXPECT_EQ(FileSystem::filesize(tmpfile1), 0u);
+#ifndef _WIN32
+	// the file gets the permissions of a file created the usual way
+	mode_t mask = umask(022);
+	umask(mask);
+	struct stat attr;
+	ASSERT_EQ(stat(tmpfile1.c_str(), &attr), 0);
+	EXPECT_EQ(attr.st_mode & 0777, 0666 & ~mask);
+#endif
+	FileSystem::remove(tmpfile1);
+	FileSystem::remove(tmpfile2);
+}
+
+
 TEST(FileSystemTest, filesize) {
 	const char *tmpfile = "out.tmp";
 	ofstream ofs(tmpfile, ios::binary);
@@ -23,6 +23,12 @@
 #include <sstream>
 #include "FileSystem.hpp"
 #include "FontCache.hpp"
+#include "MemoryMappedFile.hpp"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #ifndef BUILDDIR
 #define BUILDDIR "."
@@ -71,7 +77,7 @@ class FontCacheTest : public testing::Test {
 		}
 
 		~FontCacheTest () {
-			FileSystem::remove(cachedir+"/testfont.fgd");
+			FileSystem::remove(FontCache::filepath(cachedir));
 		}
 
 		Glyph glyph1, glyph2;
@@ -140,7 +146,7 @@ TEST_F(FontCacheTest, read) {
 TEST_F(FontCacheTest, fontinfo1) {
 	ostringstream oss;
 	cache.clear();
-	FileSystem::remove(cachedir+"/testfont.fgd");
+	FileSystem::remove(FontCache::filepath(cachedir));
 	cache.fontinfo(cachedir.c_str(), oss);
 	ASSERT_EQ(oss.str(), "cache is empty\n");
 
@@ -167,7 +173,99 @@ TEST_F(FontCacheTest, fontinfo2) {
 	ostringstream oss;
 	cache.fontinfo(cachedir.c_str(), oss);
 	ASSERT_EQ(oss.str(),
-		"cache format version 5\n"
-		"testfont      2 glyphs        10 cmds          58 bytes  crc:38cb5c67\n"
+		"cache format version 6\n"
+		"testfont      2 glyphs        10 cmds          73 bytes  crc:f82db235\n"
+	);
+}
+
+
+TEST_F(FontCacheTest, append) {
+	cache.setGlyph(1, glyph1);
+	ASSERT_TRUE(cache.write("testfont", cachedir.c_str()));
+	cache.clear();
+	cache.setGlyph(5, glyph2);
+	ASSERT_TRUE(cache.write("otherfont", cachedir.c_str()));
+	// add a glyph to an already cached font
+	ASSERT_TRUE(cache.read("testfont", cachedir.c_str()));
+	cache.setGlyph(10, glyph2);
+	ASSERT_TRUE(cache.write(cachedir.c_str()));
+
+	FontCache cache2;
+	ASSERT_TRUE(cache2.read("testfont", cachedir.c_str()));
+	ASSERT_NE(cache2.getGlyph(1), nullptr);
+	ASSERT_EQ(cache2.getGlyph(5), nullptr);
+	ASSERT_NE(cache2.getGlyph(10), nullptr);
+	ASSERT_EQ(*cache2.getGlyph(1), glyph1);
+	ASSERT_EQ(*cache2.getGlyph(10), glyph2);
+	ASSERT_TRUE(cache2.read("otherfont", cachedir.c_str()));
+	ASSERT_NE(cache2.getGlyph(5), nullptr);
+	ASSERT_EQ(*cache2.getGlyph(5), glyph2);
+	ASSERT_FALSE(cache2.read("unknownfont", cachedir.c_str()));
+
+	// remove the outdated record of testfont
+	ostringstream oss;
+	FontCache::fontinfo(cachedir.c_str(), oss, true);
+	ASSERT_EQ(oss.str(),
+		"cache format version 6\n"
+		"otherfont     1 glyph          5 cmds          51 bytes  crc:b03951af\n"
+		"testfont      2 glyphs        10 cmds          73 bytes  crc:f82db235\n"
+		"44 bytes of outdated cache data removed\n"
 	);
+	ASSERT_EQ(FileSystem::filesize(FontCache::filepath(cachedir)), 4u+51u+73u);
+	FontCache cache3;
+	ASSERT_TRUE(cache3.read("testfont", cachedir.c_str()));
+	ASSERT_EQ(*cache3.getGlyph(10), glyph2);
+}
+
+
+TEST_F(FontCacheTest, replaceIncompatible) {
+	// a cache file of another format is replaced, not overwritten in place,
+	// so that a process that has it mapped into memory still sees the old data
+	ofstream ofs(FontCache::filepath(cachedir), ios::binary);
+	ofs << "FGC" << char(1) << "old data";
+	ofs.close();
+	MemoryMappedFile mmf(FontCache::filepath(cachedir));
+	ASSERT_TRUE(mmf.isOpen());
+	cache.setGlyph(1, glyph1);
+	ASSERT_TRUE(cache.write("testfont", cachedir.c_str()));
+	ASSERT_EQ(string(mmf.data(), mmf.size()), string("FGC")+char(1)+"old data");
+	FontCache cache2;
+	ASSERT_TRUE(cache2.read("testfont", cachedir.c_str()));
+	ASSERT_EQ(*cache2.getGlyph(1), glyph1);
 }
+
+
+#ifndef _WIN32
+TEST_F(FontCacheTest, concurrentWrite) {
+	// records written by several processes at the same time must not interleave
+	const int NUM_PROCESSES = 4, NUM_FONTS = 50;
+	vector<pid_t> pids;
+	for (int i=0; i < NUM_PROCESSES; i++) {
+		pid_t pid = fork();
+		ASSERT_GE(pid, 0);
+		if (pid == 0) {
+			bool success = true;
+			for (int j=0; j < NUM_FONTS; j++) {
+				FontCache fc;
+				fc.setGlyph(j, (i+j)%2 ? glyph1 : glyph2);
+				success = fc.write("font"+to_string(i)+"-"+to_string(j), cachedir.c_str()) && success;
+			}
+			_exit(success ? 0 : 1);
+		}
+		pids.push_back(pid);
+	}
+	for (pid_t pid : pids) {
+		int status;
+		ASSERT_EQ(waitpid(pid, &status, 0), pid);
+		ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	for (int i=0; i < NUM_PROCESSES; i++) {
+		for (int j=0; j < NUM_FONTS; j++) {
+			FontCache fc;
+			ASSERT_TRUE(fc.read("font"+to_string(i)+"-"+to_string(j), cachedir.c_str()));
+			ASSERT_NE(fc.getGlyph(j), nullptr);
+			ASSERT_EQ(*fc.getGlyph(j), (i+j)%2 ? glyph1 : glyph2);
+		}
+	}
+}
+#endif
@@ -0,0 +1,108 @@
+/*************************************************************************
+** FontWriterTest.cpp                                                   **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include "Font.hpp"
+#include "FontWriter.hpp"
+#include "FileSystem.hpp"
+#include "utility.hpp"
+
+#ifndef BUILDDIR
+#define BUILDDIR "."
+#endif
+
+using namespace std;
+
+#ifndef DISABLE_WOFF
+
+static string base64 (const string &str) {
+	ostringstream oss;
+	util::base64_copy(str.begin(), str.end(), ostreambuf_iterator<char>(oss));
+	return oss.str();
+}
+
+
+class FontWriterTest : public ::testing::Test {
+	protected:
+		void SetUp () override {
+			PhysicalFont::CACHE_PATH = cachedir.c_str();
+			FileSystem::mkdir(cachedir);
+		}
+
+		void TearDown () override {
+			for (const string &entry : entries())
+				FileSystem::remove(fontdir+"/"+entry);
+			FileSystem::rmdir(fontdir);
+			FileSystem::rmdir(cachedir);
+			PhysicalFont::CACHE_PATH = nullptr;
+		}
+
+		/** Returns the names of the files in the font cache directory. */
+		vector<string> entries () const {
+			vector<string> names, fnames;
+			FileSystem::collect(fontdir, fnames);
+			for (const string &fname : fnames) {
+				if (fname[0] == 'f')
+					names.emplace_back(fname.substr(1));
+			}
+			return names;
+		}
+
+		string cachedir = BUILDDIR"/fontwriter-cache";
+		string fontdir = cachedir+"/fonts";
+};
+
+
+TEST_F(FontWriterTest, cacheRoundTrip) {
+	auto font = PhysicalFont::create("cmr10", 1274110073, 10, 10, PhysicalFont::Type::PFB);
+	const PhysicalFont *pf = dynamic_cast<const PhysicalFont*>(font.get());
+	ASSERT_NE(pf, nullptr);
+	FontWriter writer(*pf);
+	set<int> chars = {'A', 'b'};
+	string css1 = writer.createCSSFontFace(FontWriter::FontFormat::WOFF, chars).get();
+	ASSERT_EQ(css1.substr(0, 35), "@font-face{font-family:cmr10;src:ur");
+
+	// the compressed font was stored in the cache, no temporary file was left over
+	vector<string> names = entries();
+	ASSERT_EQ(names.size(), 1u);
+	string cachefile = fontdir+"/"+names[0];
+	EXPECT_EQ(names[0].substr(names[0].length()-5), ".woff");
+	string fontdata = util::read_file_contents(cachefile);
+	ASSERT_FALSE(fontdata.empty());
+	EXPECT_EQ(fontdata.substr(0, 4), "wOFF");
+	EXPECT_NE(css1.find(base64(fontdata.substr(0, 30))), string::npos);
+
+	// the same glyphs are taken from the cache
+	string css2 = writer.createCSSFontFace(FontWriter::FontFormat::WOFF, chars).get();
+	EXPECT_EQ(css2, css1);
+	ofstream ofs(cachefile, ios::binary);
+	ofs << "cached";
+	ofs.close();
+	string css3 = writer.createCSSFontFace(FontWriter::FontFormat::WOFF, chars).get();
+	EXPECT_NE(css3.find("base64,"+base64("cached")+")"), string::npos);
+
+	// other glyphs get a cache file of their own
+	writer.createCSSFontFace(FontWriter::FontFormat::WOFF, {'A'}).get();
+	EXPECT_EQ(entries().size(), 2u);
+}
+
+#endif
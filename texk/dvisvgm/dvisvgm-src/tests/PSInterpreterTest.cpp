@@ -85,6 +85,14 @@ class PSTestActions : public PSActions {
 };
 
 
+/** Passes text directly to the output handler as if it were written by Ghostscript. */
+class PSTestInterpreter : public PSInterpreter {
+	public:
+		explicit PSTestInterpreter (PSActions *actions) : PSInterpreter(actions) {}
+		void receive (const string &str) {output(static_cast<PSInterpreter*>(this), str.data(), str.length());}
+};
+
+
 TEST(PSInterpreterTest, init) {
 	PSTestActions actions;
 	PSInterpreter psi(&actions);
@@ -182,3 +190,20 @@ TEST(PSInterpreterTest, matrix) {
 	psi.execute("10 100 translate 30 rotate matrix currentmatrix setmatrix ");
 	EXPECT_EQ(actions.result(), "translate 10 100;rotate 30;applyscalevals 1 1 0.866025;setmatrix 0.866025 0.5 -0.5 0.866025 10 100;applyscalevals 1 1 0.866025;");
 }
+
+
+TEST(PSInterpreterTest, callbacks) {
+	PSTestActions actions;
+	PSTestInterpreter psi(&actions);
+	psi.receive("dvi.moveto 1 2\ndvi.line");
+	EXPECT_EQ(actions.result(), "moveto 1 2;");
+	psi.receive("to 3.5 -4e-1\n");
+	EXPECT_EQ(actions.result(), "moveto 1 2;lineto 3.5 -0.4;");
+	actions.clear();
+	psi.receive("  dvi.setdash 1 2  0.5\nsome text\ndvi.unknown 1 2\ndvi.fill\n");
+	EXPECT_EQ(actions.result(), "setdash 1 2 0.5;fill;");
+	actions.clear();
+	psi.receive("dvi.raw abc 12 x\n");
+	EXPECT_EQ(actions.result(), "");
+	EXPECT_EQ(psi.rawData(), vector<string>({"abc", "12", "x"}));
+}
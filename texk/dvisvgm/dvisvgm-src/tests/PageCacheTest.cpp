@@ -0,0 +1,89 @@
+/*************************************************************************
+** PageCacheTest.cpp                                                    **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include "FileSystem.hpp"
+#include "PageCache.hpp"
+
+using namespace std;
+
+class PageCacheTest : public ::testing::Test {
+	protected:
+		PageCacheTest () : cache("pagecache-test") {}
+		void TearDown () override {
+			FileSystem::remove(cache.filepath("0123456789abcdef"));
+			FileSystem::rmdir(cache.dirname());
+		}
+		PageCache cache;
+};
+
+
+TEST_F(PageCacheTest, readWrite) {
+	string svg = "<svg><g id='page3'><path d='M0 0'/></g></svg>";
+	PageCache::Dependencies deps = {"1 cmr10 10 0123", "2 cmmi10 12 4567"};
+	ASSERT_TRUE(cache.write("0123456789abcdef", 3, svg, deps));
+
+	string svg_read;
+	PageCache::Dependencies deps_read;
+	ASSERT_TRUE(cache.read("0123456789abcdef", 3, svg_read, deps_read));
+	EXPECT_EQ(svg_read, svg);
+	EXPECT_EQ(deps_read, deps);
+
+	// the page number is replaced when reading the entry
+	ASSERT_TRUE(cache.read("0123456789abcdef", 127, svg_read, deps_read));
+	EXPECT_EQ(svg_read, "<svg><g id='page127'><path d='M0 0'/></g></svg>");
+}
+
+
+TEST_F(PageCacheTest, missing) {
+	string svg;
+	PageCache::Dependencies deps;
+	EXPECT_FALSE(cache.read("fedcba9876543210", 1, svg, deps));
+}
+
+
+TEST_F(PageCacheTest, corrupted) {
+	ASSERT_TRUE(cache.write("0123456789abcdef", 1, "<svg><g id='page1'/></svg>", {}));
+	{
+		fstream fs(cache.filepath("0123456789abcdef"), ios::in|ios::out|ios::binary);
+		fs.seekp(-4, ios::end);
+		fs.put('x');
+	}
+	string svg;
+	PageCache::Dependencies deps;
+	EXPECT_FALSE(cache.read("0123456789abcdef", 1, svg, deps));
+}
+
+
+TEST_F(PageCacheTest, replace) {
+	ASSERT_TRUE(cache.write("0123456789abcdef", 1, "<svg><g id='page1'/></svg>", {}));
+	ASSERT_TRUE(cache.write("0123456789abcdef", 1, "<svg><g id='page1'><path d='M0 0'/></g></svg>", {}));
+	string svg;
+	PageCache::Dependencies deps;
+	ASSERT_TRUE(cache.read("0123456789abcdef", 1, svg, deps));
+	EXPECT_EQ(svg, "<svg><g id='page1'><path d='M0 0'/></g></svg>");
+
+	// no temporary files are left behind
+	vector<string> entries;
+	FileSystem::collect(cache.dirname(), entries);
+	ASSERT_EQ(entries.size(), 1u);
+	EXPECT_EQ(entries[0], "f0123456789abcdef.dpc");
+}
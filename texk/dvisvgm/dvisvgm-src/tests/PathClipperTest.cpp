@@ -0,0 +1,96 @@
+/*************************************************************************
+** PathClipperTest.cpp                                                  **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include "PathClipper.hpp"
+
+using namespace std;
+
+using CurvedPath = PathClipper::CurvedPath;
+
+
+static string intersection (const CurvedPath &p1, const CurvedPath &p2) {
+	CurvedPath result(p2.windingRule());
+	PathClipper clipper;
+	clipper.intersect(p1, p2, result);
+	ostringstream oss;
+	result.writeSVG(oss, false);
+	return oss.str();
+}
+
+
+static CurvedPath rectangle (double x1, double y1, double x2, double y2) {
+	CurvedPath path;
+	path.moveto(x1, y1);
+	path.lineto(x2, y1);
+	path.lineto(x2, y2);
+	path.lineto(x1, y2);
+	path.closepath();
+	return path;
+}
+
+
+static CurvedPath triangle (double x1, double y1, double x2, double y2, double x3, double y3) {
+	CurvedPath path;
+	path.moveto(x1, y1);
+	path.lineto(x2, y2);
+	path.lineto(x3, y3);
+	path.closepath();
+	return path;
+}
+
+
+TEST(PathClipperTest, disjoint) {
+	EXPECT_EQ(intersection(rectangle(0, 0, 10, 10), rectangle(20, 0, 30, 10)), "");
+	EXPECT_EQ(intersection(rectangle(0, 0, 10, 10), rectangle(10, 0, 20, 10)), "");
+	EXPECT_EQ(intersection(triangle(0, 0, 10, 0, 0, 10), triangle(0, 20, 10, 20, 0, 30)), "");
+}
+
+
+TEST(PathClipperTest, rectangles) {
+	EXPECT_EQ(intersection(rectangle(0, 0, 10, 10), rectangle(5, 2, 20, 8)), "M5 2H10V8H5Z");
+	EXPECT_EQ(intersection(rectangle(10, 10, 0, 0), rectangle(5, -5, 20, 5)), "M5 0H10V5H5Z");
+}
+
+
+TEST(PathClipperTest, enclosed) {
+	CurvedPath path;
+	path.moveto(2, 2);
+	path.cubicto(4, 0, 6, 0, 8, 2);
+	path.lineto(5, 8);
+	path.closepath();
+	// curves enclosed by a rectangle are retained unchanged
+	EXPECT_EQ(intersection(rectangle(0, 0, 10, 10), path), "M2 2C4 0 6 0 8 2L5 8Z");
+	EXPECT_EQ(intersection(path, rectangle(0, 0, 10, 10)), "M2 2C4 0 6 0 8 2L5 8Z");
+	// fill rules differ: path is clipped and reconstructed
+	path.setWindingRule(CurvedPath::WindingRule::EVEN_ODD);
+	EXPECT_EQ(intersection(path, rectangle(0, 0, 10, 10)), "M8 2L5 8L2 2C4 0 6 0 8 2Z");
+}
+
+
+TEST(PathClipperTest, polygons) {
+	CurvedPath p1 = triangle(0, 0, 10, 0, 0, 10);
+	CurvedPath p2 = triangle(0, 0, 10, 10, 10, 0);
+	string str = intersection(p1, p2);
+	EXPECT_EQ(str, "M0 0H10L5 5L0 0Z");
+	EXPECT_EQ(intersection(p1, p2), str);  // taken from the cache
+	EXPECT_EQ(intersection(p2, p1), "M0 0H10L5 5L0 0Z");
+}
@@ -29,6 +29,7 @@
 #include "NoPsSpecialHandler.hpp"
 #include "PapersizeSpecialHandler.hpp"
 #include "PdfSpecialHandler.hpp"
+#include "SpecialActions.hpp"
 #include "TpicSpecialHandler.hpp"
 #include "utility.hpp"
 
@@ -86,3 +87,61 @@ TEST_F(SpecialManagerTest, info2) {
 		"tpic       TPIC specials\n";
 	EXPECT_EQ(oss.str(), expected);
 }
+
+
+TEST_F(SpecialManagerTest, carriesPageState) {
+	SpecialManager &sm = SpecialManager::instance();
+	sm.unregisterHandlers();
+	sm.registerHandlers(handlers, "");
+	EXPECT_TRUE(sm.carriesPageState("color push Red"));
+	EXPECT_TRUE(sm.carriesPageState("em:point 1"));
+	EXPECT_TRUE(sm.carriesPageState("pn 20"));
+	EXPECT_FALSE(sm.carriesPageState("background Red"));
+	EXPECT_FALSE(sm.carriesPageState("papersize=10cm,20cm"));
+	EXPECT_FALSE(sm.carriesPageState("unknown:special"));
+	sm.unregisterHandlers();
+}
+
+
+/** Special handler that collects the processed specials until it's asked to flush them. */
+class DeferringSpecialHandler : public SpecialHandler {
+	public:
+		explicit DeferringSpecialHandler (string &output) : _output(output) {}
+		const char* info () const override {return "deferring test handler";}
+		const char* name () const override {return "defer";}
+		vector<const char*> prefixes () const override {return {"defer:"};}
+		bool process (const string &prefix, istream &is, SpecialActions &actions) override {
+			_pending += string(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+			return true;
+		}
+		bool hasPendingOutput () const override {return !_pending.empty();}
+		void flushPendingOutput () override {_output += "["+_pending+"]"; _pending.clear();}
+
+	private:
+		string &_output;
+		string _pending;
+};
+
+
+TEST_F(SpecialManagerTest, pendingOutput) {
+	string output;
+	SpecialManager &sm = SpecialManager::instance();
+	sm.unregisterHandlers();
+	handlers.emplace_back(util::make_unique<DeferringSpecialHandler>(output));
+	sm.registerHandlers(handlers, "");
+	EmptySpecialActions actions;
+	sm.process("defer:a", 1, actions);
+	sm.process("defer:b", 1, actions);
+	EXPECT_EQ(output, "");
+	sm.process("color push Red", 1, actions);  // specials of other handlers trigger the output
+	EXPECT_EQ(output, "[ab]");
+	sm.process("defer:c", 1, actions);
+	sm.flushPendingOutput();
+	EXPECT_EQ(output, "[ab][c]");
+	sm.flushPendingOutput();
+	EXPECT_EQ(output, "[ab][c]");
+	sm.process("defer:d", 1, actions);
+	sm.notifyEndPage(1, actions);
+	EXPECT_EQ(output, "[ab][c][d]");
+	sm.unregisterHandlers();
+}
@@ -19,6 +19,8 @@
 *************************************************************************/
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "Color.hpp"
 #include "TensorProductPatch.hpp"
@@ -307,6 +309,124 @@ TEST_F(TensorProductPatchTest, approximate) {
 
 
 
+TEST_F(TensorProductPatchTest, approximateAdaptive) {
+	Callback callback;
+	vector<Color> colors(4);
+	colors[0].setRGB(1.0, 0.0, 0.0);
+	colors[1].setRGB(1.0, 0.0, 0.0);
+	colors[2].setRGB(0.0, 0.0, 1.0);
+	colors[3].setRGB(0.0, 0.0, 1.0);
+	// colors change along the horizontal axis only => single row
+	TensorProductPatch tpp(_points, colors, Color::ColorSpace::RGB, 0, 0);
+	tpp.approximateAdaptive(20, false, 0.25, 0.25, callback);
+	EXPECT_EQ(callback.colorstr(), "#df0020#a00060#6000a0#2000df");
+	string pathstr = callback.pathstr();
+	EXPECT_EQ(count(pathstr.begin(), pathstr.end(), 'Z'), 4);
+
+	// identical patches are taken from the cache
+	callback.reset();
+	TensorProductPatch tpp2(_points, colors, Color::ColorSpace::RGB, 0, 0);
+	tpp2.approximateAdaptive(20, false, 0.25, 0.25, callback);
+	EXPECT_EQ(callback.pathstr(), pathstr);
+
+	// number of segments is limited by the grid size
+	callback.reset();
+	tpp.approximateAdaptive(2, false, 0.25, 0.25, callback);
+	EXPECT_EQ(callback.colorstr(), "#c00040#4000c0");
+
+	// segments of the same color are merged
+	callback.reset();
+	colors[2].setRGB(uint8_t(255), 0, 1);
+	colors[3].setRGB(uint8_t(255), 0, 1);
+	TensorProductPatch tpp3(_points, colors, Color::ColorSpace::RGB, 0, 0);
+	tpp3.approximateAdaptive(20, false, 0.001, 0.001, callback);
+	EXPECT_EQ(callback.colorstr(), "#f00#ff0001");
+
+	// the tolerance only affects the shape of the segment boundaries
+	callback.reset();
+	tpp.approximateAdaptive(20, false, 0.25, 0, callback);
+	EXPECT_EQ(callback.colorstr(), "#df0020#a00060#6000a0#2000df");
+	string curved = callback.pathstr();
+	callback.reset();
+	tpp.approximateAdaptive(20, false, 0.25, 1000, callback);
+	EXPECT_EQ(callback.colorstr(), "#df0020#a00060#6000a0#2000df");
+	string straight = callback.pathstr();
+	EXPECT_NE(curved.find('C'), string::npos);
+	EXPECT_EQ(straight.find('C'), string::npos);
+}
+
+
+/** Collects the vertices of the segments, which must be polygons. */
+class PolygonCallback : public ShadingPatch::Callback {
+	using Polygon = vector<DPair>;
+	public:
+		void patchSegment (GraphicsPath<double> &path, const Color &color) override {
+			struct : GraphicsPath<double>::Actions {
+				void moveto (const DPair &p) override {polygon.push_back(p);}
+				void lineto (const DPair &p) override {polygon.push_back(p);}
+				Polygon polygon;
+			} actions;
+			path.iterate(actions, false);
+			_polygons.push_back(actions.polygon);
+		}
+
+		/** Returns true if a vertex of a polygon lies on an edge of another one without being
+		 *  a vertex of it too. */
+		bool hasTJunctions () const {
+			for (const Polygon &polygon : _polygons) {
+				for (size_t i=0; i < polygon.size(); i++) {
+					DPair a = polygon[i];
+					DPair ab = polygon[(i+1)%polygon.size()]-a;
+					for (const Polygon &other : _polygons) {
+						for (const DPair &p : other) {
+							DPair ap = p-a;
+							double t = (ap.x()*ab.x() + ap.y()*ab.y())/(ab.x()*ab.x() + ab.y()*ab.y());
+							double dist = fabs(ab.x()*ap.y() - ab.y()*ap.x())/ab.length();
+							if (t > 1e-6 && t < 1-1e-6 && dist < 1e-6 && !isVertex(p, polygon))
+								return true;
+						}
+					}
+				}
+			}
+			return false;
+		}
+
+		size_t size () const {return _polygons.size();}
+
+	protected:
+		static bool isVertex (const DPair &p, const Polygon &polygon) {
+			for (const DPair &q : polygon)
+				if ((p-q).length() < 1e-6)
+					return true;
+			return false;
+		}
+
+	private:
+		vector<Polygon> _polygons;
+};
+
+
+TEST_F(TensorProductPatchTest, approximateAdaptiveTJunctions) {
+	// flat patch with straight isoparametric lines, given in "spiral" order
+	int rows[] = {0, 1, 2, 3, 3, 3, 3, 2, 1, 0, 0, 0, 1, 2, 2, 1};
+	int cols[] = {0, 0, 0, 0, 1, 2, 3, 3, 3, 3, 2, 1, 1, 1, 2, 2};
+	vector<DPair> points;
+	for (int i=0; i < 16; i++)
+		points.emplace_back(10*cols[i], 10*rows[i]);
+	// the colors vary along one boundary only, so that the rows are divided differently
+	vector<Color> colors(4);
+	colors[0].setRGB(1.0, 0.0, 0.0);
+	colors[1].setRGB(1.0, 0.0, 0.0);
+	colors[2].setRGB(1.0, 0.0, 0.0);
+	colors[3].setRGB(0.0, 0.0, 1.0);
+	TensorProductPatch tpp(points, colors, Color::ColorSpace::RGB, 0, 0);
+	PolygonCallback callback;
+	tpp.approximateAdaptive(20, false, 0.1, 0.1, callback);
+	EXPECT_GT(callback.size(), 10u);
+	EXPECT_FALSE(callback.hasTJunctions());
+}
+
+
 TEST_F(TensorProductPatchTest, fail) {
 	// edge flag == 0
 	vector<DPair> points(15);
@@ -0,0 +1,116 @@
+/*************************************************************************
+** XMLBenchmark.cpp                                                     **
+**                                                                      **
+** This file is part of dvisvgm -- a fast DVI to SVG converter          **
+** Copyright (C) 2005-2019 Martin Gieseking <martin.gieseking@uos.de>   **
+**                                                                      **
+** This program is free software; you can redistribute it and/or        **
+** modify it under the terms of the GNU General Public License as       **
+** published by the Free Software Foundation; either version 3 of       **
+** the License, or (at your option) any later version.                  **
+**                                                                      **
+** This program is distributed in the hope that it will be useful, but  **
+** WITHOUT ANY WARRANTY; without even the implied warranty of           **
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the         **
+** GNU General Public License for more details.                         **
+**                                                                      **
+** You should have received a copy of the GNU General Public License    **
+** along with this program; if not, see <http://www.gnu.org/licenses/>. **
+*************************************************************************/
+
+// Measures the heap allocations and the time needed to build, serialize, and
+// release the XML trees of glyph-heavy pages. The trees resemble those created
+// by dvisvgm for pages with many characters: with option --no-merge, every glyph
+// is a separate element, otherwise runs of glyphs are merged into text elements.
+// The third run adds hyperlink areas, which are prepended to the page element.
+// The benchmark is not run by 'make check'. Build and run it with
+//   make XMLBenchmark && ./XMLBenchmark [pages [glyphs per page [links per page]]]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include "XMLNode.hpp"
+
+using namespace std;
+
+static size_t allocations = 0;
+
+void* operator new (size_t size) {
+	allocations++;
+	if (void *ptr = malloc(size ? size : 1))
+		return ptr;
+	throw bad_alloc();
+}
+
+void operator delete (void *ptr) noexcept {free(ptr);}
+void operator delete (void *ptr, size_t) noexcept {free(ptr);}
+
+
+class NullBuffer : public streambuf {
+	protected:
+		int overflow (int c) override {return c;}
+		streamsize xsputn (const char*, streamsize n) override {return n;}
+};
+
+
+/** Builds the tree of a single page. Each glyph is a separate element if merge
+ *  is false, otherwise runs of 40 glyphs share a text element. */
+static unique_ptr<XMLElementNode> create_page (int pageno, int glyphs, bool merge, int links) {
+	auto page = util::make_unique<XMLElementNode>("g");
+	page->addAttribute("id", "page"+to_string(pageno));
+	for (int i=0; i < glyphs; i++) {
+		double x = (i%80)*5.98, y = (i/80)*11.95;
+		if (!merge) {
+			auto use = util::make_unique<XMLElementNode>("use");
+			use->addAttribute("x", x);
+			use->addAttribute("y", y);
+			use->addAttribute("xlink:href", "#g0-"+to_string(65+i%26));
+			page->append(std::move(use));
+		}
+		else if (i%40 == 0) {
+			auto text = util::make_unique<XMLElementNode>("text");
+			text->addAttribute("class", "f0");
+			text->addAttribute("x", x);
+			text->addAttribute("y", y);
+			text->append(string(40, char('a'+i%26)));
+			page->append(std::move(text));
+		}
+	}
+	// the areas of hyperlinks are placed below the page contents
+	for (int i=0; i < links; i++) {
+		auto rect = util::make_unique<XMLElementNode>("rect");
+		rect->addAttribute("x", i*5.98);
+		rect->addAttribute("y", 72);
+		rect->addAttribute("width", 30);
+		rect->addAttribute("height", 11.95);
+		page->prepend(std::move(rect));
+	}
+	return page;
+}
+
+
+static void run (const char *label, int pages, int glyphs, bool merge, int links=0) {
+	ostream os(new NullBuffer);
+	size_t allocs = allocations;
+	auto start = chrono::steady_clock::now();
+	for (int i=1; i <= pages; i++) {
+		auto page = create_page(i, glyphs, merge, links);
+		page->write(os);
+	}
+	chrono::duration<double> seconds = chrono::steady_clock::now()-start;
+	cout << label << ' ' << (allocations-allocs) << " allocations, " << seconds.count() << " seconds\n";
+	delete os.rdbuf();
+}
+
+
+int main (int argc, char *argv[]) {
+	int pages = argc > 1 ? atoi(argv[1]) : 200;
+	int glyphs = argc > 2 ? atoi(argv[2]) : 2000;
+	int links = argc > 3 ? atoi(argv[3]) : 200;
+	cout << pages << " pages with " << glyphs << " glyphs each\n";
+	run("default:          ", pages, glyphs, true);
+	run("--no-merge:       ", pages, glyphs, false);
+	run("--no-merge, links:", pages, glyphs, false, links);
+}
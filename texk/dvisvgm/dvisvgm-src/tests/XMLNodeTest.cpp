@@ -303,3 +303,46 @@ TEST(XMLNodeTest, cdata) {
 	EXPECT_EQ(str, "<root><element/><![CDATA[text & <text>]]></root>");
 }
 
+
+
+TEST(XMLNodeTest, serialized) {
+	// build the same element twice, the second time with serialized leading children
+	XMLElementNode root1("root"), root2("root");
+	for (XMLElementNode *root : {&root1, &root2}) {
+		root->append(util::make_unique<XMLElementNode>("a"));
+		root->append("text");
+		root->append(util::make_unique<XMLElementNode>("b"));
+		root->append(util::make_unique<XMLElementNode>("c"));
+		root->append(util::make_unique<XMLElementNode>("d"));
+	}
+	auto serializedNode = util::make_unique<XMLSerializedNode>();
+	EXPECT_TRUE(serializedNode->empty());
+	vector<XMLNode*> nodes;
+	for (size_t i=0; i < 4; i++)
+		nodes.push_back(root2.children()[i].get());
+	for (XMLNode *node : nodes) {
+		serializedNode->append(*node);
+		root2.remove(node);
+	}
+	EXPECT_FALSE(serializedNode->empty());
+	root2.prepend(std::move(serializedNode));
+	EXPECT_EQ(root2.children().size(), 2u);
+	ostringstream oss1, oss2;
+	root1.write(oss1);
+	root2.write(oss2);
+	EXPECT_EQ(oss1.str(), "<root>\n<a/>text<b/>\n<c/>\n<d/>\n</root>");
+	EXPECT_EQ(oss2.str(), oss1.str());
+}
+
+
+TEST(XMLNodeTest, internedNames) {
+	XMLElementNode elem1("text"), elem2("text"), elem3("tspan");
+	EXPECT_EQ(&elem1.getName(), &elem2.getName());
+	EXPECT_NE(&elem1.getName(), &elem3.getName());
+	EXPECT_EQ(&XMLElementNode::internName("text"), &elem1.getName());
+	auto elem4 = util::make_unique<XMLElementNode>(elem3);
+	EXPECT_EQ(&elem4->getName(), &elem3.getName());
+	elem4->addAttribute("x", 1);
+	elem4->addAttribute("x", 2);
+	EXPECT_STREQ(elem4->getAttributeValue("x"), "2");
+}
@@ -31,6 +31,12 @@
 #include <kpathsea/tex-file.h>
 #include <kpathsea/variable.h>
 
+/* Compiled ls-R indexes are mapped into memory; not on DOS or Windows.  */
+#ifndef DOSISH
+#define DB_INDEX
+#include <sys/mman.h>
+#endif
+
 #ifndef DB_HASH_SIZE
 /* Based on the size of 2014 texmf-dist/ls-R, about 130,000 entries.  */
 #define DB_HASH_SIZE 64007
@@ -56,6 +62,11 @@ static string db_names[] = {
     NULL
 };
 
+/* The index of an ls-R file is kept next to it, as ls-R.idx.  */
+#ifndef DB_INDEX_SUFFIX
+#define DB_INDEX_SUFFIX ".idx"
+#endif
+
 #ifndef ALIAS_NAME
 #define ALIAS_NAME "aliases"
 #endif
@@ -82,6 +93,484 @@ ignore_dir_p (const_string dirname)
   return false;
 }
 
+/* Return true if LINE (of length LEN) is a directory line `/foo:' or
+   `./foo:' of an ls-R file.  */
+
+static boolean
+db_dir_line_p (kpathsea kpse, const_string line, unsigned len)
+{
+  return len > 0 && line[len - 1] == ':'
+         && kpathsea_absolute_p (kpse, line, true);
+}
+
+/* Return true if LINE of an ls-R file names a file, i.e., is not
+   blank, `.' or `..'.  */
+
+static boolean
+db_file_line_p (const_string line)
+{
+  return *line != 0
+         && !(*line == '.' && (line[1] == 0 || (line[1] == '.' && line[2] == 0)));
+}
+
+#ifdef DB_INDEX
+/* An ls-R index holds the same (file name, directory) pairs that
+   db_build would put in the hash table, laid out so that it can be
+   mapped into memory and searched in place.  All numbers are in native
+   byte order; an index written on another kind of machine is ignored.
+
+   The header below is followed by
+     buckets: BUCKET_COUNT slots of an open-addressing hash table with
+              linear probing on db_index_hash, each 0 (empty) or one
+              more than an index into NAMES;
+     names:   NAME_COUNT distinct file names, each with its hash and its
+              slice of VALUES;
+     values:  VALUE_COUNT directory indexes, each name's in ls-R order;
+     dirs:    DIR_COUNT directories, with a flag saying whether they are
+              relative to the directory of ls-R;
+     strings: the NUL-terminated names of files and directories.  */
+
+#define DB_INDEX_MAGIC "kpseidx"
+#define DB_INDEX_VERSION 1
+#define DB_INDEX_BYTE_ORDER 0x01020304
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t db_size;             /* Identity of the ls-R file indexed.  */
+  int64_t db_mtime;
+  uint64_t db_ino;
+  uint32_t file_size;           /* Size of the whole index.  */
+  uint32_t bucket_count;        /* A power of two.  */
+  uint32_t name_count;
+  uint32_t value_count;
+  uint32_t dir_count;
+  uint32_t buckets;             /* File offsets of the tables.  */
+  uint32_t names;
+  uint32_t values;
+  uint32_t dirs;
+  uint32_t strings;
+} db_index_header;
+
+typedef struct
+{
+  uint32_t name;                /* Offset into strings.  */
+  uint32_t hash;
+  uint32_t first;               /* Slice of values.  */
+  uint32_t count;
+} db_index_name;
+
+typedef struct
+{
+  uint32_t name;                /* Offset into strings.  */
+  uint32_t relative;
+} db_index_dir;
+
+/* A mapped index, as listed in kpse->db_index.  */
+struct db_index_struct
+{
+  const char *base;
+  const db_index_header *header;
+  string top_dir;               /* Directory of ls-R, with the /.  */
+  const_string *dir_names;      /* Full directory names, made as needed.  */
+  unsigned position;            /* Of top_dir in kpse->db_dir_list.  */
+  struct db_index_struct *next;
+};
+
+static uint32_t
+db_index_hash (const_string key)
+{
+  uint32_t h = 2166136261U;     /* FNV-1a */
+
+  while (*key)
+    h = (h ^ (unsigned char) *key++) * 16777619U;
+
+  return h;
+}
+
+/* Return true if the ls-R file with status ST is the one HEADER was
+   made from.  mktexlsr replaces ls-R and mktexupd appends to it, so
+   either changes at least one of these.  */
+
+static boolean
+db_index_current_p (const db_index_header *header, const struct stat *st)
+{
+  return header->db_size == (uint64_t) st->st_size
+         && header->db_mtime == (int64_t) st->st_mtime
+         && header->db_ino == (uint64_t) st->st_ino;
+}
+
+/* Return true if COUNT elements of SIZE bytes each, starting at the
+   aligned OFFSET, fit in an index of SIZE_ALL bytes.  */
+
+static boolean
+db_index_table_p (uint32_t offset, uint32_t count, size_t size,
+                  size_t size_all)
+{
+  return offset % sizeof (uint32_t) == 0 && offset <= size_all
+         && (size_all - offset) / size >= count;
+}
+
+/* Return true if the SIZE bytes at BASE, with a valid header, are a
+   well-formed index: all tables lie within the index, and all offsets
+   and indexes stored in them are in range, so that db_index_lookup
+   needs no further checks.  */
+
+static boolean
+db_index_valid_p (const char *base, size_t size)
+{
+  const db_index_header *header = (const db_index_header *) base;
+  const uint32_t *buckets, *values;
+  const db_index_name *names;
+  const db_index_dir *dirs;
+  uint32_t strings_size, used = 0, i;
+
+  if (header->bucket_count == 0
+      || (header->bucket_count & (header->bucket_count - 1)) != 0
+      || !db_index_table_p (header->buckets, header->bucket_count,
+                            sizeof (uint32_t), size)
+      || !db_index_table_p (header->names, header->name_count,
+                            sizeof (db_index_name), size)
+      || !db_index_table_p (header->values, header->value_count,
+                            sizeof (uint32_t), size)
+      || !db_index_table_p (header->dirs, header->dir_count,
+                            sizeof (db_index_dir), size)
+      || header->strings >= size || base[size - 1] != 0)
+    return false;
+
+  buckets = (const uint32_t *) (base + header->buckets);
+  names = (const db_index_name *) (base + header->names);
+  values = (const uint32_t *) (base + header->values);
+  dirs = (const db_index_dir *) (base + header->dirs);
+  strings_size = size - header->strings;
+
+  for (i = 0; i < header->bucket_count; i++) {
+    if (buckets[i] > header->name_count)
+      return false;
+    used += buckets[i] != 0;
+  }
+  /* The lookup stops at the first empty bucket; there must be one.  */
+  if (used == header->bucket_count)
+    return false;
+  for (i = 0; i < header->name_count; i++)
+    if (names[i].name >= strings_size
+        || names[i].first > header->value_count
+        || names[i].count > header->value_count - names[i].first)
+      return false;
+  for (i = 0; i < header->value_count; i++)
+    if (values[i] >= header->dir_count)
+      return false;
+  for (i = 0; i < header->dir_count; i++)
+    if (dirs[i].name >= strings_size)
+      return false;
+
+  return true;
+}
+
+/* If DB_FILENAME has an up-to-date index, map it, append it to
+   kpse->db_index and return true.  TOP_DIR is the directory of
+   DB_FILENAME.  */
+
+static boolean
+db_index_read (kpathsea kpse, const_string db_filename, const_string top_dir)
+{
+  struct stat st, db_st;
+  const db_index_header *header;
+  void *base;
+  struct db_index_struct *idx, **tail;
+  string index_name = concat (db_filename, DB_INDEX_SUFFIX);
+  int fd = open (index_name, O_RDONLY);
+
+  if (fd < 0) {
+    free (index_name);
+    return false;
+  }
+  if (fstat (fd, &st) != 0 || st.st_size < (off_t) sizeof (db_index_header)
+      || (base = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0))
+         == MAP_FAILED) {
+    close (fd);
+    free (index_name);
+    return false;
+  }
+  close (fd);
+
+  header = (const db_index_header *) base;
+  if (memcmp (header->magic, DB_INDEX_MAGIC, sizeof (header->magic)) != 0
+      || header->version != DB_INDEX_VERSION
+      || header->byte_order != DB_INDEX_BYTE_ORDER
+      || header->file_size != (uint64_t) st.st_size
+      || !db_index_valid_p ((const char *) base, st.st_size)
+      || stat (db_filename, &db_st) != 0
+      || !db_index_current_p (header, &db_st)) {
+#ifdef KPSE_DEBUG
+    if (KPATHSEA_DEBUG_P (KPSE_DEBUG_HASH))
+      DEBUGF1 ("db:init(): ignoring stale or unusable %s.\n", index_name);
+#endif
+    munmap (base, st.st_size);
+    free (index_name);
+    return false;
+  }
+
+  idx = XTALLOC1 (struct db_index_struct);
+  idx->base = (const char *) base;
+  idx->header = header;
+  idx->top_dir = xstrdup (top_dir);
+  idx->dir_names = (const_string *) xcalloc (header->dir_count,
+                                             sizeof (const_string));
+  idx->position = STR_LIST_LENGTH (kpse->db_dir_list);
+  idx->next = NULL;
+  for (tail = &(kpse->db_index); *tail; tail = &((*tail)->next))
+    ;
+  *tail = idx;
+
+#ifdef KPSE_DEBUG
+  if (KPATHSEA_DEBUG_P (KPSE_DEBUG_HASH))
+    DEBUGF4 ("%s: %u entries in %u directories, from %s.\n", db_filename,
+             (unsigned) header->value_count, (unsigned) header->dir_count,
+             index_name);
+#endif
+  free (index_name);
+
+  return true;
+}
+
+/* Add the directories in which IDX has the file NAME to RET.  */
+
+static void
+db_index_lookup (struct db_index_struct *idx, const_string name,
+                 cstr_list_type *ret)
+{
+  const db_index_header *header = idx->header;
+  const uint32_t *buckets = (const uint32_t *) (idx->base + header->buckets);
+  const db_index_name *names
+    = (const db_index_name *) (idx->base + header->names);
+  const uint32_t *values = (const uint32_t *) (idx->base + header->values);
+  const db_index_dir *dirs = (const db_index_dir *) (idx->base + header->dirs);
+  const char *strings = idx->base + header->strings;
+  uint32_t mask = header->bucket_count - 1;
+  uint32_t h = db_index_hash (name);
+  uint32_t b, v;
+
+  for (b = h & mask; buckets[b] != 0; b = (b + 1) & mask) {
+    const db_index_name *n = &names[buckets[b] - 1];
+
+    if (n->hash == h && STREQ (strings + n->name, name)) {
+      for (v = n->first; v < n->first + n->count; v++) {
+        uint32_t d = values[v];
+
+        if (!idx->dir_names[d]) {
+          const_string dir = strings + dirs[d].name;
+          idx->dir_names[d] = dirs[d].relative ? concat (idx->top_dir, dir)
+                                               : dir;
+        }
+        cstr_list_add (ret, idx->dir_names[d]);
+      }
+      break;
+    }
+  }
+}
+#endif /* DB_INDEX */
+
+/* Write an index of the ls-R file DB_FILENAME to DB_FILENAME.idx, for
+   db_build to use instead of DB_FILENAME until that changes.  Return
+   true if successful.  */
+
+boolean
+kpathsea_db_make_index (kpathsea kpse, const_string db_filename)
+{
+#ifdef DB_INDEX
+  struct stat st, st_after;
+  FILE *f;
+  string line;
+  string *files = NULL, *dir_strings = NULL;
+  uint32_t *file_dir = NULL, *dir_relative = NULL;
+  uint32_t file_count = 0, file_alloc = 0, dir_count = 0, dir_alloc = 0;
+  uint32_t cur_dir = 0, name_count = 0, strings_size = 0;
+  boolean in_dir = false;
+  uint32_t bucket_count, mask, *buckets, *first_file, *last_file, *next_file;
+  uint32_t *values, i, b, v;
+  db_index_name *names;
+  db_index_dir *dirs;
+  db_index_header header;
+  string index_name, tmp_name;
+  int fd;
+  boolean ok;
+
+  if (stat (db_filename, &st) != 0
+      || (f = fopen (db_filename, FOPEN_R_MODE)) == NULL) {
+    perror (db_filename);
+    return false;
+  }
+
+  /* Collect the entries as db_build does.  */
+  while ((line = read_line (f)) != NULL) {
+    unsigned len = strlen (line);
+
+    if (db_dir_line_p (kpse, line, len)) {
+      in_dir = !ignore_dir_p (line);
+      if (in_dir) {
+        line[len - 1] = DIR_SEP;
+        if (dir_count == dir_alloc) {
+          dir_alloc += dir_alloc + 1024;
+          XRETALLOC (dir_strings, dir_alloc, string);
+          XRETALLOC (dir_relative, dir_alloc, uint32_t);
+        }
+        /* Relative names get the directory of ls-R prepended when
+           they are used, as in db_build.  */
+        dir_relative[dir_count] = *line == '.';
+        dir_strings[dir_count] = xstrdup (*line == '.' ? line + 2 : line);
+        cur_dir = dir_count++;
+      }
+    } else if (in_dir && db_file_line_p (line)) {
+      if (file_count == file_alloc) {
+        file_alloc += file_alloc + 16384;
+        XRETALLOC (files, file_alloc, string);
+        XRETALLOC (file_dir, file_alloc, uint32_t);
+      }
+      files[file_count] = line;
+      file_dir[file_count++] = cur_dir;
+      continue;
+    }
+    free (line);
+  }
+  xfclose (f, db_filename);
+
+  if (file_count == 0) {
+    WARNING1 ("kpathsea: %s: No usable entries in ls-R", db_filename);
+    return false;
+  }
+
+  /* Group the entries by file name, keeping the ls-R order.  */
+  for (bucket_count = 1024; bucket_count < 2 * file_count; bucket_count *= 2)
+    ;
+  mask = bucket_count - 1;
+  buckets = (uint32_t *) xcalloc (bucket_count, sizeof (uint32_t));
+  names = XTALLOC (file_count, db_index_name);
+  first_file = XTALLOC (file_count, uint32_t);
+  last_file = XTALLOC (file_count, uint32_t);
+  next_file = XTALLOC (file_count, uint32_t);
+  for (i = 0; i < file_count; i++) {
+    uint32_t h = db_index_hash (files[i]);
+
+    next_file[i] = file_count;
+    for (b = h & mask; buckets[b] != 0; b = (b + 1) & mask) {
+      db_index_name *n = &names[buckets[b] - 1];
+      if (n->hash == h && STREQ (files[first_file[buckets[b] - 1]], files[i]))
+        break;
+    }
+    if (buckets[b] == 0) {
+      names[name_count].name = strings_size;
+      names[name_count].hash = h;
+      names[name_count].count = 0;
+      strings_size += strlen (files[i]) + 1;
+      first_file[name_count] = i;
+      buckets[b] = ++name_count;
+    } else {
+      next_file[last_file[buckets[b] - 1]] = i;
+    }
+    last_file[buckets[b] - 1] = i;
+    names[buckets[b] - 1].count++;
+  }
+
+  values = XTALLOC (file_count, uint32_t);
+  for (i = 0, v = 0; i < name_count; i++) {
+    uint32_t e;
+    names[i].first = v;
+    for (e = first_file[i]; e < file_count; e = next_file[e])
+      values[v++] = file_dir[e];
+  }
+
+  /* The directory names follow the file names in the string pool.  */
+  dirs = XTALLOC (dir_count ? dir_count : 1, db_index_dir);
+  for (i = 0; i < dir_count; i++) {
+    dirs[i].name = strings_size;
+    dirs[i].relative = dir_relative[i];
+    strings_size += strlen (dir_strings[i]) + 1;
+  }
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, DB_INDEX_MAGIC, sizeof (header.magic));
+  header.version = DB_INDEX_VERSION;
+  header.byte_order = DB_INDEX_BYTE_ORDER;
+  header.db_size = st.st_size;
+  header.db_mtime = st.st_mtime;
+  header.db_ino = st.st_ino;
+  header.bucket_count = bucket_count;
+  header.name_count = name_count;
+  header.value_count = file_count;
+  header.dir_count = dir_count;
+  header.buckets = sizeof (header);
+  header.names = header.buckets + bucket_count * sizeof (uint32_t);
+  header.values = header.names + name_count * sizeof (db_index_name);
+  header.dirs = header.values + file_count * sizeof (uint32_t);
+  header.strings = header.dirs + dir_count * sizeof (db_index_dir);
+  header.file_size = header.strings + strings_size;
+
+  index_name = concat (db_filename, DB_INDEX_SUFFIX);
+  /* Write to a fresh file next to the index and rename it, so that
+     readers see either the old or the new index, and concurrent
+     writers do not get in each other's way.  */
+  tmp_name = concat (index_name, ".XXXXXX");
+  fd = mkstemp (tmp_name);
+  f = fd < 0 ? NULL : fdopen (fd, FOPEN_WBIN_MODE);
+  if (fd >= 0 && f == NULL) {
+    close (fd);
+    unlink (tmp_name);
+  }
+  ok = f != NULL;
+  if (ok) {
+    fwrite (&header, sizeof (header), 1, f);
+    fwrite (buckets, sizeof (uint32_t), bucket_count, f);
+    fwrite (names, sizeof (db_index_name), name_count, f);
+    fwrite (values, sizeof (uint32_t), file_count, f);
+    fwrite (dirs, sizeof (db_index_dir), dir_count, f);
+    for (i = 0; i < name_count; i++)
+      fwrite (files[first_file[i]], 1, strlen (files[first_file[i]]) + 1, f);
+    for (i = 0; i < dir_count; i++)
+      fwrite (dir_strings[i], 1, strlen (dir_strings[i]) + 1, f);
+    ok = !ferror (f);
+    ok = fclose (f) == 0 && ok;
+    /* Give up if ls-R changed while we were reading it.  */
+    ok = ok && stat (db_filename, &st_after) == 0
+         && st_after.st_size == st.st_size
+         && st_after.st_mtime == st.st_mtime
+         && st_after.st_ino == st.st_ino;
+    ok = ok && chmod (tmp_name, st.st_mode & 0777) == 0
+         && rename (tmp_name, index_name) == 0;
+    if (!ok)
+      unlink (tmp_name);
+  }
+  if (!ok)
+    perror (index_name);
+
+  for (i = 0; i < file_count; i++)
+    free (files[i]);
+  for (i = 0; i < dir_count; i++)
+    free (dir_strings[i]);
+  free (files);
+  free (file_dir);
+  free (dir_strings);
+  free (dir_relative);
+  free (buckets);
+  free (names);
+  free (first_file);
+  free (last_file);
+  free (next_file);
+  free (values);
+  free (dirs);
+  free (index_name);
+  free (tmp_name);
+
+  return ok;
+#else /* not DB_INDEX */
+  WARNING1 ("kpathsea: %s: ls-R indexes are not supported here",
+            db_filename);
+  return false;
+#endif /* not DB_INDEX */
+}
+
 /* If no DB_FILENAME, return false (maybe they aren't using this feature).
    Otherwise, add entries from DB_FILENAME to TABLE, and return true.  */
 
@@ -93,7 +582,7 @@ db_build (kpathsea kpse, hash_table_type *table,  const_string db_filename)
   unsigned len = strlen (db_filename) - sizeof (DB_NAME) + 1; /* Keep the /. */
   string top_dir = (string)xmalloc (len + 1);
   string cur_dir = NULL; /* First thing in ls-R might be a filename.  */
-  FILE *db_file = fopen (db_filename, FOPEN_R_MODE);
+  FILE *db_file;
 #if defined(MONOCASE_FILENAMES)
   string pp;
 #endif /* MONOCASE_FILENAMES */
@@ -101,6 +590,15 @@ db_build (kpathsea kpse, hash_table_type *table,  const_string db_filename)
   strncpy (top_dir, db_filename, len);
   top_dir[len] = 0;
 
+#ifdef DB_INDEX
+  /* Use the index instead of reading ls-R, if it is current.  */
+  if (db_index_read (kpse, db_filename, top_dir)) {
+    str_list_add (&(kpse->db_dir_list), top_dir);
+    return true;
+  }
+#endif
+
+  db_file = fopen (db_filename, FOPEN_R_MODE);
   if (db_file) {
     while ((line = read_line (db_file)) != NULL) {
       len = strlen (line);
@@ -120,8 +618,7 @@ db_build (kpathsea kpse, hash_table_type *table,  const_string db_filename)
          and explicitly relative (./...) names here.  It's a kludge to
          pass in the directory name with the trailing : still attached,
          but it doesn't actually hurt.  */
-      if (len > 0 && line[len - 1] == ':'
-          && kpathsea_absolute_p (kpse, line, true)) {
+      if (db_dir_line_p (kpse, line, len)) {
         /* New directory line.  */
         if (!ignore_dir_p (line)) {
           /* If they gave a relative name, prepend full directory name now.  */
@@ -137,10 +634,7 @@ db_build (kpathsea kpse, hash_table_type *table,  const_string db_filename)
         }
 
       /* Ignore blank, `.' and `..' lines.  */
-      } else if (*line != 0 && cur_dir   /* a file line? */
-                 && !(*line == '.'
-                      && (line[1] == 0 || (line[1] == '.' && line[2] == 0))))
-      {
+      } else if (cur_dir && db_file_line_p (line)) { /* a file line? */
         /* Make a new hash table entry with a key of `line' and a data
            of `cur_dir'.  An already-existing identical key is ok, since
            a file named `foo' can be in more than one directory.  Share
@@ -211,6 +705,9 @@ kpathsea_db_insert (kpathsea kpse, const_string passed_fname)
 
     /* Note that we do not assuse that these names have been normalized. */
     hash_insert (&(kpse->db), file_part, dir_part);
+
+    /* Earlier lookups of this file failed.  */
+    kpathsea_find_file_cache_flush (kpse);
   }
 }
 
@@ -331,6 +828,92 @@ elt_in_db (const_string db_dir,  const_string path_elt)
   return found;
 }
 
+#ifdef DB_INDEX
+/* Return the position in kpse->db_dir_list of the ls-R file read as
+   text that DIR came from: the one whose directory is the longest
+   prefix of DIR.  Return the length of the list if there is none, as
+   for names added by kpathsea_db_insert outside of any tree.  */
+
+static unsigned
+db_text_position (kpathsea kpse, const_string dir)
+{
+  struct db_index_struct *idx = kpse->db_index;
+  unsigned e, best = STR_LIST_LENGTH (kpse->db_dir_list);
+  size_t best_len = 0;
+
+  for (e = 0; e < STR_LIST_LENGTH (kpse->db_dir_list); e++) {
+    const_string top = STR_LIST_ELT (kpse->db_dir_list, e);
+    size_t len = strlen (top);
+
+    while (idx && idx->position < e)
+      idx = idx->next;
+    if (idx && idx->position == e)
+      continue;
+    if (len > best_len && strncmp (dir, top, len) == 0) {
+      best = e;
+      best_len = len;
+    }
+  }
+
+  return best;
+}
+#endif /* DB_INDEX */
+
+/* Return the NULL-terminated list of directories which have a file
+   NAME according to the databases, or NULL, like hash_lookup.  The
+   directories come in the order of the ls-R files, whether these were
+   read as text or through an index; names added by kpathsea_db_insert
+   outside of any tree come last.  */
+
+static const_string *
+db_lookup (kpathsea kpse, const_string name)
+{
+#ifdef DB_INDEX
+  struct db_index_struct *idx;
+  cstr_list_type ret;
+  const_string *r, *more;
+  unsigned e, *positions = NULL;
+
+  if (!kpse->db_index)
+    return hash_lookup (kpse->db, name);
+
+  ret = cstr_list_init ();
+  more = hash_lookup (kpse->db, name);
+  if (more) {
+    for (r = more; *r; r++)
+      ;
+    positions = XTALLOC (r - more, unsigned);
+    for (r = more; *r; r++)
+      positions[r - more] = db_text_position (kpse, *r);
+  }
+
+  idx = kpse->db_index;
+  for (e = 0; e <= STR_LIST_LENGTH (kpse->db_dir_list); e++) {
+    if (idx && idx->position == e) {
+      db_index_lookup (idx, name, &ret);
+      idx = idx->next;
+    } else if (more) {
+      for (r = more; *r; r++)
+        if (positions[r - more] == e)
+          cstr_list_add (&ret, *r);
+    }
+  }
+
+  if (more) {
+    free (positions);
+    free ((void *) more);
+  }
+
+  /* If we found anything, mark end of list with null.  */
+  if (STR_LIST (ret))
+    cstr_list_add (&ret, NULL);
+
+  return STR_LIST (ret);
+#else
+  return hash_lookup (kpse->db, name);
+#endif
+}
+
 /* If ALIAS_FILENAME exists, read it into TABLE.  */
 
 static boolean
@@ -577,7 +1160,7 @@ kpathsea_db_search (kpathsea kpse, const_string name,
     const_string ctry = *r;
 
     /* We have an ls-R db.  Look up `try'.  */
-    orig_dirs = db_dirs = hash_lookup (kpse->db, ctry);
+    orig_dirs = db_dirs = db_lookup (kpse, ctry);
 
     ret = XTALLOC1 (str_list_type);
     *ret = str_list_init ();
@@ -738,7 +1321,7 @@ kpathsea_db_search_list (kpathsea kpse, string* names,
           const_string ctry = *r;
 
           /* We have an ls-R db.  Look up `try'.  */
-          orig_dirs = db_dirs = hash_lookup (kpse->db, ctry);
+          orig_dirs = db_dirs = db_lookup (kpse, ctry);
 
           /* For each filename found, see if it matches the path element.  For
              example, if we have .../cx/cmr10.300pk and .../ricoh/cmr10.300pk,
@@ -19,12 +19,18 @@
 #ifndef KPATHSEA_DB_H
 #define KPATHSEA_DB_H
 
-#ifdef MAKE_KPSE_DLL /* libkpathsea internal only */
-
 #include <kpathsea/c-proto.h>
 #include <kpathsea/types.h>
 #include <kpathsea/str-list.h>
 
+/* Write a compiled index of the ls-R file DB_FILENAME to
+   DB_FILENAME.idx, which is used instead of DB_FILENAME for as long as
+   that does not change.  Return true if successful.  */
+extern KPSEDLL boolean kpathsea_db_make_index (kpathsea kpse,
+                                               const_string db_filename);
+
+#ifdef MAKE_KPSE_DLL /* libkpathsea internal only */
+
 /* Initialize the database.  Until this is called, no ls-R matches will
    be found.  */
 extern void kpathsea_init_db (kpathsea kpse);
@@ -20,6 +20,7 @@
 #include <kpathsea/c-ctype.h>
 #include <kpathsea/c-pathch.h>
 #include <kpathsea/cnf.h>
+#include <kpathsea/db.h>
 #include <kpathsea/expand.h>
 #include <kpathsea/getopt.h>
 #include <kpathsea/line.h>
@@ -40,6 +41,9 @@ string path_to_show = NULL;
 string var_to_value = NULL;
 string var_to_brace_value = NULL;
 
+/* The ls-R file to write a compiled index for.  (-make-db-index) */
+string db_to_index = NULL;
+
 /* Array/count of cnf lines from the command line. (--cnf-line) */
 static string *user_cnf_lines = NULL;
 static unsigned user_cnf_nlines = 0;
@@ -490,6 +494,7 @@ to also use -engine, or nothing will be returned; in particular,\n\
 -help                  display this message and exit.\n\
 -help-formats          display information about all supported file formats.\n\
 -interactive           ask for additional filenames to look up.\n\
+-make-db-index=FILE    write FILE.idx, a compiled index of the ls-R FILE.\n\
 [-no]-mktex=FMT        disable/enable mktexFMT generation (FMT=pk/mf/tex/tfm).\n\
 -mode=STRING           set device name for $MAKETEX_MODE to STRING; no default.\n\
 -must-exist            search the disk as well as ls-R if necessary.\n\
@@ -605,6 +610,7 @@ static struct option long_options[]
       { "help",                 0, 0, 0 },
       { "help-formats",         0, 0, 0 },
       { "interactive",          0, (int *) &interactive, 1 },
+      { "make-db-index",        1, 0, 0 },
       { "mktex",                1, 0, 0 },
       { "mode",                 1, 0, 0 },
       { "must-exist",           0, (int *) &must_exist, 1 },
@@ -682,6 +688,9 @@ read_command_line (kpathsea kpse, int argc, string *argv)
     } else if (ARGUMENT_IS ("help-formats")) {
       help_formats (kpse, argv);
 
+    } else if (ARGUMENT_IS ("make-db-index")) {
+      db_to_index = optarg;
+
     } else if (ARGUMENT_IS ("mktex")) {
       kpathsea_maketex_option (kpse, optarg, true);
       must_exist = 1;  /* otherwise it never gets called */
@@ -743,7 +752,7 @@ There is NO WARRANTY, to the extent permitted by law.\n");
   if (optind == argc
       && !var_to_expand && !braces_to_expand && !path_to_expand
       && !path_to_show && !var_to_value && !var_to_brace_value
-      && !safe_in_name && !safe_out_name) {
+      && !safe_in_name && !safe_out_name && !db_to_index) {
     fputs ("Missing argument. Try `kpsewhich --help' for more information.\n",
            stderr);
     exit (1);
@@ -891,6 +900,12 @@ main (int argc,  string *argv)
     puts (value);
   }
 
+  /* Compile an ls-R file.  */
+  if (db_to_index) {
+    if (!kpathsea_db_make_index (kpse, db_to_index))
+      unfound++;
+  }
+
   if (safe_in_name) {
     if (!kpathsea_in_name_ok_silent (kpse, safe_in_name))
       unfound++;
@@ -164,6 +164,7 @@ kpathsea_set_program_enabled (kpathsea kpse, kpse_file_format_type fmt,
   if (level >= f->program_enable_level) {
     f->program_enabled_p = value;
     f->program_enable_level = level;
+    kpathsea_find_file_cache_flush (kpse);
   }
 }
 
@@ -982,6 +983,152 @@ target_suffixed_names (kpathsea kpse, string **target, unsigned *count,
   }
 }
 
+/* Results of kpathsea_find_file_generic, including failures, are
+   remembered for the rest of the run, so that a name that is asked for
+   again (as LaTeX does for .fd and .cfg files, say) need not be looked
+   for along the whole path once more.  Since a lookup may fail because
+   the file does not exist yet, the cache is flushed whenever we might
+   have created files: see kpathsea_find_file_cache_flush.  */
+
+#ifndef FIND_CACHE_SIZE
+#define FIND_CACHE_SIZE 1009
+#endif
+
+typedef struct find_cache_entry
+{
+  string name;
+  kpse_file_format_type format;
+  boolean must_exist;
+  boolean all;
+  string *result;               /* NULL-terminated, maybe empty.  */
+  struct find_cache_entry *next;
+} find_cache_entry;
+
+struct find_cache_struct
+{
+  find_cache_entry *buckets[FIND_CACHE_SIZE];
+  unsigned hits, misses;
+};
+
+static unsigned
+find_cache_hash (const_string name, kpse_file_format_type format)
+{
+  unsigned n = format;
+
+  while (*name)
+    n = (n + n + (unsigned char) *name++) % FIND_CACHE_SIZE;
+
+  return n;
+}
+
+/* Copy LIST; unless ALL, it may have just one element and no NULL.  */
+
+static string *
+find_cache_copy (string *list, boolean all)
+{
+  unsigned count, i;
+  string *ret;
+
+  for (count = 0; list[count] && (all || count == 0); count++)
+    ;
+  ret = XTALLOC (count + 1, string);
+  for (i = 0; i < count; i++)
+    ret[i] = xstrdup (list[i]);
+  ret[count] = NULL;
+
+  return ret;
+}
+
+/* Return a copy of the remembered result for this lookup, or NULL.  */
+
+static string *
+find_cache_lookup (kpathsea kpse, const_string name,
+                   kpse_file_format_type format, boolean must_exist,
+                   boolean all)
+{
+  struct find_cache_struct *cache = kpse->find_cache;
+  find_cache_entry *e;
+
+  if (!cache) {
+    cache = kpse->find_cache
+      = (struct find_cache_struct *) xcalloc (1, sizeof (*cache));
+  }
+
+  for (e = cache->buckets[find_cache_hash (name, format)]; e; e = e->next) {
+    if (e->format == format && e->must_exist == must_exist
+        && e->all == all && STREQ (e->name, name)) {
+      cache->hits++;
+#ifdef KPSE_DEBUG
+      if (KPATHSEA_DEBUG_P (KPSE_DEBUG_SEARCH))
+        DEBUGF4 ("kpse_find_file: remembered %s => %s (%u hits, %u misses)\n",
+                 name, *e->result ? *e->result : "(nil)",
+                 cache->hits, cache->misses);
+#endif
+      return find_cache_copy (e->result, true);
+    }
+  }
+  cache->misses++;
+
+  return NULL;
+}
+
+static void
+find_cache_store (kpathsea kpse, const_string name,
+                  kpse_file_format_type format, boolean must_exist,
+                  boolean all, string *result)
+{
+  struct find_cache_struct *cache = kpse->find_cache;
+  unsigned n = find_cache_hash (name, format);
+  find_cache_entry *e;
+
+  if (!cache)
+    return;
+
+  e = XTALLOC1 (find_cache_entry);
+  e->name = xstrdup (name);
+  e->format = format;
+  e->must_exist = must_exist;
+  e->all = all;
+  e->result = find_cache_copy (result, all);
+  e->next = cache->buckets[n];
+  cache->buckets[n] = e;
+}
+
+/* Forget all remembered lookups, because files may have been created
+   or paths changed.  */
+
+void
+kpathsea_find_file_cache_flush (kpathsea kpse)
+{
+  struct find_cache_struct *cache = kpse->find_cache;
+  unsigned n;
+
+  if (!cache)
+    return;
+
+  for (n = 0; n < FIND_CACHE_SIZE; n++) {
+    find_cache_entry *e, *next;
+    for (e = cache->buckets[n]; e; e = next) {
+      string *r;
+      next = e->next;
+      for (r = e->result; *r; r++)
+        free (*r);
+      free (e->result);
+      free (e->name);
+      free (e);
+    }
+    cache->buckets[n] = NULL;
+  }
+}
+
+#if defined (KPSE_COMPAT_API)
+void
+kpse_find_file_cache_flush (void)
+{
+  kpathsea_find_file_cache_flush (kpse_def);
+}
+#endif
+
 /* Look up a file NAME of type FORMAT, and the given MUST_EXIST.  This
    initializes the path spec for FORMAT if it's the first lookup of that
    type.  Return the filename found, or NULL.  This is the most likely
@@ -1044,6 +1191,11 @@ kpathsea_find_file_generic (kpathsea kpse, const_string const_name,
              const_name, FMT_INFO.type, FMT_INFO.path_source);
 #endif /* KPSE_DEBUG */
 
+  /* Maybe we have been here before.  */
+  ret = find_cache_lookup (kpse, const_name, format, must_exist, all);
+  if (ret)
+    return ret;
+
   /* Do variable and tilde expansion. */
   name = kpathsea_expand (kpse, const_name);
 
@@ -1159,6 +1311,7 @@ kpathsea_find_file_generic (kpathsea kpse, const_string const_name,
     } 
   }
 #endif
+  find_cache_store (kpse, const_name, format, must_exist, all, ret);
   return ret;
 }
 
@@ -1359,15 +1512,19 @@ kpathsea_out_name_ok_1 (kpathsea kpse, const_string fname, boolean silent)
   return kpathsea_name_ok (kpse, fname, "openout_any", "p", ok_writing,silent);
 }
 
+/* A file that we are about to write may have been looked for before.  */
+
 boolean
 kpathsea_out_name_ok_silent (kpathsea kpse, const_string fname)
 {
+  kpathsea_find_file_cache_flush (kpse);
   return kpathsea_out_name_ok_1 (kpse, fname, true);
 }
 
 boolean
 kpathsea_out_name_ok (kpathsea kpse, const_string fname)
 {
+  kpathsea_find_file_cache_flush (kpse);
   return kpathsea_out_name_ok_1 (kpse, fname, false);
 }
 
@@ -1446,6 +1603,7 @@ kpathsea_reset_program_name (kpathsea kpse, const_string progname)
   free (kpse->program_name);
   kpse->program_name = xstrdup (progname);
   kpathsea_xputenv (kpse, "progname", kpse->program_name);
+  kpathsea_find_file_cache_flush (kpse);
 
   /* Go through all paths ...  */
   for (i = 0; i != kpse_last_format; ++i) {
@@ -305,6 +305,13 @@ typedef struct kpathsea_instance {
     char st_buff[5];
     char *st_str;
 #endif
+    /* Members added later go here, so that the offsets of those above,
+       used by clients through macros such as KPATHSEA_DEBUG_P, stay
+       the same.  */
+    /* from db.c */
+    struct db_index_struct *db_index;   /* mapped ls-R indexes */
+    /* from tex-file.c */
+    struct find_cache_struct *find_cache; /* remembered lookups */
 } kpathsea_instance;
 
 /* these come from kpathsea.c */
@@ -609,6 +609,10 @@ runsystem (const char *cmd)
   else if (allow == 2)
     status =  system (safecmd);
 
+  /* The command may have made files that we looked for in vain.  */
+  if (allow == 1 || allow == 2)
+    kpse_find_file_cache_flush ();
+
   /* Not really meaningful, but we have to manage the return value of system. */
   if (status != 0)
     fprintf(stderr,"system returned with code %d\n", status); 
@@ -1184,6 +1188,274 @@ topenin (void)
 #endif
 }
 
+#if defined (TeX) && !defined (Aleph)
+/* Server mode.  With --server=SOCKET, TeX loads its format as usual
+   and then, instead of reading a document, accepts jobs on the Unix
+   domain socket SOCKET.  For each connection the client sends lines of
+   the form
+
+     dir=DIRECTORY    run the job in DIRECTORY
+     jobname=NAME     the same as the argument --jobname=NAME
+     arg=ARGUMENT     one command line argument: options first, then the
+                      file name or first line of input, as usual
+
+   ended by an empty line.  The job runs in a forked copy of the server,
+   which shares the already loaded format, with the connection as its
+   terminal.  When it is over a last line `exit=STATUS' is sent.
+   A job that gives an option used to load the format, such as --fmt,
+   --ini or --progname, or one of the shell escape options, is refused;
+   the environment and texmf.cnf are the server's too.  */
+
+string server_name;
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+/* The settings a job may not change, and their values in the server.  */
+static struct {
+  const_string option;
+  int *flag;
+  const_string *name;
+  int saved_flag;
+  const_string saved_name;
+} server_settings[] = {
+  { "ini", &iniversion },
+  { "mltex", &mltexp },
+#if !defined(XeTeX) && !IS_pTeX
+  { "enc", &enctexp },
+#endif
+#if IS_eTeX
+  { "etex", &etexp },
+#endif
+  { "shell-escape", &shellenabledp },
+  { "shell-restricted", &restrictedshell },
+  { DUMP_OPTION, NULL, &dump_name },
+  { "progname", NULL, &user_progname },
+  { "translate-file", NULL, (const_string *) &translate_filename },
+  { NULL }
+};
+
+/* Read a request line from standard input, without the newline.  We
+   read one byte at a time, so as not to take input meant for the job.
+   Return NULL at end of file.  */
+
+static string
+server_read_line (void)
+{
+  unsigned len = 0, size = 80;
+  string line = xmalloc (size);
+  char c;
+
+  for (;;) {
+    ssize_t n = (read) (0, &c, 1); /* not cpascal.h's read */
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      free (line);
+      return NULL;
+    }
+    if (c == '\n')
+      break;
+    if (len + 1 >= size)
+      line = xrealloc (line, size *= 2);
+    line[len++] = c;
+  }
+  line[len] = 0;
+  return line;
+}
+
+/* Handle the connection FD: read the request, then fork the process
+   that runs the job and report how it ended.  Returns only in the
+   process running the job.  */
+
+static void
+server_job (int fd)
+{
+  string line, value, dir = NULL, jobname = NULL, bad = NULL;
+  string *args = xmalloc (2 * sizeof (string));
+  int nargs = 1, i;
+  pid_t pid;
+  int status;
+
+  /* The job's terminal is the connection.  */
+  dup2 (fd, 0);
+  dup2 (fd, 1);
+  dup2 (fd, 2);
+  if (fd > 2)
+    close (fd);
+  signal (SIGCHLD, SIG_DFL);
+
+  /* Read the whole request before complaining about any of it, so
+     the client gets to see the complaint.  */
+  args[0] = argv[0];
+  while ((line = server_read_line ()) && *line) {
+    value = strchr (line, '=');
+    if (value)
+      *value++ = 0;
+    if (value && STREQ (line, "dir")) {
+      dir = value;
+    } else if (value && STREQ (line, "jobname")) {
+      jobname = concat ("--jobname=", value);
+    } else if (value && STREQ (line, "arg")) {
+      args = xrealloc (args, (nargs + 3) * sizeof (string));
+      args[nargs++] = value;
+    } else if (!bad) {
+      bad = line;
+    }
+  }
+  if (!line)
+    _exit (1);
+  if (bad) {
+    fprintf (stderr, "! Invalid request line `%s'.\nexit=1\n", bad);
+    _exit (1);
+  }
+  if (dir && chdir (dir) != 0) {
+    fprintf (stderr, "! Cannot change to directory %s: %s.\nexit=1\n",
+             dir, strerror (errno));
+    _exit (1);
+  }
+
+  /* The job name must come before the first non-option argument.  */
+  if (jobname) {
+    memmove (args + 2, args + 1, (nargs - 1) * sizeof (string));
+    args[1] = jobname;
+    nargs++;
+  }
+  args[nargs] = NULL;
+
+  pid = fork ();
+  if (pid == 0) {
+    /* Take the job's options, and leave the rest for topenin.  */
+    argc = nargs;
+    argv = args;
+    optind = 0;
+    for (i = 0; server_settings[i].option; i++) {
+      if (server_settings[i].flag)
+        server_settings[i].saved_flag = *server_settings[i].flag;
+      else
+        server_settings[i].saved_name = *server_settings[i].name;
+    }
+    parse_options (argc, argv);
+    for (i = 0; server_settings[i].option; i++) {
+      if (server_settings[i].flag
+          ? *server_settings[i].flag != server_settings[i].saved_flag
+          : *server_settings[i].name != server_settings[i].saved_name) {
+        fprintf (stderr, "! The server does not allow --%s in a job.\n",
+                 server_settings[i].option);
+        _exit (1);
+      }
+    }
+    server_name = NULL;
+    /* Relative names may now mean other files.  */
+    kpse_find_file_cache_flush ();
+    return;
+  }
+
+  while (pid > 0 && waitpid (pid, &status, 0) < 0 && errno == EINTR)
+    ;
+  if (pid < 0)
+    status = 1;
+  else if (WIFEXITED (status))
+    status = WEXITSTATUS (status);
+  else
+    status = 128 + (WIFSIGNALED (status) ? WTERMSIG (status) : 0);
+  printf ("exit=%d\n", status);
+  fflush (stdout);
+  _exit (0);
+}
+
+/* Return true if the process at the other end of the connection FD
+   runs as the same user as the server.  */
+
+static boolean
+server_peer_ok (int fd)
+{
+#if defined (__linux__) && defined (SO_PEERCRED)
+  /* The kernel's struct ucred, which libc declares only for _GNU_SOURCE.  */
+  struct { pid_t pid; uid_t uid; gid_t gid; } cred;
+  socklen_t len = sizeof (cred);
+
+  return getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0
+         && cred.uid == geteuid ();
+#else
+  uid_t uid;
+  gid_t gid;
+
+  return getpeereid (fd, &uid, &gid) == 0 && uid == geteuid ();
+#endif
+}
+#endif /* not WIN32 */
+
+/* Called from tex.ch once the format is loaded, if --server was given.
+   Returns only in a process forked to run a job.  */
+
+void
+serve_jobs (void)
+{
+#ifndef WIN32
+  struct sockaddr_un addr;
+  struct stat st;
+  mode_t old_mask;
+  int sock, fd, ok;
+
+  if (strlen (server_name) >= sizeof (addr.sun_path))
+    FATAL1 ("Socket name too long: %s", server_name);
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy (addr.sun_path, server_name);
+
+  /* Replace a socket left behind by an earlier server, but nothing else.  */
+  if (stat (server_name, &st) == 0 && S_ISSOCK (st.st_mode))
+    unlink (server_name);
+  sock = socket (AF_UNIX, SOCK_STREAM, 0);
+  /* Jobs run with the server's permissions, so only its user may
+     connect: the socket is made without permissions for others, and
+     connections from other users are refused below.  */
+  old_mask = umask (077);
+  ok = sock >= 0
+       && bind (sock, (struct sockaddr *) &addr, sizeof (addr)) == 0;
+  umask (old_mask);
+  if (!ok || listen (sock, SOMAXCONN) != 0)
+    FATAL_PERROR (server_name);
+
+  /* Each job process waits for its own child; we need not wait for them.  */
+  signal (SIGCHLD, SIG_IGN);
+  printf ("Waiting for jobs on %s.\n", server_name);
+  fflush (NULL);
+
+  for (;;) {
+    fd = accept (sock, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      FATAL_PERROR (server_name);
+    }
+    if (!server_peer_ok (fd)) {
+      fprintf (stderr, "%s: Refusing a job from another user.\n",
+               server_name);
+      close (fd);
+      continue;
+    }
+    switch (fork ()) {
+    case -1:
+      perror ("fork");
+      close (fd);
+      break;
+    case 0:
+      close (sock);
+      server_job (fd);
+      return;
+    default:
+      close (fd);
+    }
+  }
+#endif /* not WIN32 */
+}
+#endif /* TeX and not Aleph */
+
 /* IPC for TeX.  By Tom Rokicki for the NeXT; it makes TeX ship out the
    DVI file in a pipe to TeXView so that the output can be displayed
    incrementally.  Shamim Mohamed adapted it for Web2c.  */
@@ -1725,6 +1997,9 @@ static struct option long_options[]
       { "disable-write18",           0, &shellenabledp, -1 },
       { "shell-restricted",          0, 0, 0 },
       { "debug-format",              0, &debugformatfile, 1 },
+#if !defined(Aleph) && !defined(WIN32)
+      { "server",                    1, 0, 0 },
+#endif
       { "src-specials",              2, 0, 0 },
 #if defined(__SyncTeX__)
       /* Synchronization: just like "interaction" above */
@@ -1806,6 +2081,11 @@ parse_options (int argc, string *argv)
       }
       user_cnf_lines[user_cnf_nlines-1] = xstrdup (optarg);
 
+#if defined(TeX) && !defined(Aleph) && !defined(WIN32)
+    } else if (ARGUMENT_IS ("server")) {
+      server_name = optarg;
+#endif
+
     } else if (ARGUMENT_IS ("jobname")) {
 #ifdef XeTeX
       c_job_name = optarg;
@@ -2241,6 +2521,7 @@ close_file_or_pipe (FILE *f)
       if (pipes[i] == f) {
         if (f) {
           pclose (f);
+          kpse_find_file_cache_flush ();
 #ifdef WIN32
           Poptr = NULL;
 #endif
@@ -2268,6 +2549,7 @@ u_close_file_or_pipe (unicodefile* f)
       if (pipes[i] == (*f)->f) {
         if ((*f)->f) {
           pclose ((*f)->f);
+          kpse_find_file_cache_flush ();
           if (((*f)->encodingMode == ICUMAPPING) && ((*f)->conversionData != NULL))
               ucnv_close((*f)->conversionData);
           free(*f);
@@ -2780,6 +3062,203 @@ swap_items (char *p, int nitems, int size)
 }
 #endif /* not WORDS_BIGENDIAN and not NO_DUMP_SHARE */
 
+/* Native dump data.  When the texmf.cnf variable `dump_native' is true,
+   a dump file also gets a native-endian, uncompressed copy of
+   everything written to it, appended after the portable data and
+   followed by a trailer.  When such a file is opened for reading, it is
+   mapped (privately, so any writes would be copy-on-write) and
+   `do_undump' copies straight out of the mapping, without stdio,
+   decompression or byte swapping.  Engines that know nothing of this
+   stop reading at the end of the portable data, so the file remains
+   usable by them, and we fall back to the portable data ourselves
+   whenever the trailer or the checksum does not match.  */
+
+#ifndef _WIN32
+#define NATIVE_DUMP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef NATIVE_DUMP
+#define NATIVE_DUMP_MAGIC "W2Cnatv"
+#define NATIVE_DUMP_VERSION 1
+#define NATIVE_DUMP_ORDER 0x01020304
+/* Round up to the alignment of the payload and the trailer.  */
+#define NATIVE_DUMP_ROUND(n) (((n) + 7) & ~(uint64_t) 7)
+
+#if defined (TeX) || defined (MF)
+#define NATIVE_DUMP_WORD_SIZE sizeof (memoryword)
+#else
+#define NATIVE_DUMP_WORD_SIZE 0
+#endif
+
+struct native_dump_trailer {
+  char magic[8];                /* NATIVE_DUMP_MAGIC */
+  unsigned version;             /* NATIVE_DUMP_VERSION */
+  unsigned byte_order;          /* NATIVE_DUMP_ORDER, as written */
+  unsigned word_size;           /* NATIVE_DUMP_WORD_SIZE */
+  unsigned pointer_size;        /* sizeof (void *) */
+  uint64_t portable_size;       /* length of the portable data */
+  uint64_t payload_size;        /* length of the native data */
+  uint64_t checksum;            /* of the padded native data */
+};
+
+/* Native data being collected for the dump file `native_out_name'.  */
+static char *native_out;
+static uint64_t native_out_size, native_out_alloc;
+static string native_out_name;
+
+/* The mapped dump file being undumped, and our position in it.  */
+static char *native_in;
+static uint64_t native_in_size, native_in_pos, native_in_end;
+
+/* A Fletcher-style sum of the LEN bytes at P, LEN a multiple of 4.  */
+
+static uint64_t
+native_dump_checksum (const char *p, uint64_t len)
+{
+  uint64_t a = 1, b = 0;
+  uint32_t w;
+
+  while (len) {
+    memcpy (&w, p, 4);
+    a += w;
+    b += a;
+    p += 4;
+    len -= 4;
+  }
+  return (b << 32) ^ a;
+}
+
+static void
+native_dump_write (const char *p, uint64_t len)
+{
+  if (native_out_size + len > native_out_alloc) {
+    while (native_out_size + len > native_out_alloc)
+      native_out_alloc = native_out_alloc ? 2 * native_out_alloc : 1 << 20;
+    native_out = xrealloc (native_out, native_out_alloc);
+  }
+  memcpy (native_out + native_out_size, p, len);
+  native_out_size += len;
+}
+#endif /* NATIVE_DUMP */
+
+/* Called by `wopenout' once the dump file `nameoffile' is open.  */
+
+void
+native_dump_open_out (void)
+{
+#ifdef NATIVE_DUMP
+  if (texmf_yesno ("dump_native")) {
+    native_out_size = 0;
+    native_out_name = xstrdup (nameoffile + 1);
+  }
+#endif
+}
+
+/* Called by `wopenin' with the dump file F just opened.  */
+
+void
+native_dump_open_in (FILE *f)
+{
+#ifdef NATIVE_DUMP
+  struct stat st;
+  struct native_dump_trailer t;
+  uint64_t payload, padded;
+  char *map;
+
+  if (fstat (fileno (f), &st) != 0
+      || (uint64_t) st.st_size < sizeof (t)
+      || (off_t) (size_t) st.st_size != st.st_size)
+    return;
+  map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (f), 0);
+  if (map == MAP_FAILED)
+    return;
+
+  /* Files without (our kind of) native data just go the portable way.  */
+  memcpy (&t, map + st.st_size - sizeof (t), sizeof (t));
+  payload = NATIVE_DUMP_ROUND (t.portable_size);
+  padded = NATIVE_DUMP_ROUND (t.payload_size);
+  if (memcmp (t.magic, NATIVE_DUMP_MAGIC, sizeof (t.magic)) != 0
+      || t.version != NATIVE_DUMP_VERSION
+      || t.byte_order != NATIVE_DUMP_ORDER
+      || t.word_size != NATIVE_DUMP_WORD_SIZE
+      || t.pointer_size != sizeof (void *)
+      || payload + padded + sizeof (t) != (uint64_t) st.st_size) {
+    munmap (map, st.st_size);
+    return;
+  }
+
+  if (native_dump_checksum (map + payload, padded) != t.checksum) {
+    WARNING1 ("Native data in %s is damaged, using the portable data",
+              nameoffile + 1);
+    munmap (map, st.st_size);
+    return;
+  }
+
+  native_in = map;
+  native_in_size = st.st_size;
+  native_in_pos = payload;
+  native_in_end = payload + t.payload_size;
+#endif
+}
+
+/* Called by `wclose' after the dump file has been closed: release the
+   mapping of a file we read, or append the native data to the file we
+   wrote.  */
+
+void
+native_dump_close (void)
+{
+#ifdef NATIVE_DUMP
+  if (native_in) {
+    munmap (native_in, native_in_size);
+    native_in = NULL;
+  }
+
+  if (native_out_name) {
+    static const char zeros[8];
+    struct native_dump_trailer t;
+    FILE *f = fopen (native_out_name, FOPEN_ABIN_MODE);
+    long len = -1;
+    uint64_t padded = NATIVE_DUMP_ROUND (native_out_size);
+
+    if (f && fseek (f, 0, SEEK_END) == 0)
+      len = ftell (f);
+
+    memset (&t, 0, sizeof (t));
+    memcpy (t.magic, NATIVE_DUMP_MAGIC, sizeof (t.magic));
+    t.version = NATIVE_DUMP_VERSION;
+    t.byte_order = NATIVE_DUMP_ORDER;
+    t.word_size = NATIVE_DUMP_WORD_SIZE;
+    t.pointer_size = sizeof (void *);
+    t.portable_size = len;
+    t.payload_size = native_out_size;
+
+    /* Pad the native data with zeros so the checksum covers whole words.  */
+    native_dump_write (zeros, padded - native_out_size);
+    t.checksum = native_dump_checksum (native_out, padded);
+
+    if (len < 0
+        || fwrite (zeros, 1, NATIVE_DUMP_ROUND (len) - len, f)
+           != NATIVE_DUMP_ROUND (len) - len
+        || fwrite (native_out, 1, padded, f) != padded
+        || fwrite (&t, sizeof (t), 1, f) != 1) {
+      /* Without a trailer the portable data will be used.  */
+      WARNING1 ("Could not write native data to %s", native_out_name);
+    }
+    if (f && fclose (f) != 0)
+      WARNING1 ("Could not write native data to %s", native_out_name);
+
+    free (native_out_name);
+    native_out_name = NULL;
+    free (native_out);
+    native_out = NULL;
+    native_out_size = native_out_alloc = 0;
+  }
+#endif
+}
+
 
 /* Here we write NITEMS items, each item being ITEM_SIZE bytes long.
    The pointer to the stuff to write is P, and we write to the file
@@ -2792,6 +3271,11 @@ do_dump (char *p, int item_size, int nitems,  gzFile out_file)
 do_dump (char *p, int item_size, int nitems,  FILE *out_file)
 #endif
 {
+#ifdef NATIVE_DUMP
+  if (native_out_name)
+    native_dump_write (p, (uint64_t) item_size * nitems);
+#endif
+
 #if !defined (WORDS_BIGENDIAN) && !defined (NO_DUMP_SHARE)
   swap_items (p, nitems, item_size);
 #endif
@@ -2824,6 +3308,19 @@ do_undump (char *p, int item_size, int nitems, gzFile in_file)
 do_undump (char *p, int item_size, int nitems, FILE *in_file)
 #endif
 {
+#ifdef NATIVE_DUMP
+  if (native_in) {
+    uint64_t len = (uint64_t) item_size * nitems;
+
+    if (len > native_in_end - native_in_pos)
+      FATAL3 ("Could not undump %d %d-byte item(s) from %s",
+              nitems, item_size, nameoffile+1);
+    memcpy (p, native_in + native_in_pos, len);
+    native_in_pos += len;
+    return;
+  }
+#endif
+
 #ifdef XeTeX
   if (gzread (in_file, p, item_size * nitems) != item_size * nitems)
 #else
@@ -22,7 +22,11 @@ with this program.  If not, see <http://www.gnu.org/licenses/>.
    <kpathsea/types.h> defining Pascal's boolean as 'int'.
 */
 #include <w2c/config.h>
+#include <kpathsea/absolute.h>
 #include <kpathsea/lib.h>
+#include <kpathsea/c-pathch.h>
+#include <kpathsea/c-stat.h>
+#include <kpathsea/variable.h>
 
 #include <stdlib.h>
 #include <math.h>
@@ -65,6 +69,7 @@ with this program.  If not, see <http://www.gnu.org/licenses/>.
 extern "C" {
 #include <pdftexdir/ptexmac.h>
 #include <pdftexdir/pdftex-common.h>
+#include <pdftexdir/avlstuff.h>
 
 // These functions from pdftex.web gets declared in pdftexcoerce.h in the
 // usual web2c way, but we cannot include that file here because C++
@@ -112,8 +117,9 @@ class PdfObject {
 // When copying the Resources of the selected page, all objects are copied
 // recusively top-down. Indirect objects however are not fetched during
 // copying, but get a new object number from pdfTeX and then will be
-// appended into a linked list. Duplicates are checked and removed from the
-// list of indirect objects during appending.
+// appended into a linked list. Duplicates are found by looking up the
+// object in an AVL tree sorted by ref, so that they are not appended
+// again.
 
 enum InObjType {
     objFont,
@@ -138,6 +144,8 @@ struct UsedEncoding {
 };
 
 static InObj *inObjList;
+static InObj *inObjTail;                // last entry of inObjList
+static struct avl_table *inObjTree;     // entries of inObjList sorted by ref
 static UsedEncoding *encodingList;
 static GBool isInit = gFalse;
 
@@ -150,24 +158,36 @@ struct PdfDocument {
     PDFDoc *doc;
     XRef *xref;
     InObj *inObjList;
+    InObj *inObjTail;
+    struct avl_table *inObjTree;
     int occurences;             // number of references to the document; the doc can be
     // deleted when this is negative
-    PdfDocument *next;
 };
 
-static PdfDocument *pdfDocuments = 0;
+// AVL tree of all open documents, sorted by file name
+
+static struct avl_table *pdfDocuments = 0;
+
+static int comp_pdf_document(const void *pa, const void *pb, void *p)
+{
+    return strcmp(((const PdfDocument *) pa)->file_name,
+                  ((const PdfDocument *) pb)->file_name);
+}
 
 static XRef *xref = 0;
 
 // Returns pointer to PdfDocument record for PDF file.
-// Creates a new record if it doesn't exist yet.
+// Creates a new record if it doesn't exist yet; the file itself is
+// opened by open_document().
 // xref is made current for the document.
 
 static PdfDocument *find_add_document(char *file_name)
 {
-    PdfDocument *p = pdfDocuments;
-    while (p && strcmp(p->file_name, file_name) != 0)
-        p = p->next;
+    PdfDocument *p, tmp;
+    if (pdfDocuments == 0)
+        pdfDocuments = avl_create(comp_pdf_document, NULL, &avl_xallocator);
+    tmp.file_name = file_name;
+    p = (PdfDocument *) avl_find(pdfDocuments, &tmp);
     if (p) {
         xref = p->xref;
         (p->occurences)++;
@@ -175,33 +195,46 @@ static PdfDocument *find_add_document(char *file_name)
     }
     p = new PdfDocument;
     p->file_name = xstrdup(file_name);
+    p->doc = 0;
     p->xref = xref = 0;
     p->occurences = 0;
-    GString *docName = new GString(p->file_name);
-    p->doc = new PDFDoc(docName);       // takes ownership of docName
-    if (!p->doc->isOk() || !p->doc->okToPrint()) {
-        pdftex_fail("xpdf: reading PDF image failed");
-    }
-    p->inObjList = 0;
-    p->next = pdfDocuments;
-    pdfDocuments = p;
+    p->inObjList = p->inObjTail = 0;
+    p->inObjTree = 0;
+    if (avl_probe(pdfDocuments, p) == NULL)
+        pdftex_fail("pdftoepdf.cc: avl_probe() out of memory in insertion");
     return p;
 }
 
+// Parse the PDF file of a document if this hasn't been done yet.
+// xref is made current for the document.
+
+static void open_document(PdfDocument * pdf_doc)
+{
+    if (pdf_doc->doc == 0) {
+        if (!isInit) {
+            globalParams = new GlobalParams();
+            globalParams->setErrQuiet(gFalse);
+            isInit = gTrue;
+        }
+        GString *docName = new GString(pdf_doc->file_name);
+        pdf_doc->doc = new PDFDoc(docName);     // takes ownership of docName
+        if (!pdf_doc->doc->isOk() || !pdf_doc->doc->okToPrint()) {
+            pdftex_fail("xpdf: reading PDF image failed");
+        }
+        pdf_doc->xref = pdf_doc->doc->getXRef();
+    }
+    xref = pdf_doc->xref;
+}
+
 // Deallocate a PdfDocument with all its resources
 
-static void delete_document(PdfDocument * pdf_doc)
+static void destroy_document(void *pa, void *pb)
 {
-    PdfDocument **p = &pdfDocuments;
-    while (*p && *p != pdf_doc)
-        p = &((*p)->next);
-    // should not happen:
-    if (!*p)
-        return;
-    // unlink from list
-    *p = pdf_doc->next;
+    PdfDocument *pdf_doc = (PdfDocument *) pa;
     // free pdf_doc's resources
     InObj *r, *n;
+    if (pdf_doc->inObjTree != 0)
+        avl_destroy(pdf_doc->inObjTree, NULL);
     for (r = pdf_doc->inObjList; r != 0; r = n) {
         n = r->next;
         delete r;
@@ -212,6 +245,14 @@ static void delete_document(PdfDocument * pdf_doc)
     delete pdf_doc;
 }
 
+static void delete_document(PdfDocument * pdf_doc)
+{
+    // should not happen:
+    if (avl_delete(pdfDocuments, pdf_doc) == NULL)
+        return;
+    destroy_document(pdf_doc, NULL);
+}
+
 // Replacement for
 //      Object *initDict(Dict *dict1){ initObj(objDict); dict = dict1; return this; }
 
@@ -249,32 +290,50 @@ static int addEncoding(GfxFont * gfont)
 #define addOther(ref) \
         addInObj(objOther, ref, 0, 0)
 
+static int comp_in_obj(const void *pa, const void *pb, void *p)
+{
+    const Ref *a = &((const InObj *) pa)->ref;
+    const Ref *b = &((const InObj *) pb)->ref;
+    cmp_return(a->num, b->num);
+    cmp_return(a->gen, b->gen);
+    return 0;
+}
+
+static InObj *findInObj(Ref ref)
+{
+    InObj tmp;
+    if (inObjTree == 0)
+        return 0;
+    tmp.ref = ref;
+    return (InObj *) avl_find(inObjTree, &tmp);
+}
+
 static int addInObj(InObjType type, Ref ref, fd_entry * fd, int e)
 {
-    InObj *p, *q, *n = new InObj;
+    InObj *p, *n;
     if (ref.num == 0)
         pdftex_fail("PDF inclusion: invalid reference");
+    if ((p = findInObj(ref)) != 0)
+        return p->num;
+    n = new InObj;
     n->ref = ref;
     n->type = type;
     n->next = 0;
     n->fd = fd;
     n->enc_objnum = e;
     n->written = 0;
+    if (inObjTree == 0)
+        inObjTree = avl_create(comp_in_obj, NULL, &avl_xallocator);
+    if (avl_probe(inObjTree, n) == NULL)
+        pdftex_fail("pdftoepdf.cc: avl_probe() out of memory in insertion");
+    // it is important to add new objects at the end of the list,
+    // because new objects are being added while the list is being
+    // written out.
     if (inObjList == 0)
         inObjList = n;
-    else {
-        for (p = inObjList; p != 0; p = p->next) {
-            if (p->ref.num == ref.num && p->ref.gen == ref.gen) {
-                delete n;
-                return p->num;
-            }
-            q = p;
-        }
-        // it is important to add new objects at the end of the list,
-        // because new objects are being added while the list is being
-        // written out.
-        q->next = n;
-    }
+    else
+        inObjTail->next = n;
+    inObjTail = n;
     if (type == objFontDesc)
         n->num = get_fd_objnum(fd);
     else
@@ -362,13 +421,24 @@ static void copyFontDict(Object * obj, InObj * r)
     pdf_puts(">>");
 }
 
+// Copy the stream in blocks read straight into the free part of the PDF
+// buffer; the buffer is flushed (or grown in object stream mode) when
+// less than COPY_BLOCK_MIN bytes are left.
+
+#define COPY_BLOCK_MIN 1024
+
 static void copyStream(Stream * str)
 {
-    int c, c2 = 0;
+    int n, c2 = 0;
     str->reset();
-    while ((c = str->getChar()) != EOF) {
-        pdfout(c);
-        c2 = c;
+    while (1) {
+        if (pdfbufsize - pdfptr < COPY_BLOCK_MIN)
+            pdfroom(COPY_BLOCK_MIN);
+        n = str->getBlock((char *) pdfbuf + pdfptr, pdfbufsize - pdfptr);
+        if (n <= 0)
+            break;
+        pdfptr += n;
+        c2 = pdfbuf[pdfptr - 1];
     }
     pdflastbyte = c2;
 }
@@ -403,13 +473,10 @@ static void copyFont(char *tag, Object * fontRef)
     fm_entry *fontmap;
     // Check whether the font has already been embedded before analysing it.
     InObj *p;
-    Ref ref = fontRef->getRef();
-    for (p = inObjList; p; p = p->next) {
-        if (p->ref.num == ref.num && p->ref.gen == ref.gen) {
-            copyName(tag);
-            pdf_printf(" %d 0 R ", p->num);
-            return;
-        }
+    if ((p = findInObj(fontRef->getRef())) != 0) {
+        copyName(tag);
+        pdf_printf(" %d 0 R ", p->num);
+        return;
     }
     // Only handle included Type1 (and Type1C) fonts; anything else will be copied.
     // Type1C fonts are replaced by Type1 fonts, if REPLACE_TYPE1C is true.
@@ -711,57 +778,242 @@ static PDFRectangle *get_pagebox(Page * page, int pagebox_spec)
 }
 
 
-// Reads various information about the PDF and sets it up for later inclusion.
-// This will fail if the PDF version of the PDF is higher than
-// minor_pdf_version_wanted or page_name is given and can not be found.
-// It makes no sense to give page_name _and_ page_num.
-// Returns the page number.
+// --------------------------------------------------------------------
+// Persistent cache of the information read by read_pdf_info()
+// --------------------------------------------------------------------
 
-int
-read_pdf_info(char *image_name, char *page_name, int page_num,
-              int pagebox_spec, int minor_pdf_version_wanted,
-              int pdf_inclusion_errorlevel)
+// If the texmf.cnf (or environment) variable pdftex_inclusion_cache names
+// a file, the results of read_pdf_info() are kept there between runs,
+// so that an unchanged PDF file need not be parsed until its page is
+// actually written (which never happens in \pdfdraftmode). Entries are
+// found by the absolute file name, size and modification time of the
+// file, page and page box; entries for files that have changed since are
+// dropped when the cache is written.
+//
+// The file has one entry per line:
+//   size mtime pagebox page_spec page_num num_pages major minor
+//   orig_x orig_y width height rotate group dest_len:dest file_name
+
+#define PDF_INFO_CACHE_HEADER "% pdfTeX inclusion cache 2\n"
+
+struct PdfInfo {
+    char *file_name;
+    char *page_name;            // destination name or NULL
+    int page_spec;              // page number asked for
+    int pagebox_spec;
+    long long size;             // of the PDF file
+    long long mtime;
+    int page_num;               // page found
+    int num_pages;
+    int pdf_major_version;
+    int pdf_minor_version;
+    float orig_x, orig_y, width, height, rotate;
+    int has_page_group;
+};
+
+static struct avl_table *pdfInfoTree = 0;
+static char *pdfInfoCacheName = 0;
+static GBool pdfInfoCacheRead = gFalse;
+static GBool pdfInfoCacheChanged = gFalse;
+
+static int comp_pdf_info(const void *pa, const void *pb, void *p)
 {
-    PdfDocument *pdf_doc;
-    Page *page;
-    PDFRectangle *pagebox;
-#ifdef POPPLER_VERSION
-    int pdf_major_version_found, pdf_minor_version_found;
+    const PdfInfo *a = (const PdfInfo *) pa;
+    const PdfInfo *b = (const PdfInfo *) pb;
+    int r = strcmp(a->file_name, b->file_name);
+    if (r != 0)
+        return r;
+    cmp_return(a->size, b->size);
+    cmp_return(a->mtime, b->mtime);
+    cmp_return(a->page_spec, b->page_spec);
+    cmp_return(a->pagebox_spec, b->pagebox_spec);
+    if (a->page_name == 0 || b->page_name == 0)
+        return (a->page_name != 0) - (b->page_name != 0);
+    return strcmp(a->page_name, b->page_name);
+}
+
+static void destroy_pdf_info(void *pa, void *pb)
+{
+    PdfInfo *info = (PdfInfo *) pa;
+    xfree(info->file_name);
+    xfree(info->page_name);
+    delete info;
+}
+
+static void add_pdf_info(PdfInfo * info)
+{
+    void **p = avl_probe(pdfInfoTree, info);
+    if (p == NULL)
+        pdftex_fail("pdftoepdf.cc: avl_probe() out of memory in insertion");
+    if (*p != info) {           // replace an outdated entry
+        destroy_pdf_info(*p, NULL);
+        *p = info;
+    }
+}
+
+// The same relative name can refer to different files in different runs,
+// so entries are kept under the absolute name.
+static char *pdf_info_file_name(const char *image_name)
+{
+    static char *cwd = 0;
+    if (kpse_absolute_p(image_name, false))
+        return xstrdup(image_name);
+    if (cwd == 0)
+        cwd = xgetcwd();
+    while (image_name[0] == '.' && IS_DIR_SEP(image_name[1]))
+        image_name += 2;
+    return concat3(cwd, DIR_SEP_STRING, image_name);
+}
+
+static void read_pdf_info_cache()
+{
+    FILE *f;
+    char line[64];
+    pdfInfoCacheRead = gTrue;
+    pdfInfoCacheName = kpse_var_value("pdftex_inclusion_cache");
+    if (pdfInfoCacheName != 0 && *pdfInfoCacheName == 0) {
+        xfree(pdfInfoCacheName);
+        pdfInfoCacheName = 0;
+    }
+    if (pdfInfoCacheName == 0)
+        return;
+    pdfInfoTree = avl_create(comp_pdf_info, NULL, &avl_xallocator);
+    if ((f = fopen(pdfInfoCacheName, FOPEN_RBIN_MODE)) == NULL)
+        return;
+    // an unknown or damaged file is silently ignored and rewritten
+    if (fgets(line, sizeof(line), f) == NULL
+        || strcmp(line, PDF_INFO_CACHE_HEADER) != 0) {
+        fclose(f);
+        return;
+    }
+    while (1) {
+        PdfInfo info;
+        int len, c;
+        char buf[4096];
+        if (fscanf(f, "%lld %lld %d %d %d %d %d %d %g %g %g %g %g %d %d:",
+                   &info.size, &info.mtime, &info.pagebox_spec,
+                   &info.page_spec, &info.page_num, &info.num_pages,
+                   &info.pdf_major_version, &info.pdf_minor_version,
+                   &info.orig_x, &info.orig_y, &info.width, &info.height,
+                   &info.rotate, &info.has_page_group, &len) != 15
+            || len < -1 || len >= (int) sizeof(buf))
+            break;
+        info.page_name = 0;
+        if (len >= 0) {
+            if (fread(buf, 1, len, f) != (size_t) len)
+                break;
+            buf[len] = 0;
+            info.page_name = xstrdup(buf);
+        }
+        if (getc(f) != ' ' || fgets(buf, sizeof(buf), f) == NULL
+            || (len = strlen(buf)) == 0 || buf[len - 1] != '\n') {
+            xfree(info.page_name);
+            break;
+        }
+        buf[len - 1] = 0;
+        info.file_name = xstrdup(buf);
+        add_pdf_info(new PdfInfo(info));
+        if ((c = getc(f)) == EOF)
+            break;
+        ungetc(c, f);
+    }
+    fclose(f);
+}
+
+static void write_pdf_info_cache()
+{
+    FILE *f;
+    char *tmp_name;
+    struct avl_traverser t;
+    PdfInfo *info;
+    const char *stat_name = 0;
+    struct stat st;
+    int stat_ok = 0;
+    if (!pdfInfoCacheChanged)
+        return;
+    // several jobs may update the cache at the same time, so each one
+    // writes its own temporary file and renames it when complete
+#if defined(HAVE_MKSTEMP) && !defined(_WIN32)
+    int fd;
+    mode_t mask;
+    tmp_name = concat(pdfInfoCacheName, ".XXXXXX");
+    f = NULL;
+    if ((fd = mkstemp(tmp_name)) >= 0) {
+        mask = umask(0);
+        umask(mask);
+        fchmod(fd, 0666 & ~mask);       // mkstemp uses mode 0600
+        if ((f = fdopen(fd, FOPEN_WBIN_MODE)) == NULL) {
+            close(fd);
+            remove(tmp_name);
+        }
+    }
 #else
-    float pdf_version_found, pdf_version_wanted;
+    char pid_str[MAX_INT_LENGTH];
+    sprintf(pid_str, ".%ld", (long) getpid());
+    tmp_name = concat3(pdfInfoCacheName, pid_str, ".tmp");
+    f = fopen(tmp_name, FOPEN_WBIN_MODE);
 #endif
-    // initialize
-    if (!isInit) {
-        globalParams = new GlobalParams();
-        globalParams->setErrQuiet(gFalse);
-        isInit = gTrue;
+    if (f == NULL) {
+        pdftex_warn("PDF inclusion: cannot write cache file <%s>",
+                    pdfInfoCacheName);
+        free(tmp_name);
+        return;
     }
-    // open PDF file
-    pdf_doc = find_add_document(image_name);
-    epdf_doc = (void *) pdf_doc;
+    fputs(PDF_INFO_CACHE_HEADER, f);
+    avl_t_init(&t, pdfInfoTree);
+    for (info = (PdfInfo *) avl_t_first(&t, pdfInfoTree); info != NULL;
+         info = (PdfInfo *) avl_t_next(&t)) {
+        // entries of one file are adjacent; drop those that are outdated
+        if (stat_name == 0 || strcmp(stat_name, info->file_name) != 0) {
+            stat_name = info->file_name;
+            stat_ok = stat(stat_name, &st) == 0;
+        }
+        if (!stat_ok || info->size != (long long) st.st_size
+            || info->mtime != (long long) st.st_mtime)
+            continue;
+        fprintf(f, "%lld %lld %d %d %d %d %d %d %.9g %.9g %.9g %.9g %.9g %d ",
+                info->size, info->mtime, info->pagebox_spec, info->page_spec,
+                info->page_num, info->num_pages, info->pdf_major_version,
+                info->pdf_minor_version, info->orig_x, info->orig_y,
+                info->width, info->height, info->rotate,
+                info->has_page_group);
+        if (info->page_name == 0)
+            fputs("-1:", f);
+        else
+            fprintf(f, "%d:%s", (int) strlen(info->page_name),
+                    info->page_name);
+        fprintf(f, " %s\n", info->file_name);
+    }
+    if (fclose(f) != 0 || rename(tmp_name, pdfInfoCacheName) != 0) {
+        pdftex_warn("PDF inclusion: cannot write cache file <%s>",
+                    pdfInfoCacheName);
+        remove(tmp_name);
+    }
+    free(tmp_name);
+}
 
+static void check_pdf_version(int major, int minor, int minor_pdf_version_wanted,
+                              int pdf_inclusion_errorlevel)
+{
     // check PDF version
     // this works only for PDF 1.x -- but since any versions of PDF newer
     // than 1.x will not be backwards compatible to PDF 1.x, pdfTeX will
     // then have to changed drastically anyway.
 #ifdef POPPLER_VERSION
-    pdf_major_version_found = pdf_doc->doc->getPDFMajorVersion();
-    pdf_minor_version_found = pdf_doc->doc->getPDFMinorVersion();
-    if ((pdf_major_version_found > 1)
-     || (pdf_minor_version_found > minor_pdf_version_wanted)) {
+    if ((major > 1) || (minor > minor_pdf_version_wanted)) {
         const char *msg =
             "PDF inclusion: found PDF version <%d.%d>, but at most version <1.%d> allowed";
         if (pdf_inclusion_errorlevel > 0) {
-            pdftex_fail(msg, pdf_major_version_found, pdf_minor_version_found, minor_pdf_version_wanted);
+            pdftex_fail(msg, major, minor, minor_pdf_version_wanted);
         } else if (pdf_inclusion_errorlevel < 0) {
             ; /* do nothing */
         } else { /* = 0, give warning */
-            pdftex_warn(msg, pdf_major_version_found, pdf_minor_version_found, minor_pdf_version_wanted);
+            pdftex_warn(msg, major, minor, minor_pdf_version_wanted);
         }
     }
 #else
-    pdf_version_found = pdf_doc->doc->getPDFVersion();
-    pdf_version_wanted = 1 + (minor_pdf_version_wanted * 0.1);
+    float pdf_version_found = major + (minor * 0.1);
+    float pdf_version_wanted = 1 + (minor_pdf_version_wanted * 0.1);
     if (pdf_version_found > pdf_version_wanted + 0.01) {
         char msg[] =
             "PDF inclusion: found PDF version <%.1f>, but at most version <%.1f> allowed";
@@ -774,6 +1026,74 @@ read_pdf_info(char *image_name, char *page_name, int page_num,
         }
     }
 #endif
+}
+
+// Reads various information about the PDF and sets it up for later inclusion.
+// This will fail if the PDF version of the PDF is higher than
+// minor_pdf_version_wanted or page_name is given and can not be found.
+// It makes no sense to give page_name _and_ page_num.
+// Returns the page number.
+
+int
+read_pdf_info(char *image_name, char *page_name, int page_num,
+              int pagebox_spec, int minor_pdf_version_wanted,
+              int pdf_inclusion_errorlevel)
+{
+    PdfDocument *pdf_doc;
+    Page *page;
+    PDFRectangle *pagebox;
+    PdfInfo *info, tmp;
+    struct stat st;
+    char *file_name = 0;
+    // look for the page in the cache first
+    if (!pdfInfoCacheRead)
+        read_pdf_info_cache();
+    GBool useCache = pdfInfoTree != 0 && stat(image_name, &st) == 0;
+    if (useCache) {
+        file_name = pdf_info_file_name(image_name);
+        tmp.file_name = file_name;
+        tmp.page_name = page_name;
+        tmp.size = st.st_size;
+        tmp.mtime = st.st_mtime;
+        tmp.page_spec = page_num;
+        tmp.pagebox_spec = pagebox_spec;
+        info = (PdfInfo *) avl_find(pdfInfoTree, &tmp);
+        if (info != 0) {
+            xfree(file_name);
+            check_pdf_version(info->pdf_major_version,
+                              info->pdf_minor_version,
+                              minor_pdf_version_wanted,
+                              pdf_inclusion_errorlevel);
+            pdf_doc = find_add_document(image_name);
+            epdf_doc = (void *) pdf_doc;
+            epdf_num_pages = info->num_pages;
+            epdf_orig_x = info->orig_x;
+            epdf_orig_y = info->orig_y;
+            epdf_width = info->width;
+            epdf_height = info->height;
+            epdf_rotate = info->rotate;
+            epdf_has_page_group = info->has_page_group;
+            return info->page_num;
+        }
+    }
+    // open PDF file
+    pdf_doc = find_add_document(image_name);
+    open_document(pdf_doc);
+    epdf_doc = (void *) pdf_doc;
+
+    info = new PdfInfo;
+    info->page_spec = page_num;
+#ifdef POPPLER_VERSION
+    info->pdf_major_version = pdf_doc->doc->getPDFMajorVersion();
+    info->pdf_minor_version = pdf_doc->doc->getPDFMinorVersion();
+#else
+    double pdf_version = pdf_doc->doc->getPDFVersion();
+    info->pdf_major_version = (int) pdf_version;
+    info->pdf_minor_version =
+        (int) ((pdf_version - info->pdf_major_version) * 10 + 0.5);
+#endif
+    check_pdf_version(info->pdf_major_version, info->pdf_minor_version,
+                      minor_pdf_version_wanted, pdf_inclusion_errorlevel);
     epdf_num_pages = pdf_doc->doc->getCatalog()->getNumPages();
     if (page_name) {
         // get page by name
@@ -826,7 +1146,29 @@ read_pdf_info(char *image_name, char *page_name, int page_num,
     else
         epdf_has_page_group = 0;    // no page group present
 
-    pdf_doc->xref = pdf_doc->doc->getXRef();
+    // remember the result
+    if (useCache && (page_name == 0 || strchr(page_name, '\n') == 0)
+        && strchr(file_name, '\n') == 0) {
+        info->file_name = file_name;
+        info->page_name = page_name ? xstrdup(page_name) : 0;
+        info->pagebox_spec = pagebox_spec;
+        info->size = st.st_size;
+        info->mtime = st.st_mtime;
+        info->page_num = page_num;
+        info->num_pages = epdf_num_pages;
+        info->orig_x = epdf_orig_x;
+        info->orig_y = epdf_orig_y;
+        info->width = epdf_width;
+        info->height = epdf_height;
+        info->rotate = epdf_rotate;
+        info->has_page_group = epdf_has_page_group;
+        add_pdf_info(info);
+        pdfInfoCacheChanged = gTrue;
+    } else {
+        xfree(file_name);
+        delete info;
+    }
+
     return page_num;
 }
 
@@ -862,8 +1204,10 @@ void write_epdf(void)
 
     PdfDocument *pdf_doc = (PdfDocument *) epdf_doc;
     (pdf_doc->occurences)--;
-    xref = pdf_doc->xref;
+    open_document(pdf_doc);
     inObjList = pdf_doc->inObjList;
+    inObjTail = pdf_doc->inObjTail;
+    inObjTree = pdf_doc->inObjTree;
     encodingList = 0;
     page = pdf_doc->doc->getCatalog()->getPage(epdf_selected_page);
     pageRef = pdf_doc->doc->getCatalog()->getPageRef(epdf_selected_page);
@@ -1078,6 +1422,8 @@ void write_epdf(void)
 
     // save object list, xref
     pdf_doc->inObjList = inObjList;
+    pdf_doc->inObjTail = inObjTail;
+    pdf_doc->inObjTree = inObjTree;
     pdf_doc->xref = xref;
 }
 
@@ -1098,12 +1444,15 @@ void epdf_delete()
 
 void epdf_check_mem()
 {
+    if (pdfInfoTree != 0) {
+        write_pdf_info_cache();
+        avl_destroy(pdfInfoTree, destroy_pdf_info);
+        pdfInfoTree = 0;
+    }
     if (isInit) {
-        PdfDocument *p, *n;
-        for (p = pdfDocuments; p; p = n) {
-            n = p->next;
-            delete_document(p);
-        }
+        if (pdfDocuments != 0)
+            avl_destroy(pdfDocuments, destroy_document);
+        pdfDocuments = 0;
         // see above for globalParams
         delete globalParams;
     }
@@ -433,6 +433,26 @@ static struct {
     (SYNCTEX_NO_GZ||((synctex_ctxt.options)&2)!=0)
 #   define SYNCTEX_WITH_FORMS (((synctex_ctxt.options)&4)!=0)
 #   define SYNCTEX_H_COMPRESS (((synctex_ctxt.options)&8)!=0)
+#   define SYNCTEX_WITH_INDEX (((synctex_ctxt.options)&16)!=0)
+
+/*  The foo.synctex.idx index, written along with the .synctex file
+ *  if |synctex_options&16|>0.  It gives the offset of each sheet and of the
+ *  postamble, and for each sheet the range of lines recorded from each input.
+ *  Each of these offsets starts a new gzip member of the .synctex.gz file,
+ *  such that a reader can decode one sheet alone. See synctex(5).  */
+#   define SYNCTEX_INDEX_VERSION 1
+
+typedef struct {
+    integer tag, first, last;   /*  the lines of tag recorded in the current sheet  */
+} synctex_lines_t;
+
+static struct {
+    FILE *file;                 /*  the foo.synctex.idx(busy) file, NULL when there is no index  */
+    char *busy_name;            /*  its name  */
+    synctex_lines_t *lines;     /*  the line ranges of the current sheet  */
+    int count;                  /*  the number of line ranges in use  */
+    int size;                   /*  the number of line ranges allocated  */
+} synctex_index = {NULL, NULL, NULL, 0, 0};
 
 static inline void _synctex_read_command_line_option(void) {
 #   if SYNCTEX_DEBUG
@@ -481,6 +501,8 @@ void synctexinitcommand(void)
     return;
 }
 
+static void synctex_index_abort(void);
+
 /*  Free all memory used, close and remove the file if any,
  *  It is sent locally when there is a problem with synctex output.
  *  It is sent by pdftex when a fatal error occurred in pdftex.web. */
@@ -505,6 +527,7 @@ void synctexabort(boolean log_opened __attribute__ ((unused)))
         SYNCTEX_FREE(synctex_ctxt.busy_name);
         synctex_ctxt.busy_name = NULL;
     }
+    synctex_index_abort();
     if (NULL != synctex_ctxt.root_name) {
         SYNCTEX_FREE(synctex_ctxt.root_name);
         synctex_ctxt.root_name = NULL;
@@ -514,13 +537,17 @@ void synctexabort(boolean log_opened __attribute__ ((unused)))
 
 static inline int synctex_record_preamble(void);
 static inline int synctex_record_input(integer tag, char *name);
+static void synctex_index_open(void);
 
 static const char *synctex_suffix = ".synctex";
 static const char *synctex_suffix_gz = ".gz";
 static const char *synctex_suffix_busy = "(busy)";
+static const char *synctex_suffix_index = ".idx";
 
 /*  for DIR_SEP_STRING */
 #   include <kpathsea/c-pathch.h>
+/*  for stat */
+#   include <kpathsea/c-stat.h>
 /*  for kpse_absolute_p */
 #   include <kpathsea/absolute.h>
 
@@ -695,6 +722,9 @@ static void *synctex_dot_open(void)
                     /*  synctex_ctxt.busy_name was NULL before, it now owns the_busy_name */
                     synctex_ctxt.busy_name = the_busy_name;
                     the_busy_name = NULL;
+                    if (SYNCTEX_WITH_INDEX) {
+                        synctex_index_open();
+                    }
                     /*  print the preamble, this is quite an UTF8 file  */
                     if (NULL != synctex_ctxt.root_name) {
                         synctex_record_input(1, synctex_ctxt.root_name);
@@ -862,6 +892,180 @@ void synctexstartinput(void)
  *  global context variable.
  */
 
+/*  The index functions below do nothing unless synctex_index.file is set.
+ *  A problem with the index only drops the index, the .synctex file is kept.  */
+
+/*  The name of the index of the given foo.synctex file, to be freed by the caller.  */
+static char *synctex_index_name(const char *synctex_name)
+{
+    char *the_name = xmalloc(strlen(synctex_name) + strlen(synctex_suffix_index) + 1);
+    strcpy(the_name, synctex_name);
+    strcat(the_name, synctex_suffix_index);
+    return the_name;
+}
+
+/*  Open foo.synctex.idx(busy) next to foo.synctex(busy).  */
+static void synctex_index_open(void)
+{
+    size_t len = strlen(synctex_ctxt.busy_name) - strlen(synctex_suffix_busy);
+    char *the_busy_name = xmalloc(len
+                                  + strlen(synctex_suffix_index)
+                                  + strlen(synctex_suffix_busy)
+                                  + 1);
+    strncpy(the_busy_name, synctex_ctxt.busy_name, len);
+    the_busy_name[len] = (char)0;
+    strcat(the_busy_name, synctex_suffix_index);
+    strcat(the_busy_name, synctex_suffix_busy);
+    synctex_index.busy_name = the_busy_name;
+    synctex_index.count = 0;
+    synctex_index.file = fopen(the_busy_name, FOPEN_W_MODE);
+    if (NULL == synctex_index.file
+        || fprintf(synctex_index.file, "SyncTeX Index:%i\n", SYNCTEX_INDEX_VERSION) < 0) {
+        printf("\nSyncTeX warning: no index, problem with %s\n", the_busy_name);
+        synctex_index_abort();
+    }
+}
+
+/*  Close and remove the index, free all memory used.  */
+static void synctex_index_abort(void)
+{
+    if (synctex_index.file) {
+        fclose(synctex_index.file);
+        synctex_index.file = NULL;
+        remove(synctex_index.busy_name);
+    }
+    SYNCTEX_FREE(synctex_index.busy_name);
+    synctex_index.busy_name = NULL;
+    SYNCTEX_FREE(synctex_index.lines);
+    synctex_index.lines = NULL;
+    synctex_index.count = synctex_index.size = 0;
+}
+
+static void synctex_index_printf(const char *format, ...)
+{
+    va_list args;
+    int len;
+    if (NULL == synctex_index.file) {
+        return;
+    }
+    va_start(args, format);
+    len = vfprintf(synctex_index.file, format, args);
+    va_end(args);
+    if (len < 0) {
+        synctex_index_abort();
+    }
+}
+
+/*  End the current gzip member of the .synctex.gz file such that the next
+ *  record starts a new one, and return the offset of that record, -1 on error.  */
+static long synctex_index_offset(void)
+{
+    if (SYNCTEX_NO_GZ) {
+        return ftell((FILE *) SYNCTEX_FILE);
+    }
+    if (Z_OK != gzflush((gzFile) SYNCTEX_FILE, Z_FINISH)) {
+        return -1;
+    }
+    return (long) gzoffset((gzFile) SYNCTEX_FILE);
+}
+
+/*  Recording a "Sheet:..." line, just before the "{..." line of the .synctex file  */
+static void synctex_index_sheet(integer sheet)
+{
+    long offset;
+    if (NULL == synctex_index.file) {
+        return;
+    }
+    if ((offset = synctex_index_offset()) < 0) {
+        synctex_index_abort();
+        return;
+    }
+    synctex_index.count = 0;
+    synctex_index_printf("Sheet:%i:%li\n", sheet, offset);
+}
+
+/*  Recording the "Lines:..." lines, just after the "}..." line of the .synctex file  */
+static void synctex_index_teehs(void)
+{
+    int i;
+    for (i = 0; i < synctex_index.count; ++i) {
+        synctex_index_printf("Lines:%i:%i:%i\n",
+                             synctex_index.lines[i].tag,
+                             synctex_index.lines[i].first,
+                             synctex_index.lines[i].last);
+    }
+    synctex_index.count = 0;
+}
+
+/*  Recording a "Postamble:..." line, just before the postamble of the .synctex file  */
+static void synctex_index_postamble(void)
+{
+    long offset;
+    if (NULL == synctex_index.file) {
+        return;
+    }
+    if ((offset = synctex_index_offset()) < 0) {
+        synctex_index_abort();
+        return;
+    }
+    synctex_index_printf("Postamble:%li\n", offset);
+}
+
+/*  Extend the range of lines of the given input recorded in the current sheet.
+ *  The most recent input is in general the last one.  */
+static inline void synctex_index_line(integer tag, integer line)
+{
+    int i;
+    if (NULL == synctex_index.file || tag <= 0) {
+        return;
+    }
+    for (i = synctex_index.count; i-- > 0;) {
+        if (synctex_index.lines[i].tag == tag) {
+            if (line < synctex_index.lines[i].first) {
+                synctex_index.lines[i].first = line;
+            } else if (line > synctex_index.lines[i].last) {
+                synctex_index.lines[i].last = line;
+            }
+            return;
+        }
+    }
+    if (synctex_index.count == synctex_index.size) {
+        synctex_index.size += 16;
+        synctex_index.lines = xrealloc(synctex_index.lines,
+                                       synctex_index.size * sizeof(synctex_lines_t));
+    }
+    synctex_index.lines[synctex_index.count].tag = tag;
+    synctex_index.lines[synctex_index.count].first = line;
+    synctex_index.lines[synctex_index.count].last = line;
+    ++synctex_index.count;
+}
+
+/*  Recording the "Size:..." and "Mtime:..." lines once the .synctex file
+ *  is closed, then move the working index to its final name.  */
+static void synctex_index_terminate(const char *synctex_name, const char *index_name)
+{
+    struct stat st;
+    FILE *file;
+    if (NULL == synctex_index.file) {
+        return;
+    }
+    if (0 != stat(synctex_name, &st)) {
+        synctex_index_abort();
+        return;
+    }
+    synctex_index_printf("Size:%li\n", (long) st.st_size);
+    synctex_index_printf("Mtime:%li\n", (long) st.st_mtime);
+    if ((file = synctex_index.file)) {
+        synctex_index.file = NULL;
+        if (0 != fclose(file) || 0 != rename(synctex_index.busy_name, index_name)) {
+            fprintf(stderr, "SyncTeX: Can't rename %s to %s\n",
+                    synctex_index.busy_name, index_name);
+            remove(synctex_index.busy_name);
+        }
+    }
+    synctex_index_abort();
+}
+
 static inline int synctex_record_postamble(void);
 
 
@@ -880,6 +1084,7 @@ void synctexterminate(boolean log_opened)
 {
     char *tmp = NULL;
     char *the_real_syncname = NULL;
+    char *the_index_name = NULL;
     SYNCTEX_RETURN_IF_DISABLED;
 #   if SYNCTEX_DEBUG
     printf("\nSynchronize DEBUG: synctexterminate\n");
@@ -909,6 +1114,9 @@ void synctexterminate(boolean log_opened)
             }
         }
         strcat(the_real_syncname, synctex_suffix);
+        /*  Remove any index from a previous build, it is created again below if relevant. */
+        the_index_name = synctex_index_name(the_real_syncname);
+        remove(the_index_name);
         if (!SYNCTEX_NO_GZ) {
             /*  Remove any uncompressed synctex file, from a previous build. */
             remove(the_real_syncname);
@@ -934,6 +1142,7 @@ void synctexterminate(boolean log_opened)
                 SYNCTEX_FILE = NULL;
                 /*  renaming the working synctex file */
                 if (0 == rename(synctex_ctxt.busy_name, the_real_syncname)) {
+                    synctex_index_terminate(the_real_syncname, the_index_name);
                     if (log_opened) {
                         tmp = the_real_syncname;
 #                       if SYNCTEX_DO_NOT_LOG_OUTPUT_DIRECTORY
@@ -1026,6 +1235,8 @@ void synctexterminate(boolean log_opened)
         tmp = NULL;
         strcat(the_real_syncname, synctex_suffix);
         remove(the_real_syncname);
+        the_index_name = synctex_index_name(the_real_syncname);
+        remove(the_index_name);
         strcat(the_real_syncname, synctex_suffix_gz);
         remove(the_real_syncname);
         if (SYNCTEX_FILE) {
@@ -1044,6 +1255,8 @@ void synctexterminate(boolean log_opened)
     synctex_ctxt.busy_name = NULL;
     SYNCTEX_FREE(the_real_syncname);
     the_real_syncname = NULL;
+    SYNCTEX_FREE(the_index_name);
+    the_index_name = NULL;
     synctexabort(0);
 }
 
@@ -1132,6 +1345,7 @@ static inline int synctex_record_teehs(integer sheet)
 #   endif
     if (SYNCTEX_NOERR == synctex_record_anchor()) {
         int len = SYNCTEX_fprintf(SYNCTEX_FILE, "}%i\n", sheet);
+        synctex_index_teehs();
         SYNCTEX_RECORD_LEN_AND_RETURN_NOERR;
     }
     synctexabort(0);
@@ -1225,6 +1439,8 @@ static inline int synctex_record_pdfxform(halfword form)
         if (SYNCTEX_WITH_FORMS) {
             int len = SYNCTEX_fprintf(SYNCTEX_FILE, "<%i\n",
                                   SYNCTEX_PDF_CUR_FORM);
+            /*  forms live outside of the sheets, they are not indexed  */
+            synctex_index_abort();
             SYNCTEX_RECORD_LEN_AND_RETURN_NOERR;
         } else {
             return SYNCTEX_NO_ERROR;
@@ -1690,6 +1906,7 @@ void synctexcurrent(void)
         }
         if (len > 0) {
             synctex_ctxt.total_length += len;
+            synctex_index_line(synctex_ctxt.tag, synctex_ctxt.line);
             return;
         }
     }
@@ -1747,6 +1964,7 @@ static inline int synctex_record_input(integer tag, char *name)
     printf("\nSynchronize DEBUG: synctex_record_input\n");
 #   endif
     len = SYNCTEX_fprintf(SYNCTEX_FILE, "Input:%i:%s\n", tag, name);
+    synctex_index_printf("Input:%i:%s\n", tag, name);
     if (len > 0) {
         synctex_ctxt.total_length += len;
         return SYNCTEX_NOERR;
@@ -1799,6 +2017,7 @@ static inline int synctex_record_sheet(integer sheet)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_sheet\n");
 #   endif
+    synctex_index_sheet(sheet);
     if (SYNCTEX_NOERR == synctex_record_anchor()) {
         int len = SYNCTEX_fprintf(SYNCTEX_FILE, "{%i\n", sheet);
         SYNCTEX_RECORD_LEN_AND_RETURN_NOERR;
@@ -1814,6 +2033,7 @@ static inline void synctex_record_node_void_vlist(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_void_vlist\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,box), SYNCTEX_LINE_MODEL(p,box));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "v%i,%i:%i,=:%i,%i,%i\n",
                               SYNCTEX_TAG_MODEL(p,box),
@@ -1852,6 +2072,7 @@ static inline void synctex_record_node_vlist(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_vlist\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,box), SYNCTEX_LINE_MODEL(p,box));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "[%i,%i:%i,=:%i,%i,%i\n",
                               SYNCTEX_TAG_MODEL(p,box),
@@ -1896,6 +2117,7 @@ static inline void synctex_record_node_void_hlist(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_void_hlist\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,box), SYNCTEX_LINE_MODEL(p,box));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "h%i,%i:%i,=:%i,%i,%i\n",
                               SYNCTEX_TAG_MODEL(p,box),
@@ -1928,6 +2150,7 @@ static inline void synctex_record_hlist(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_hlist\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,box), SYNCTEX_LINE_MODEL(p,box));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "(%i,%i:%i,=:%i,%i,%i\n",
                               SYNCTEX_TAG_MODEL(p,box),
@@ -1987,6 +2210,7 @@ static inline int synctex_record_postamble(void)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_postamble\n");
 #   endif
+    synctex_index_postamble();
     if (SYNCTEX_NOERR == synctex_record_anchor()) {
         int len = SYNCTEX_fprintf(SYNCTEX_FILE, "Postamble:\n");
         if (len > 0) {
@@ -2012,6 +2236,7 @@ static inline void synctex_record_node_glue(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_glue\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,glue), SYNCTEX_LINE_MODEL(p,glue));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "g%i,%i:%i,=\n",
                               SYNCTEX_TAG_MODEL(p,glue),
@@ -2037,6 +2262,7 @@ static inline void synctex_record_node_kern(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_kern\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,glue), SYNCTEX_LINE_MODEL(p,glue));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "k%i,%i:%i,=:%i\n",
                               SYNCTEX_TAG_MODEL(p,glue),
@@ -2064,6 +2290,7 @@ static inline void synctex_record_node_rule(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_tsilh\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p,rule), SYNCTEX_LINE_MODEL(p,rule));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "r%i,%i:%i,=:%i,%i,%i\n",
                               SYNCTEX_TAG_MODEL(p,rule),
@@ -2091,6 +2318,7 @@ void synctex_record_node_math(halfword p)
 #   if SYNCTEX_DEBUG > 999
     printf("\nSynchronize DEBUG: synctex_record_node_math\n");
 #   endif
+    synctex_index_line(SYNCTEX_TAG_MODEL(p, math), SYNCTEX_LINE_MODEL(p, math));
     if (SYNCTEX_SHOULD_COMPRESS_V) {
         len = SYNCTEX_fprintf(SYNCTEX_FILE, "$%i,%i:%i,=\n",
                               SYNCTEX_TAG_MODEL(p, math),
@@ -101,6 +101,17 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if !defined(O_BINARY)
+#   define O_BINARY 0
+#endif
 
 #if defined(HAVE_LOCALE_H)
 #include <locale.h>
@@ -122,6 +133,7 @@ SYNCTEX_INLINE static int _synctex_abs(int x) {
 /*  These are the possible extensions of the synctex file */
 const char * synctex_suffix = ".synctex";
 const char * synctex_suffix_gz = ".gz";
+static const char * synctex_suffix_index = ".idx";
 
 typedef synctex_node_p(*synctex_node_new_f)(synctex_scanner_p);
 typedef void(*synctex_node_fld_f)(synctex_node_p);
@@ -776,6 +788,38 @@ synctex_reader_p synctex_reader_init_with_output_file(synctex_reader_p reader, c
 #       pragma mark -
 #       pragma mark SCANNER
 #   endif
+/**
+ *  The content of the optional foo.synctex.idx index, see synctex(5).
+ *  When available, the sheets are parsed one at a time, on demand.
+ *  first_range and number_of_ranges locate the line ranges of a sheet
+ *  in the ranges array.
+ */
+typedef struct {
+    int page;
+    int offset;             /*  where the sheet starts in the synctex file */
+    int first_range;
+    int number_of_ranges;
+    synctex_bool_t parsed;
+} synctex_index_sheet_s;
+
+typedef struct {
+    int tag;
+    int first;              /*  the lines of tag recorded in the sheet */
+    int last;
+} synctex_index_range_s;
+
+typedef struct {
+    synctex_index_sheet_s * sheets;
+    int number_of_sheets;
+    synctex_index_range_s * ranges;
+    int number_of_ranges;
+    int postamble;          /*  where the postamble starts in the synctex file */
+    int size;               /*  the size of the synctex file when it was written */
+    int mtime;              /*  its modification time, as an int */
+    synctex_bool_t has_mtime;
+} synctex_index_s;
+typedef synctex_index_s * synctex_index_p;
+
 /**
  *  The synctex scanner is the root object.
  *  Is is initialized with the contents of a text file or a gzipped file.
@@ -808,6 +852,7 @@ struct synctex_scanner_t {
     synctex_node_p ref_in_form;  /*  The first form ref node, its friends are the other form ref nodes in sheet */
     int number_of_lists;    /*  The number of friend lists */
     synctex_node_r lists_of_friends;/*  The friend lists */
+    synctex_index_p index;  /*  The index, NULL when all the sheets are parsed at once */
     synctex_class_s class_[synctex_node_number_of_types]; /*  The classes of the nodes of the scanner */
     int display_switcher;
     char * display_prompt;
@@ -4225,6 +4270,14 @@ static synctex_ns_s __synctex_parse_new_input(synctex_scanner_p scanner) {
         synctex_node_free(input);
         return (synctex_ns_s){NULL,status};
     }
+    /*  With an index, the input records were already read from it */
+    if (scanner->index && scanner->input) {
+        synctex_node_p known = synctex_scanner_input_with_tag(scanner,_synctex_data_tag(input));
+        if (known) {
+            synctex_node_free(input);
+            return (synctex_ns_s){known,_synctex_next_line(scanner)};
+        }
+    }
     /*  The next character is a field separator, we expect one character in the buffer. */
     zs = _synctex_buffer_get_available_size(scanner, 1);
     if (zs.status<=SYNCTEX_STATUS_ERROR) {
@@ -4709,16 +4762,20 @@ static synctex_ns_s _synctex_parse_new_sheet(synctex_scanner_p scanner) {
         } else if (_synctex_next_line(scanner)<SYNCTEX_STATUS_OK) {
             _synctex_error("Missing end of sheet.");
         } else {
-            /* Now set the owner */
-            if (scanner->sheet) {
+            /* Now set the owner, keeping the sheets in page order:
+             * with an index, they are not parsed in the file order. */
+            if (scanner->sheet && _synctex_data_page(scanner->sheet)<_synctex_data_page(node)) {
                 synctex_node_p last_sheet = scanner->sheet;
                 synctex_node_p next_sheet = NULL;
-                while ((next_sheet = __synctex_tree_sibling(last_sheet))) {
+                while ((next_sheet = __synctex_tree_sibling(last_sheet))
+                       && _synctex_data_page(next_sheet)<_synctex_data_page(node)) {
                     last_sheet = next_sheet;
                 }
                 /* sheets have no parent */
+                __synctex_tree_set_sibling(node,next_sheet);
                 __synctex_tree_set_sibling(last_sheet,node);
             } else {
+                __synctex_tree_set_sibling(node,scanner->sheet);
                 scanner->sheet = node;
             }
             return (synctex_ns_s){node,SYNCTEX_STATUS_OK};
@@ -5640,6 +5697,10 @@ _synctex_make_hbox_contain_box(parent,_synctex_data_box(child));
                     _synctex_error("Missing anchor.");
                 }
                 parent = sheet = NULL;
+                if (scanner->index) {
+                    /*  With an index, sheets are parsed one at a time. */
+                    SYNCTEX_RETURN(SYNCTEX_STATUS_OK);
+                }
                 goto main_loop;
             }
         } else if (SYNCTEX_START_SCAN(END_FORM)) {
@@ -5968,6 +6029,291 @@ content_not_found:
     }
     return status;
 }
+#	ifdef SYNCTEX_NOTHING
+#       pragma mark -
+#       pragma mark INDEX
+#   endif
+static void _synctex_index_free(synctex_index_p index) {
+    if (index) {
+        _synctex_free(index->sheets);
+        _synctex_free(index->ranges);
+        _synctex_free(index);
+    }
+}
+/*  Make the reader read the synctex file from the given offset,
+ *  which starts a gzip member when the file is compressed.
+ *  The current file of the reader, if any, must be saved by the caller.
+ */
+static synctex_status_t _synctex_index_seek(synctex_scanner_p scanner, int offset) {
+    int fd = open(scanner->reader->synctex,O_RDONLY|O_BINARY);
+    if (fd<0) {
+        _synctex_error("could not open %s, error %i\n",scanner->reader->synctex,errno);
+        return SYNCTEX_STATUS_ERROR;
+    }
+    if (lseek(fd,offset,SEEK_SET)!=offset || NULL == (SYNCTEX_FILE = gzdopen(fd,"rb"))) {
+        close(fd);
+        return SYNCTEX_STATUS_ERROR;
+    }
+    SYNCTEX_CUR = SYNCTEX_END;
+    return SYNCTEX_STATUS_OK;
+}
+/*  Used when parsing the index.
+ *  Read a "Sheet:page:offset" or "Lines:tag:first:last" record,
+ *  the mark being already matched.
+ */
+static synctex_status_t _synctex_scan_index_sheet(synctex_scanner_p scanner) {
+    synctex_index_p index = scanner->index;
+    synctex_is_s page = _synctex_decode_int(scanner);
+    synctex_is_s offset = _synctex_decode_int(scanner);
+    if (page.status<SYNCTEX_STATUS_OK || offset.status<SYNCTEX_STATUS_OK) {
+        return SYNCTEX_STATUS_ERROR;
+    }
+    if (!(index->number_of_sheets & 63)) {
+        synctex_index_sheet_s * sheets = realloc(index->sheets,(index->number_of_sheets+64)*sizeof(synctex_index_sheet_s));
+        if (NULL == sheets) {
+            return SYNCTEX_STATUS_ERROR;
+        }
+        index->sheets = sheets;
+    }
+    index->sheets[index->number_of_sheets] = (synctex_index_sheet_s){page.integer,offset.integer,index->number_of_ranges,0,synctex_NO};
+    ++index->number_of_sheets;
+    return SYNCTEX_STATUS_OK;
+}
+static synctex_status_t _synctex_scan_index_lines(synctex_scanner_p scanner) {
+    synctex_index_p index = scanner->index;
+    synctex_is_s tag = _synctex_decode_int(scanner);
+    synctex_is_s first = _synctex_decode_int(scanner);
+    synctex_is_s last = _synctex_decode_int(scanner);
+    synctex_node_p input = NULL;
+    if (tag.status<SYNCTEX_STATUS_OK || first.status<SYNCTEX_STATUS_OK || last.status<SYNCTEX_STATUS_OK
+        || index->number_of_sheets == 0) {
+        return SYNCTEX_STATUS_ERROR;
+    }
+    if (!(index->number_of_ranges & 255)) {
+        synctex_index_range_s * ranges = realloc(index->ranges,(index->number_of_ranges+256)*sizeof(synctex_index_range_s));
+        if (NULL == ranges) {
+            return SYNCTEX_STATUS_ERROR;
+        }
+        index->ranges = ranges;
+    }
+    index->ranges[index->number_of_ranges] = (synctex_index_range_s){tag.integer,first.integer,last.integer};
+    ++index->number_of_ranges;
+    ++index->sheets[index->number_of_sheets-1].number_of_ranges;
+    /*  The largest line number of an input is known without parsing the sheets */
+    if (scanner->input
+        && (input = synctex_scanner_input_with_tag(scanner,tag.integer))
+        && last.integer>_synctex_data_line(input)) {
+        _synctex_data_set_line(input,last.integer);
+    }
+    return SYNCTEX_STATUS_OK;
+}
+/*  Used when parsing the index.
+ *  Read the postamble of the synctex file at the offset given by the index.
+ *  The synctex file must not be in use.
+ */
+static synctex_status_t _synctex_scan_index_postamble(synctex_scanner_p scanner) {
+    synctex_status_t status = _synctex_index_seek(scanner,scanner->index->postamble);
+    if (status<SYNCTEX_STATUS_OK) {
+        return status;
+    }
+    if (_synctex_buffer_get_available_size(scanner,1).size>0 && *SYNCTEX_CUR == SYNCTEX_CHAR_ANCHOR) {
+        _synctex_next_line(scanner);
+    }
+    if ((status = _synctex_match_string(scanner,"Postamble:")) == SYNCTEX_STATUS_OK) {
+        scanner->flags.postamble = 1;
+        if ((status = _synctex_scan_postamble(scanner))<SYNCTEX_STATUS_OK) {
+            _synctex_error("Bad postamble. Ignored\n");
+            status = SYNCTEX_STATUS_OK;
+        }
+    } else {
+        status = SYNCTEX_STATUS_ERROR;
+    }
+    if (SYNCTEX_FILE) {
+        gzclose(SYNCTEX_FILE);
+        SYNCTEX_FILE = NULL;
+    }
+    SYNCTEX_CUR = SYNCTEX_END;
+    return status;
+}
+/*  Read the foo.synctex.idx index of the foo.synctex or foo.synctex.gz file, if any.
+ *  This is done before anything is read from the synctex file.
+ *  On success, the index records the sheets, the input records and the postamble
+ *  are read, and the sheets will be parsed on demand.
+ *  On failure, nothing is changed and the whole synctex file will be parsed.
+ *  - returns: SYNCTEX_STATUS_OK when the index is available and in sync with the synctex file.
+ */
+static synctex_status_t _synctex_scan_index(synctex_scanner_p scanner) {
+    synctex_status_t status = SYNCTEX_STATUS_OK;
+    gzFile synctex_file = SYNCTEX_FILE;
+    char * name = NULL;
+    size_t len = strlen(scanner->reader->synctex);
+    struct stat st;
+    /*  foo.synctex.gz -> foo.synctex.idx */
+    if (len>strlen(synctex_suffix_gz)
+        && !strcmp(scanner->reader->synctex+len-strlen(synctex_suffix_gz),synctex_suffix_gz)) {
+        len -= strlen(synctex_suffix_gz);
+    }
+    if (NULL == (name = (char *)_synctex_malloc(len+strlen(synctex_suffix_index)+1))) {
+        return SYNCTEX_STATUS_ERROR;
+    }
+    memcpy(name,scanner->reader->synctex,len);
+    strcpy(name+len,synctex_suffix_index);
+    SYNCTEX_FILE = gzopen(name,"rb");
+    _synctex_free(name);
+    if (NULL == SYNCTEX_FILE) {
+        SYNCTEX_FILE = synctex_file;
+        return SYNCTEX_STATUS_NOT_OK;
+    }
+    if (NULL == (scanner->index = (synctex_index_p)_synctex_malloc(sizeof(synctex_index_s)))) {
+        gzclose(SYNCTEX_FILE);
+        SYNCTEX_FILE = synctex_file;
+        return SYNCTEX_STATUS_ERROR;
+    }
+    if ((status = _synctex_match_string(scanner,"SyncTeX Index:")) == SYNCTEX_STATUS_OK
+        && _synctex_decode_int(scanner).integer == 1) {
+        status = _synctex_next_line(scanner);
+        while (status == SYNCTEX_STATUS_OK) {
+            synctex_ns_s input = __synctex_parse_new_input(scanner);
+            if (input.status != SYNCTEX_STATUS_NOT_OK) {
+                /*  The line termination was read. */
+                status = input.status;
+                continue;
+            }
+            if ((status = _synctex_match_string(scanner,"Sheet:")) == SYNCTEX_STATUS_OK) {
+                status = _synctex_scan_index_sheet(scanner);
+            } else if (status == SYNCTEX_STATUS_NOT_OK
+                       && (status = _synctex_match_string(scanner,"Lines:")) == SYNCTEX_STATUS_OK) {
+                status = _synctex_scan_index_lines(scanner);
+            } else if (status == SYNCTEX_STATUS_NOT_OK
+                       && (status = _synctex_match_string(scanner,"Postamble:")) == SYNCTEX_STATUS_OK) {
+                synctex_is_s is = _synctex_decode_int(scanner);
+                scanner->index->postamble = is.integer;
+                status = is.status;
+            } else if (status == SYNCTEX_STATUS_NOT_OK
+                       && (status = _synctex_match_string(scanner,"Size:")) == SYNCTEX_STATUS_OK) {
+                synctex_is_s is = _synctex_decode_int(scanner);
+                scanner->index->size = is.integer;
+                status = is.status;
+            } else if (status == SYNCTEX_STATUS_NOT_OK
+                       && (status = _synctex_match_string(scanner,"Mtime:")) == SYNCTEX_STATUS_OK) {
+                synctex_is_s is = _synctex_decode_int(scanner);
+                scanner->index->mtime = is.integer;
+                scanner->index->has_mtime = synctex_YES;
+                status = is.status;
+            } else if (status == SYNCTEX_STATUS_NOT_OK) {
+                /*  Ignore unknown records */
+                status = SYNCTEX_STATUS_OK;
+            }
+            if (status == SYNCTEX_STATUS_OK) {
+                status = _synctex_next_line(scanner);
+            }
+        }
+    }
+    if (SYNCTEX_FILE) {
+        gzclose(SYNCTEX_FILE);
+        SYNCTEX_FILE = NULL;
+    }
+    SYNCTEX_CUR = SYNCTEX_END;
+    /*  The index is written last: the size is known only when the index is complete.
+     *  The index only describes the very file it was written with: any change,
+     *  by another run or by synctex_updater, makes it out of sync.
+     *  The mtime goes through _synctex_decode_int, hence the int cast. */
+    if (status == SYNCTEX_STATUS_EOF
+        && scanner->index->size>0
+        && scanner->index->postamble>0
+        && scanner->index->has_mtime
+        && 0 == stat(scanner->reader->synctex,&st)
+        && st.st_size == scanner->index->size
+        && (int)st.st_mtime == scanner->index->mtime
+        && _synctex_scan_index_postamble(scanner) == SYNCTEX_STATUS_OK) {
+        SYNCTEX_FILE = synctex_file;
+        return SYNCTEX_STATUS_OK;
+    }
+    _synctex_error("The index of %s is not in sync, ignored.",scanner->reader->synctex);
+    _synctex_index_free(scanner->index);
+    scanner->index = NULL;
+    synctex_node_free(scanner->input);
+    scanner->input = NULL;
+    scanner->flags.postamble = 0;
+    scanner->count = 0;
+    scanner->unit = 0;
+    scanner->x_offset = scanner->y_offset = 6.027e23f;
+    SYNCTEX_FILE = synctex_file;
+    return SYNCTEX_STATUS_NOT_OK;
+}
+/*  Parse the given sheet of the index, if not already done.
+ *  The synctex file must not be in use.
+ */
+static synctex_status_t _synctex_index_parse_sheet(synctex_scanner_p scanner, synctex_index_sheet_s * sheet) {
+    synctex_status_t status = SYNCTEX_STATUS_OK;
+    if (sheet->parsed) {
+        return SYNCTEX_STATUS_OK;
+    }
+    sheet->parsed = synctex_YES;/*  Do not try again on error */
+    if (NULL == (SYNCTEX_START = (char *)malloc(SYNCTEX_BUFFER_SIZE+1))) {
+        _synctex_error("!  malloc error in _synctex_index_parse_sheet.");
+        return SYNCTEX_STATUS_ERROR;
+    }
+    SYNCTEX_END = SYNCTEX_START+SYNCTEX_BUFFER_SIZE;
+    *SYNCTEX_END = '\0';
+    if ((status = _synctex_index_seek(scanner,sheet->offset)) == SYNCTEX_STATUS_OK) {
+        scanner->reader->lastv = -1;
+        if (_synctex_buffer_get_available_size(scanner,1).size>0 && *SYNCTEX_CUR == SYNCTEX_CHAR_ANCHOR) {
+            _synctex_next_line(scanner);
+        }
+        if ((status = _synctex_buffer_get_available_size(scanner,1).status)>=SYNCTEX_STATUS_OK
+            && *SYNCTEX_CUR == SYNCTEX_CHAR_BEGIN_SHEET) {
+            status = __synctex_parse_sfi(scanner);
+            if (status == SYNCTEX_STATUS_OK) {
+                status = _synctex_post_process(scanner);
+            }
+        } else {
+            status = SYNCTEX_STATUS_ERROR;
+        }
+        if (SYNCTEX_FILE) {
+            gzclose(SYNCTEX_FILE);
+            SYNCTEX_FILE = NULL;
+        }
+    }
+    free((void *)SYNCTEX_START);
+    SYNCTEX_START = SYNCTEX_CUR = SYNCTEX_END = NULL;
+    if (status<SYNCTEX_STATUS_OK) {
+        _synctex_error("Bad sheet %i in %s.",sheet->page,scanner->reader->synctex);
+    }
+    return status;
+}
+/*  Parse the sheet with the given page number, all the sheets if page is 0.
+ */
+static void _synctex_index_parse_page(synctex_scanner_p scanner, int page) {
+    if (scanner && scanner->index) {
+        int i;
+        for (i = 0; i<scanner->index->number_of_sheets; ++i) {
+            if (page == 0 || page == scanner->index->sheets[i].page) {
+                _synctex_index_parse_sheet(scanner,scanner->index->sheets+i);
+            }
+        }
+    }
+}
+/*  Parse the sheets recording lines of the given input
+ *  between line-delta and line+delta.
+ */
+static void _synctex_index_parse_lines(synctex_scanner_p scanner, int tag, int line, int delta) {
+    if (scanner && scanner->index) {
+        synctex_index_p index = scanner->index;
+        int i, j;
+        for (i = 0; i<index->number_of_sheets; ++i) {
+            synctex_index_sheet_s * sheet = index->sheets+i;
+            for (j = sheet->first_range; j<sheet->first_range+sheet->number_of_ranges; ++j) {
+                if (index->ranges[j].tag == tag
+                    && index->ranges[j].first<=line+delta
+                    && index->ranges[j].last>=line-delta) {
+                    _synctex_index_parse_sheet(scanner,sheet);
+                    break;
+                }
+            }
+        }
+    }
+}
 synctex_scanner_p synctex_scanner_new() {
     synctex_scanner_p scanner =(synctex_scanner_p)_synctex_malloc(sizeof(synctex_scanner_s));
     if (scanner) {
@@ -6039,6 +6385,7 @@ int synctex_scanner_free(synctex_scanner_p scanner) {
         synctex_node_free(scanner->sheet);
         synctex_node_free(scanner->form);
         synctex_node_free(scanner->input);
+        _synctex_index_free(scanner->index);
         synctex_reader_free(scanner->reader);
         SYNCTEX_SCANNER_FREE_HANDLE(scanner);
         synctex_iterator_free(scanner->iterator);
@@ -6088,19 +6435,23 @@ synctex_scanner_p synctex_scanner_parse(synctex_scanner_p scanner) {
 #   if defined(SYNCTEX_USE_CHARINDEX)
     scanner->reader->charindex_offset = -SYNCTEX_BUFFER_SIZE;
 #   endif
+    /*  With an index, the postamble is read now and the sheets on demand. */
+    _synctex_scan_index(scanner);
     status = _synctex_scan_preamble(scanner);
     if (status<SYNCTEX_STATUS_OK) {
         _synctex_error("Bad preamble\n");
         goto bailey;
     }
-    status = _synctex_scan_content(scanner);
-    if (status<SYNCTEX_STATUS_OK) {
-        _synctex_error("Bad content\n");
-        goto bailey;
-    }
-    status = _synctex_scan_postamble(scanner);
-    if (status<SYNCTEX_STATUS_OK) {
-        _synctex_error("Bad postamble. Ignored\n");
+    if (NULL == scanner->index) {
+        status = _synctex_scan_content(scanner);
+        if (status<SYNCTEX_STATUS_OK) {
+            _synctex_error("Bad content\n");
+            goto bailey;
+        }
+        status = _synctex_scan_postamble(scanner);
+        if (status<SYNCTEX_STATUS_OK) {
+            _synctex_error("Bad postamble. Ignored\n");
+        }
     }
 #if SYNCTEX_DEBUG>500
     synctex_scanner_set_display_switcher(scanner, 100);
@@ -6171,6 +6522,7 @@ void synctex_scanner_display(synctex_scanner_p scanner) {
     printf("The input:\n");
     synctex_node_display(scanner->input);
     if (scanner->count<1000) {
+        _synctex_index_parse_page(scanner,0);
         printf("The sheets:\n");
         synctex_node_display(scanner->sheet);
         printf("The friends:\n");
@@ -6988,7 +7340,9 @@ int synctex_node_child_count(synctex_node_p node) {
  */
 synctex_node_p synctex_sheet(synctex_scanner_p scanner,int page) {
     if (scanner) {
-        synctex_node_p sheet = scanner->sheet;
+        synctex_node_p sheet = NULL;
+        _synctex_index_parse_page(scanner,page);
+        sheet = scanner->sheet;
         while(sheet) {
             if (page == _synctex_data_page(sheet)) {
                 return sheet;
@@ -7477,6 +7831,8 @@ synctex_iterator_p synctex_iterator_new_display(synctex_scanner_p scanner,const
         if (line>max_line) {
             line = max_line;
         }
+        /*  The lines tried below are within try_count of line. */
+        _synctex_index_parse_lines(scanner,tag,line,try_count);
         while(try_count--) {
             if (line<=max_line) {
                 /*  This loop will only be performed once for advanced viewers */
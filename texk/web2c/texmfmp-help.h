@@ -124,6 +124,10 @@ const_string EPTEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -186,6 +190,10 @@ const_string ETEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -253,6 +261,10 @@ const_string EUPTEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -454,6 +466,10 @@ const_string PDFTEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -522,6 +538,10 @@ const_string PTEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -583,6 +603,10 @@ const_string TEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -649,6 +673,10 @@ const_string UPTEXHELP[] = {
     "[-no]-parse-first-line  disable/enable parsing of first line of input file",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the DVI file",
@@ -708,6 +736,10 @@ const_string XETEXHELP[] = {
     "-papersize=STRING       set PDF media size to STRING",
     "-progname=STRING        set program (and fmt) name to STRING",
     "-recorder               enable filename recorder",
+#ifndef WIN32
+    "-server=SOCKET          after loading the format, run jobs sent to the",
+    "                          Unix domain socket SOCKET in forked processes",
+#endif
     "[-no]-shell-escape      disable/enable \\write18{SHELL COMMAND}",
     "-shell-restricted       enable restricted \\write18",
     "-src-specials           insert source specials into the XDV file",
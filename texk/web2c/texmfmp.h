@@ -167,6 +167,14 @@ extern string translate_filename;
 #define translatefilename translate_filename
 #endif
 
+/* Server mode, see texmfmp.c.  */
+#if defined(TeX) && !defined(Aleph)
+extern string server_name;
+#define servername server_name
+extern void serve_jobs (void);
+#define servejobs serve_jobs
+#endif
+
 #ifdef TeX
 /* The type `glueratio' should be a floating point type which won't
    unnecessarily increase the size of the memoryword structure.  This is
@@ -261,15 +269,18 @@ extern void topenin (void);
 /* f is declared as gzFile, but we temporarily use it for a FILE *
    so that we can use the standard open calls */
 #define wopenin(f)	(open_input ((FILE**)&(f), DUMP_FORMAT, FOPEN_RBIN_MODE) \
+						&& (native_dump_open_in ((FILE*)f), true) \
 						&& (f = gzdopen(fileno((FILE*)f), FOPEN_RBIN_MODE)))
 #define wopenout(f)	(open_output ((FILE**)&(f), FOPEN_WBIN_MODE) \
+						&& (native_dump_open_out (), true) \
 						&& (f = gzdopen(fileno((FILE*)f), FOPEN_WBIN_MODE)) \
 						&& (gzsetparams(f, 1, Z_DEFAULT_STRATEGY) == Z_OK))
-#define wclose(f)	gzclose(f)
+#define wclose(f)	(gzclose(f), native_dump_close ())
 #else
-#define wopenin(f)	open_input (&(f), DUMP_FORMAT, FOPEN_RBIN_MODE)
-#define wopenout	bopenout
-#define wclose		aclose
+#define wopenin(f)	(open_input (&(f), DUMP_FORMAT, FOPEN_RBIN_MODE) \
+			 && (native_dump_open_in (f), true))
+#define wopenout(f)	(bopenout (f) && (native_dump_open_out (), true))
+#define wclose(f)	(aclose (f), native_dump_close ())
 #endif
 
 #ifdef XeTeX
@@ -360,6 +371,10 @@ extern void do_undump (char *, int, int, gzFile);
 extern void do_dump (char *, int, int, FILE *);
 extern void do_undump (char *, int, int, FILE *);
 #endif
+/* Native-endian copies of the dump data, see texmfmp.c.  */
+extern void native_dump_open_in (FILE *);
+extern void native_dump_open_out (void);
+extern void native_dump_close (void);
 
 /* Use the above for all the other dumping and undumping.  */
 #define generic_dump(x) dumpthings (x, 1)
@@ -54,6 +54,9 @@ FT_Library gFreeTypeLibrary = 0;
 
 static hb_font_funcs_t* hbFontFuncs = NULL;
 
+unsigned long XeTeXFontInst::sGlyphMetricsLookups = 0;
+unsigned long XeTeXFontInst::sGlyphMetricsHits = 0;
+
 XeTeXFontInst::XeTeXFontInst(const char* pathname, int index, float pointSize, int &status)
     : m_unitsPerEM(0)
     , m_pointSize(pointSize)
@@ -393,7 +396,7 @@ XeTeXFontInst::getFontTable(FT_Sfnt_Tag tag) const
 }
 
 void
-XeTeXFontInst::getGlyphBounds(GlyphID gid, GlyphBBox* bbox)
+XeTeXFontInst::loadGlyphBounds(GlyphID gid, GlyphBBox* bbox)
 {
     bbox->xMin = bbox->yMin = bbox->xMax = bbox->yMax = 0.0;
 
@@ -414,6 +417,38 @@ XeTeXFontInst::getGlyphBounds(GlyphID gid, GlyphBBox* bbox)
     }
 }
 
+/* Returns true if the given metrics of glyph gid are already in the table.
+   Otherwise, the entry is marked valid and the caller has to fill it in. */
+bool
+XeTeXFontInst::haveGlyphMetrics(GlyphID gid, unsigned char flag)
+{
+    sGlyphMetricsLookups++;
+    if (m_glyphMetricsFlags.empty()) {
+        uint16_t numGlyphs = getNumGlyphs();
+        m_glyphBounds.resize(numGlyphs);
+        m_glyphWidths.resize(numGlyphs);
+        m_glyphMetricsFlags.resize(numGlyphs, 0);
+    }
+    if (m_glyphMetricsFlags[gid] & flag) {
+        sGlyphMetricsHits++;
+        return true;
+    }
+    m_glyphMetricsFlags[gid] |= flag;
+    return false;
+}
+
+void
+XeTeXFontInst::getGlyphBounds(GlyphID gid, GlyphBBox* bbox)
+{
+    if (gid >= getNumGlyphs()) {
+        loadGlyphBounds(gid, bbox);
+        return;
+    }
+    if (!haveGlyphMetrics(gid, kGlyphBoundsValid))
+        loadGlyphBounds(gid, &m_glyphBounds[gid]);
+    *bbox = m_glyphBounds[gid];
+}
+
 GlyphID
 XeTeXFontInst::mapCharToGlyph(UChar32 ch) const
 {
@@ -429,7 +464,11 @@ XeTeXFontInst::getNumGlyphs() const
 float
 XeTeXFontInst::getGlyphWidth(GlyphID gid)
 {
-    return unitsToPoints(_get_glyph_advance(m_ftFace, gid, false));
+    if (gid >= getNumGlyphs())
+        return unitsToPoints(_get_glyph_advance(m_ftFace, gid, false));
+    if (!haveGlyphMetrics(gid, kGlyphWidthValid))
+        m_glyphWidths[gid] = unitsToPoints(_get_glyph_advance(m_ftFace, gid, false));
+    return m_glyphWidths[gid];
 }
 
 void
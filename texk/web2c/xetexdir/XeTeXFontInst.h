@@ -46,6 +46,7 @@ authorization from the copyright holders.
 #include "XeTeXFontMgr.h"
 
 #include <stdio.h>
+#include <vector>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include FT_TRUETYPE_TABLES_H
@@ -71,6 +72,22 @@ protected:
     FT_Face m_ftFace;
     hb_font_t* m_hbFont;
 
+    // per-glyph metrics in TeX points, indexed by glyph ID and filled
+    // lazily; m_glyphMetricsFlags says which entries are valid
+    enum {
+        kGlyphBoundsValid = 1,
+        kGlyphWidthValid = 2
+    };
+    std::vector<GlyphBBox> m_glyphBounds;
+    std::vector<float> m_glyphWidths;
+    std::vector<unsigned char> m_glyphMetricsFlags;
+
+    static unsigned long sGlyphMetricsLookups;
+    static unsigned long sGlyphMetricsHits;
+
+    bool haveGlyphMetrics(GlyphID gid, unsigned char flag);
+    void loadGlyphBounds(GlyphID gid, GlyphBBox* bbox);
+
 public:
     XeTeXFontInst(float pointSize, int &status);
     XeTeXFontInst(const char* filename, int index, float pointSize, int &status);
@@ -112,6 +129,9 @@ public:
 
     const char* getGlyphName(GlyphID gid, int& nameLen);
 
+    static unsigned long getGlyphMetricsLookups() { return sGlyphMetricsLookups; }
+    static unsigned long getGlyphMetricsHits() { return sGlyphMetricsHits; }
+
     UChar32 getFirstCharCode();
     UChar32 getLastCharCode();
 
@@ -31,6 +31,7 @@ authorization from the copyright holders.
 \****************************************************************************/
 
 #include <w2c/config.h>
+#include <kpathsea/kpathsea.h>
 
 #include "XeTeXFontMgr_FC.h"
 
@@ -44,6 +45,18 @@ authorization from the copyright holders.
 
 #include <unicode/ucnv.h>
 
+#include <algorithm>
+#include <set>
+
+#ifndef _WIN32
+#define USE_NAME_INDEX 1
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #define kFontFamilyName 1
 #define kFontStyleName  2
 #define kFontFullName   4
@@ -189,6 +202,12 @@ XeTeXFontMgr_FC::readNames(FcPattern* pat)
 void
 XeTeXFontMgr_FC::getOpSizeRecAndStyleFlags(Font* theFont)
 {
+    std::map<PlatformFontRef,uint32_t>::const_iterator i = m_indexedFonts.find(theFont->fontRef);
+    if (i != m_indexedFonts.end()) {
+        getIndexedStyleFlags(i->second, theFont);
+        return;
+    }
+
     XeTeXFontMgr::getOpSizeRecAndStyleFlags(theFont);
 
     if (theFont->weight == 0 && theFont->width == 0) {
@@ -204,6 +223,26 @@ XeTeXFontMgr_FC::getOpSizeRecAndStyleFlags(Font* theFont)
     }
 }
 
+// identifies a font independently of the pattern it was loaded from, so that
+// a font taken from the name index isn't added again when fontconfig lists it
+static std::pair<std::string,int>
+fontFileAndIndex(FcPattern* pat)
+{
+    char* path;
+    int index;
+    if (FcPatternGetString(pat, FC_FILE, 0, (FcChar8**)&path) != FcResultMatch)
+        path = (char*)"";
+    if (FcPatternGetInteger(pat, FC_INDEX, 0, &index) != FcResultMatch)
+        index = 0;
+    return std::make_pair(std::string(path), index);
+}
+
+bool
+XeTeXFontMgr_FC::isLoadedFont(FcPattern* pat) const
+{
+    return m_loadedFonts.find(fontFileAndIndex(pat)) != m_loadedFonts.end();
+}
+
 void
 XeTeXFontMgr_FC::cacheFamilyMembers(const std::list<std::string>& familyNames)
 {
@@ -211,15 +250,13 @@ XeTeXFontMgr_FC::cacheFamilyMembers(const std::list<std::string>& familyNames)
         return;
     for (int f = 0; f < allFonts->nfont; ++f) {
         FcPattern* pat = allFonts->fonts[f];
-        if (m_platformRefToFont.find(pat) != m_platformRefToFont.end())
+        if (m_platformRefToFont.find(pat) != m_platformRefToFont.end() || isLoadedFont(pat))
             continue;
         char* s;
         for (int i = 0; FcPatternGetString(pat, FC_FAMILY, i, (FcChar8**)&s) == FcResultMatch; ++i) {
             for (std::list<std::string>::const_iterator j = familyNames.begin(); j != familyNames.end(); ++j) {
                 if (*j == s) {
-                    NameCollection* names = readNames(pat);
-                    addToMaps(pat, names);
-                    delete names;
+                    delete addFont(pat);
                     goto cached;
                 }
             }
@@ -229,12 +266,28 @@ XeTeXFontMgr_FC::cacheFamilyMembers(const std::list<std::string>& familyNames)
     }
 }
 
+XeTeXFontMgr::NameCollection*
+XeTeXFontMgr_FC::addFont(FcPattern* pat)
+{
+    NameCollection* names = readNames(pat);
+    addToMaps(pat, names);
+    if (m_platformRefToFont.find(pat) != m_platformRefToFont.end())
+        m_newFonts[pat] = *names;
+    m_loadedFonts.insert(fontFileAndIndex(pat));
+    return names;
+}
+
 void
 XeTeXFontMgr_FC::searchForHostPlatformFonts(const std::string& name)
 {
+    if (searchNameIndex(name))
+        return;
+
     if (cachedAll) // we've already loaded everything on an earlier search
         return;
 
+    initFontconfig();
+
     std::string famName;
     int hyph = name.find('-');
     if (hyph > 0 && hyph < name.length() - 1)
@@ -246,14 +299,12 @@ XeTeXFontMgr_FC::searchForHostPlatformFonts(const std::string& name)
     while (1) {
         for (int f = 0; f < allFonts->nfont; ++f) {
             FcPattern* pat = allFonts->fonts[f];
-            if (m_platformRefToFont.find(pat) != m_platformRefToFont.end())
+            if (m_platformRefToFont.find(pat) != m_platformRefToFont.end() || isLoadedFont(pat))
                 continue;
 
             if (cachedAll) {
                 // failed to find it via FC; add everything to our maps (potentially slow) as a last resort
-                NameCollection* names = readNames(pat);
-                addToMaps(pat, names);
-                delete names;
+                delete addFont(pat);
                 continue;
             }
 
@@ -261,8 +312,7 @@ XeTeXFontMgr_FC::searchForHostPlatformFonts(const std::string& name)
             int i;
             for (i = 0; FcPatternGetString(pat, FC_FULLNAME, i, (FcChar8**)&s) == FcResultMatch; ++i) {
                 if (name == s) {
-                    NameCollection* names = readNames(pat);
-                    addToMaps(pat, names);
+                    NameCollection* names = addFont(pat);
                     cacheFamilyMembers(names->m_familyNames);
                     delete names;
                     found = true;
@@ -272,8 +322,7 @@ XeTeXFontMgr_FC::searchForHostPlatformFonts(const std::string& name)
 
             for (i = 0; FcPatternGetString(pat, FC_FAMILY, i, (FcChar8**)&s) == FcResultMatch; ++i) {
                 if (name == s || (hyph && famName == s)) {
-                    NameCollection* names = readNames(pat);
-                    addToMaps(pat, names);
+                    NameCollection* names = addFont(pat);
                     cacheFamilyMembers(names->m_familyNames);
                     delete names;
                     found = true;
@@ -285,8 +334,7 @@ XeTeXFontMgr_FC::searchForHostPlatformFonts(const std::string& name)
                     full += " ";
                     full += t;
                     if (name == full) {
-                        NameCollection* names = readNames(pat);
-                        addToMaps(pat, names);
+                        NameCollection* names = addFont(pat);
                         cacheFamilyMembers(names->m_familyNames);
                         delete names;
                         found = true;
@@ -305,14 +353,48 @@ XeTeXFontMgr_FC::searchForHostPlatformFonts(const std::string& name)
     }
 }
 
+bool
+XeTeXFontMgr_FC::isKnownName(const std::string& name) const
+{
+    // mirror the lookups done by XeTeXFontMgr::findFont
+    if (m_nameToFont.find(name) != m_nameToFont.end()
+            || m_psNameToFont.find(name) != m_psNameToFont.end()
+            || m_nameToFamily.find(name) != m_nameToFamily.end())
+        return true;
+
+    int hyph = name.find('-');
+    if (hyph > 0 && hyph < name.length() - 1) {
+        std::map<std::string,Family*>::const_iterator f =
+            m_nameToFamily.find(std::string(name.begin(), name.begin() + hyph));
+        if (f != m_nameToFamily.end()
+                && f->second->styles->find(std::string(name.begin() + hyph + 1, name.end())) != f->second->styles->end())
+            return true;
+    }
+    return false;
+}
+
 void
-XeTeXFontMgr_FC::initialize()
+XeTeXFontMgr_FC::initFontconfig()
 {
+    if (allFonts != NULL)
+        return;
+
     if (FcInit() == FcFalse) {
         fprintf(stderr, "fontconfig initialization failed!\n");
         exit(9);
     }
 
+    FcPattern* pat = FcNameParse((const FcChar8*)":outline=true");
+    FcObjectSet* os = FcObjectSetBuild(FC_FAMILY, FC_STYLE, FC_FILE, FC_INDEX,
+                                       FC_FULLNAME, FC_WEIGHT, FC_WIDTH, FC_SLANT, FC_FONTFORMAT, NULL);
+    allFonts = FcFontList(FcConfigGetCurrent(), pat, os);
+    FcObjectSetDestroy(os);
+    FcPatternDestroy(pat);
+}
+
+void
+XeTeXFontMgr_FC::initialize()
+{
     if (gFreeTypeLibrary == 0 && FT_Init_FreeType(&gFreeTypeLibrary) != 0) {
         fprintf(stderr, "FreeType initialization failed!\n");
         exit(9);
@@ -327,19 +409,18 @@ XeTeXFontMgr_FC::initialize()
         exit(3);
     }
 
-    FcPattern* pat = FcNameParse((const FcChar8*)":outline=true");
-    FcObjectSet* os = FcObjectSetBuild(FC_FAMILY, FC_STYLE, FC_FILE, FC_INDEX,
-                                       FC_FULLNAME, FC_WEIGHT, FC_WIDTH, FC_SLANT, FC_FONTFORMAT, NULL);
-    allFonts = FcFontList(FcConfigGetCurrent(), pat, os);
-    FcObjectSetDestroy(os);
-    FcPatternDestroy(pat);
-
+    // fontconfig is only initialized if the name index can't resolve a font name
+    allFonts = NULL;
     cachedAll = false;
+
+    loadNameIndex();
 }
 
 void
 XeTeXFontMgr_FC::terminate()
 {
+    writeNameIndex();
+
     if (macRomanConv != NULL)
         ucnv_close(macRomanConv);
     if (utf16beConv != NULL)
@@ -360,3 +441,500 @@ XeTeXFontMgr_FC::getPlatformFontDesc(PlatformFontRef font) const
     return path;
 }
 
+
+/* Persistent name index.
+
+   Finding a font by name may require fontconfig to list all installed fonts
+   and FreeType to open each candidate to read its name table, which is slow
+   on systems with many fonts. The names and style data of every font found
+   that way are therefore saved in $TEXMFVAR/xetex/fontnames.idx when the
+   job ends. Later runs map this file into memory and resolve font names by
+   binary search in its sorted name table; fontconfig is initialized only if
+   a name isn't found there.
+
+   An entry is only used if the modification time and size of its font file,
+   and the modification time of the directory containing it, still match.
+   Otherwise the search falls back to fontconfig, and the index is rewritten
+   without the stale entries.
+
+   The file is written in native byte order and is ignored if its header
+   doesn't match. */
+
+#define kNameIndexMagic     "XeTeXidx"
+#define kNameIndexVersion   1
+#define kNameIndexByteOrder 0x01020304
+
+struct NameIndexHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byteOrder;
+    uint32_t    fileSize;
+    uint32_t    numFonts;
+    uint32_t    numNames;
+    uint32_t    fontsOffset;    // array of NameIndexFont
+    uint32_t    namesOffset;    // array of NameIndexName, sorted by name
+    uint32_t    stringsOffset;  // NUL-terminated strings
+};
+
+struct NameIndexFont {
+    int64_t     mtime;          // of the font file
+    int64_t     size;
+    int64_t     dirMtime;       // of the directory containing the font file
+    double      designSize;
+    double      minSize;
+    double      maxSize;
+    uint32_t    path;           // string offsets; name lists are
+    int32_t     index;          // sequences of strings ended by ""
+    uint32_t    psName;
+    uint32_t    familyNames;
+    uint32_t    styleNames;
+    uint32_t    fullNames;
+    uint32_t    subFamilyID;
+    uint32_t    nameCode;
+    uint16_t    weight;
+    uint16_t    width;
+    int16_t     slant;
+    uint16_t    flags;
+};
+
+struct NameIndexName {
+    uint32_t    name;           // string offset
+    uint32_t    font;           // index into the font array
+};
+
+enum {
+    kIndexIsReg = 1,
+    kIndexIsBold = 2,
+    kIndexIsItalic = 4
+};
+
+#ifdef USE_NAME_INDEX
+
+static std::string
+nameIndexPath()
+{
+    std::string path;
+    char* var = kpse_brace_expand("$TEXMFVAR");
+    if (var != NULL && kpse_absolute_p(var, false)) {
+        path = var;
+        path += "/xetex/fontnames.idx";
+    }
+    free(var);
+    return path;
+}
+
+static const NameIndexHeader*
+indexHeader(const char* index)
+{
+    return (const NameIndexHeader*)index;
+}
+
+static const NameIndexFont*
+indexFont(const char* index, uint32_t font)
+{
+    return (const NameIndexFont*)(index + indexHeader(index)->fontsOffset) + font;
+}
+
+static const char*
+indexString(const char* index, uint32_t offset)
+{
+    return index + indexHeader(index)->stringsOffset + offset;
+}
+
+static void
+readIndexList(const char* index, uint32_t offset, std::list<std::string>* list)
+{
+    for (const char* s = indexString(index, offset); *s; s += strlen(s) + 1)
+        list->push_back(s);
+}
+
+// compares index names with the name searched for
+class IndexNameLess {
+public:
+    IndexNameLess(const char* index) : m_index(index) { }
+    bool operator()(const NameIndexName& a, const std::string& b) const
+        { return strcmp(indexString(m_index, a.name), b.c_str()) < 0; }
+    bool operator()(const std::string& a, const NameIndexName& b) const
+        { return strcmp(a.c_str(), indexString(m_index, b.name)) < 0; }
+private:
+    const char* m_index;
+};
+
+static void
+findIndexedFonts(const char* index, const std::string& name, std::set<uint32_t>* fonts)
+{
+    const NameIndexHeader* header = indexHeader(index);
+    const NameIndexName* first = (const NameIndexName*)(index + header->namesOffset);
+    const NameIndexName* last = first + header->numNames;
+    std::pair<const NameIndexName*,const NameIndexName*> range =
+        std::equal_range(first, last, name, IndexNameLess(index));
+    for (const NameIndexName* i = range.first; i != range.second; ++i)
+        fonts->insert(i->font);
+}
+
+static bool
+statFontFile(const char* path, int64_t* mtime, int64_t* size, int64_t* dirMtime)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    *mtime = st.st_mtime;
+    *size = st.st_size;
+
+    std::string dir(path);
+    size_t slash = dir.rfind('/');
+    if (slash == std::string::npos)
+        dir = ".";
+    else
+        dir.erase(slash == 0 ? 1 : slash);
+    if (stat(dir.c_str(), &st) != 0)
+        return false;
+    *dirMtime = st.st_mtime;
+    return true;
+}
+
+// check the header and the bounds of all tables, so that later accesses need no checks
+static bool
+nameIndexIsValid(const char* index, size_t size)
+{
+    if (size < sizeof(NameIndexHeader))
+        return false;
+    const NameIndexHeader* header = indexHeader(index);
+    if (memcmp(header->magic, kNameIndexMagic, 8) != 0
+            || header->version != kNameIndexVersion
+            || header->byteOrder != kNameIndexByteOrder
+            || header->fileSize != size)
+        return false;
+    if (header->fontsOffset % 8 != 0 || header->namesOffset % 4 != 0
+            || header->fontsOffset > size
+            || (size - header->fontsOffset) / sizeof(NameIndexFont) < header->numFonts
+            || header->namesOffset > size
+            || (size - header->namesOffset) / sizeof(NameIndexName) < header->numNames
+            || header->stringsOffset >= size
+            || index[size - 1] != 0 || index[size - 2] != 0)
+        return false;
+
+    uint32_t stringsSize = size - header->stringsOffset;
+    for (uint32_t i = 0; i < header->numFonts; ++i) {
+        const NameIndexFont* font = indexFont(index, i);
+        if (font->path >= stringsSize || font->psName >= stringsSize
+                || font->familyNames >= stringsSize || font->styleNames >= stringsSize
+                || font->fullNames >= stringsSize)
+            return false;
+    }
+    const NameIndexName* names = (const NameIndexName*)(index + header->namesOffset);
+    for (uint32_t i = 0; i < header->numNames; ++i)
+        if (names[i].name >= stringsSize || names[i].font >= header->numFonts)
+            return false;
+    return true;
+}
+
+void
+XeTeXFontMgr_FC::loadNameIndex()
+{
+    std::string path = nameIndexPath();
+    if (path.empty())
+        return;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+            if (nameIndexIsValid((const char*)addr, st.st_size)) {
+                m_nameIndex = (const char*)addr;
+                m_nameIndexSize = st.st_size;
+            } else
+                munmap(addr, st.st_size);
+        }
+    }
+    close(fd);
+}
+
+bool
+XeTeXFontMgr_FC::indexedFontIsValid(uint32_t font) const
+{
+    const NameIndexFont* rec = indexFont(m_nameIndex, font);
+    int64_t mtime, size, dirMtime;
+    return statFontFile(indexString(m_nameIndex, rec->path), &mtime, &size, &dirMtime)
+        && mtime == rec->mtime && size == rec->size && dirMtime == rec->dirMtime;
+}
+
+void
+XeTeXFontMgr_FC::addIndexedFont(uint32_t font)
+{
+    const NameIndexFont* rec = indexFont(m_nameIndex, font);
+    std::pair<std::string,int> key(indexString(m_nameIndex, rec->path), rec->index);
+    if (!m_loadedFonts.insert(key).second)
+        return; // already loaded by an earlier search
+
+    FcPattern* pat = FcPatternCreate();
+    FcPatternAddString(pat, FC_FILE, (const FcChar8*)indexString(m_nameIndex, rec->path));
+    FcPatternAddInteger(pat, FC_INDEX, rec->index);
+    m_indexedFonts[pat] = font;
+
+    NameCollection names;
+    names.m_psName = indexString(m_nameIndex, rec->psName);
+    readIndexList(m_nameIndex, rec->familyNames, &names.m_familyNames);
+    readIndexList(m_nameIndex, rec->styleNames, &names.m_styleNames);
+    readIndexList(m_nameIndex, rec->fullNames, &names.m_fullNames);
+    addToMaps(pat, &names);
+}
+
+void
+XeTeXFontMgr_FC::getIndexedStyleFlags(uint32_t font, Font* theFont) const
+{
+    const NameIndexFont* rec = indexFont(m_nameIndex, font);
+    theFont->opSizeInfo.designSize = rec->designSize;
+    theFont->opSizeInfo.minSize = rec->minSize;
+    theFont->opSizeInfo.maxSize = rec->maxSize;
+    theFont->opSizeInfo.subFamilyID = rec->subFamilyID;
+    theFont->opSizeInfo.nameCode = rec->nameCode;
+    theFont->weight = rec->weight;
+    theFont->width = rec->width;
+    theFont->slant = rec->slant;
+    theFont->isReg = (rec->flags & kIndexIsReg) != 0;
+    theFont->isBold = (rec->flags & kIndexIsBold) != 0;
+    theFont->isItalic = (rec->flags & kIndexIsItalic) != 0;
+}
+
+bool
+XeTeXFontMgr_FC::searchNameIndex(const std::string& name)
+{
+    if (m_nameIndex == NULL)
+        return false;
+
+    std::set<uint32_t> fonts;
+    findIndexedFonts(m_nameIndex, name, &fonts);
+    int hyph = name.find('-');
+    if (hyph > 0 && hyph < name.length() - 1)
+        findIndexedFonts(m_nameIndex, std::string(name.begin(), name.begin() + hyph), &fonts);
+    if (fonts.empty())
+        return false;
+
+    // like the fontconfig search, load whole families
+    std::set<uint32_t> members;
+    for (std::set<uint32_t>::const_iterator i = fonts.begin(); i != fonts.end(); ++i) {
+        std::list<std::string> familyNames;
+        readIndexList(m_nameIndex, indexFont(m_nameIndex, *i)->familyNames, &familyNames);
+        for (std::list<std::string>::const_iterator j = familyNames.begin(); j != familyNames.end(); ++j)
+            findIndexedFonts(m_nameIndex, *j, &members);
+    }
+    fonts.insert(members.begin(), members.end());
+
+    for (std::set<uint32_t>::const_iterator i = fonts.begin(); i != fonts.end(); ++i) {
+        if (!indexedFontIsValid(*i)) {
+            m_nameIndexStale = true;
+            return false;
+        }
+    }
+    for (std::set<uint32_t>::const_iterator i = fonts.begin(); i != fonts.end(); ++i)
+        addIndexedFont(*i);
+
+    return isKnownName(name);
+}
+
+// collects the entries and the string pool of a new index file
+class NameIndexWriter {
+public:
+    void addFont(NameIndexFont font, const char* path, const std::string& psName,
+                 const std::list<std::string>& familyNames, const std::list<std::string>& styleNames,
+                 const std::list<std::string>& fullNames)
+    {
+        uint32_t fontID = m_fonts.size();
+        font.path = addString(path);
+        font.psName = addString(psName);
+        addName(font.psName, fontID);
+        font.familyNames = addList(familyNames, fontID);
+        font.styleNames = addList(styleNames, fontID, false);
+        font.fullNames = addList(fullNames, fontID);
+        m_fonts.push_back(font);
+    }
+
+    bool write(const std::string& path)
+    {
+        std::sort(m_names.begin(), m_names.end(), NameLess(m_strings));
+        m_strings += '\0';  // so that the pool ends with two NULs
+
+        NameIndexHeader header;
+        memcpy(header.magic, kNameIndexMagic, 8);
+        header.version = kNameIndexVersion;
+        header.byteOrder = kNameIndexByteOrder;
+        header.numFonts = m_fonts.size();
+        header.numNames = m_names.size();
+        header.fontsOffset = (sizeof(NameIndexHeader) + 7) & ~7;
+        header.namesOffset = header.fontsOffset + m_fonts.size() * sizeof(NameIndexFont);
+        header.stringsOffset = header.namesOffset + m_names.size() * sizeof(NameIndexName);
+        header.fileSize = header.stringsOffset + m_strings.size();
+
+        // concurrent jobs may be writing the index, so each uses its own
+        // temporary file in the same directory and renames it when complete
+        std::string tmpPath = path + ".XXXXXX";
+        int fd = mkstemp(&tmpPath[0]);
+        if (fd < 0)
+            return false;
+        mode_t mask = umask(0);
+        umask(mask);
+        fchmod(fd, 0666 & ~mask);   // mkstemp creates the file with mode 0600
+        FILE* f = fdopen(fd, FOPEN_WBIN_MODE);
+        if (f == NULL) {
+            close(fd);
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        static const char padding[8] = { 0 };
+        size_t padSize = header.fontsOffset - sizeof(header);
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+            && fwrite(padding, 1, padSize, f) == padSize
+            && fwrite(&m_fonts[0], sizeof(NameIndexFont), m_fonts.size(), f) == m_fonts.size()
+            && (m_names.empty() || fwrite(&m_names[0], sizeof(NameIndexName), m_names.size(), f) == m_names.size())
+            && fwrite(m_strings.data(), 1, m_strings.size(), f) == m_strings.size();
+        if (fclose(f) != 0)
+            ok = false;
+        if (ok)
+            ok = rename(tmpPath.c_str(), path.c_str()) == 0;
+        if (!ok)
+            unlink(tmpPath.c_str());
+        return ok;
+    }
+
+    bool empty() const { return m_fonts.empty(); }
+
+private:
+    class NameLess {
+    public:
+        NameLess(const std::string& strings) : m_strings(strings) { }
+        bool operator()(const NameIndexName& a, const NameIndexName& b) const
+            { return strcmp(&m_strings[a.name], &m_strings[b.name]) < 0; }
+    private:
+        const std::string& m_strings;
+    };
+
+    uint32_t addString(const std::string& str)
+    {
+        uint32_t offset = m_strings.size();
+        m_strings += str;
+        m_strings += '\0';
+        return offset;
+    }
+
+    uint32_t addList(const std::list<std::string>& list, uint32_t fontID, bool indexNames = true)
+    {
+        uint32_t offset = m_strings.size();
+        for (std::list<std::string>::const_iterator i = list.begin(); i != list.end(); ++i) {
+            if (i->empty())
+                continue;
+            uint32_t str = addString(*i);
+            if (indexNames)
+                addName(str, fontID);
+        }
+        m_strings += '\0';
+        return offset;
+    }
+
+    void addName(uint32_t str, uint32_t fontID)
+    {
+        NameIndexName name;
+        name.name = str;
+        name.font = fontID;
+        m_names.push_back(name);
+    }
+
+    std::vector<NameIndexFont>  m_fonts;
+    std::vector<NameIndexName>  m_names;
+    std::string                 m_strings;
+};
+
+static bool
+makeDirs(const std::string& path)
+{
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        std::string dir(path, 0, slash);
+        if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+            return false;
+    }
+    return true;
+}
+
+void
+XeTeXFontMgr_FC::writeNameIndex()
+{
+    if (m_newFonts.empty() && !m_nameIndexStale)
+        return;
+
+    std::string path = nameIndexPath();
+    if (path.empty() || !makeDirs(path))
+        return;
+
+    NameIndexWriter writer;
+    std::set<std::pair<std::string,int> > written;
+
+    // fonts found by fontconfig in this run
+    for (std::map<PlatformFontRef,NameCollection>::const_iterator i = m_newFonts.begin(); i != m_newFonts.end(); ++i) {
+        char* pathname;
+        int index;
+        if (FcPatternGetString(i->first, FC_FILE, 0, (FcChar8**)&pathname) != FcResultMatch
+                || FcPatternGetInteger(i->first, FC_INDEX, 0, &index) != FcResultMatch)
+            continue;
+        NameIndexFont rec;
+        memset(&rec, 0, sizeof(rec));
+        if (!statFontFile(pathname, &rec.mtime, &rec.size, &rec.dirMtime))
+            continue;
+        const Font* font = m_platformRefToFont[i->first];
+        rec.index = index;
+        rec.designSize = font->opSizeInfo.designSize;
+        rec.subFamilyID = font->opSizeInfo.subFamilyID;
+        if (rec.subFamilyID != 0) {
+            rec.minSize = font->opSizeInfo.minSize;
+            rec.maxSize = font->opSizeInfo.maxSize;
+            rec.nameCode = font->opSizeInfo.nameCode;
+        }
+        rec.weight = font->weight;
+        rec.width = font->width;
+        rec.slant = font->slant;
+        rec.flags = (font->isReg ? kIndexIsReg : 0) | (font->isBold ? kIndexIsBold : 0)
+            | (font->isItalic ? kIndexIsItalic : 0);
+        writer.addFont(rec, pathname, i->second.m_psName,
+                       i->second.m_familyNames, i->second.m_styleNames, i->second.m_fullNames);
+        written.insert(std::make_pair(std::string(pathname), index));
+    }
+
+    // entries of the old index that are still up to date
+    if (m_nameIndex != NULL) {
+        for (uint32_t i = 0; i < indexHeader(m_nameIndex)->numFonts; ++i) {
+            const NameIndexFont* rec = indexFont(m_nameIndex, i);
+            const char* pathname = indexString(m_nameIndex, rec->path);
+            if (written.find(std::make_pair(std::string(pathname), rec->index)) != written.end()
+                    || !indexedFontIsValid(i))
+                continue;
+            NameCollection names;
+            names.m_psName = indexString(m_nameIndex, rec->psName);
+            readIndexList(m_nameIndex, rec->familyNames, &names.m_familyNames);
+            readIndexList(m_nameIndex, rec->styleNames, &names.m_styleNames);
+            readIndexList(m_nameIndex, rec->fullNames, &names.m_fullNames);
+            writer.addFont(*rec, pathname, names.m_psName,
+                           names.m_familyNames, names.m_styleNames, names.m_fullNames);
+            written.insert(std::make_pair(std::string(pathname), rec->index));
+        }
+    }
+
+    if (writer.empty())
+        unlink(path.c_str());
+    else
+        writer.write(path);
+    m_newFonts.clear();
+    m_nameIndexStale = false;
+}
+
+#else /* !USE_NAME_INDEX */
+
+void XeTeXFontMgr_FC::loadNameIndex() { }
+void XeTeXFontMgr_FC::writeNameIndex() { }
+bool XeTeXFontMgr_FC::searchNameIndex(const std::string& name) { return false; }
+void XeTeXFontMgr_FC::addIndexedFont(uint32_t font) { }
+bool XeTeXFontMgr_FC::indexedFontIsValid(uint32_t font) const { return false; }
+void XeTeXFontMgr_FC::getIndexedStyleFlags(uint32_t font, Font* theFont) const { }
+
+#endif /* USE_NAME_INDEX */
@@ -35,11 +35,15 @@ authorization from the copyright holders.
 
 #include "XeTeXFontMgr.h"
 
+#include <set>
+
 class XeTeXFontMgr_FC
     : public XeTeXFontMgr
 {
 public:
                                     XeTeXFontMgr_FC()
+                                        : allFonts(NULL), cachedAll(false)
+                                        , m_nameIndex(NULL), m_nameIndexSize(0), m_nameIndexStale(false)
                                         { }
     virtual                         ~XeTeXFontMgr_FC()
                                         { }
@@ -57,9 +61,29 @@ protected:
     std::string                     getPlatformFontDesc(PlatformFontRef font) const;
 
     void                            cacheFamilyMembers(const std::list<std::string>& familyNames);
+    NameCollection*                 addFont(FcPattern* pat);
+
+    void                            initFontconfig();
+    bool                            isKnownName(const std::string& name) const;
+    bool                            isLoadedFont(FcPattern* pat) const;
+
+    // persistent name index, see XeTeXFontMgr_FC.cpp
+    void                            loadNameIndex();
+    void                            writeNameIndex();
+    bool                            searchNameIndex(const std::string& name);
+    void                            addIndexedFont(uint32_t font);
+    void                            getIndexedStyleFlags(uint32_t font, Font* theFont) const;
+    bool                            indexedFontIsValid(uint32_t font) const;
 
     FcFontSet*  allFonts;
     bool        cachedAll;
+
+    const char*                             m_nameIndex;        // mapped index file, or NULL
+    size_t                                  m_nameIndexSize;
+    bool                                    m_nameIndexStale;   // some entries are out of date
+    std::map<PlatformFontRef,uint32_t>      m_indexedFonts;     // fonts taken from the index
+    std::map<PlatformFontRef,NameCollection> m_newFonts;        // fonts to be added to the index
+    std::set<std::pair<std::string,int> >   m_loadedFonts;      // file and index of every font in the maps
 };
 
 #endif  /* __XETEX_FONT_MGR_FC_H */
@@ -55,6 +55,20 @@ authorization from the copyright holders.
 #endif
 #include "XeTeXFontMgr.h"
 
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+// result of shaping a run of text, positions are in font units
+struct ShapingResult
+{
+    std::vector<uint32_t>               glyphs;
+    std::vector<hb_glyph_position_t>    positions;
+    hb_script_t                         script;  // script of the shaped segment
+    const char*                         shaper;  // name of the shaper used
+};
+
 struct XeTeXLayoutEngine_rec
 {
     XeTeXFontInst*  font;
@@ -63,41 +77,126 @@ struct XeTeXLayoutEngine_rec
     hb_language_t   language;
     hb_feature_t*   features;
     char**          ShaperList; // the requested shapers
-    char*           shaper;     // the actually used shaper
+    const char*     shaper;     // the actually used shaper
     int             nFeatures;
     uint32_t        rgbValue;
     float           extend;
     float           slant;
     float           embolden;
     hb_buffer_t*    hbBuffer;
+    uint32_t        id;         // identifies the engine in the shaping cache
+    ShapingResult   result;     // result of the last call of layoutChars
 };
 
 /*******************************************************************/
-/* Glyph bounding box cache to speed up \XeTeXuseglyphmetrics mode */
+/* LRU cache of shaping results to avoid reshaping the same words  */
 /*******************************************************************/
-#include <map>
 
-// key is combined value representing (font_id << 16) + glyph
-// value is glyph bounding box in TeX points
-static std::map<uint32_t,GlyphBBox> sGlyphBoxes;
+class ShapingCache
+{
+public:
+    ShapingCache(size_t capacity) : m_capacity(capacity), m_hits(0), m_lookups(0) { }
+
+    // returns the cached result for the given key or NULL if there is none
+    const ShapingResult* find(const std::string& key)
+    {
+        m_lookups++;
+        std::map<std::string, EntryList::iterator>::iterator i = m_index.find(key);
+        if (i == m_index.end())
+            return NULL;
+        m_hits++;
+        // move the entry to the front of the LRU list
+        m_entries.splice(m_entries.begin(), m_entries, i->second);
+        return &i->second->second;
+    }
+
+    void insert(const std::string& key, const ShapingResult& result)
+    {
+        if (m_index.size() >= m_capacity) {
+            // drop the least recently used entry
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+        m_entries.push_front(Entry(key, result));
+        m_index[key] = m_entries.begin();
+    }
+
+    unsigned long hits() const { return m_hits; }
+    unsigned long lookups() const { return m_lookups; }
+
+private:
+    typedef std::pair<std::string, ShapingResult> Entry;
+    typedef std::list<Entry> EntryList;
+
+    size_t                                      m_capacity;
+    EntryList                                   m_entries;
+    std::map<std::string, EntryList::iterator>  m_index;
+    unsigned long                               m_hits;
+    unsigned long                               m_lookups;
+};
+
+static ShapingCache sShapingCache(16384);
+
+int
+shapingcachehits()
+{
+    return (int) sShapingCache.hits();
+}
+
+int
+shapingcachelookups()
+{
+    return (int) sShapingCache.lookups();
+}
+/*******************************************************************/
+
+/*******************************************************************/
+/* Glyph bounding box cache to speed up \XeTeXuseglyphmetrics mode */
+/*******************************************************************/
+// OpenType fonts keep their glyph metrics in a dense table in XeTeXFontInst;
+// this cache is used for AAT fonts only. It is indexed by font_id and glyph,
+// and holds the glyph bounding box in TeX points
+struct CachedGlyphBBox {
+    GlyphBBox bbox;
+    bool valid;
+};
+static std::vector<std::vector<CachedGlyphBBox> > sGlyphBoxes;
 
 int
 getCachedGlyphBBox(uint16_t fontID, uint16_t glyphID, GlyphBBox* bbox)
 {
-    uint32_t key = ((uint32_t)fontID << 16) + glyphID;
-    std::map<uint32_t,GlyphBBox>::const_iterator i = sGlyphBoxes.find(key);
-    if (i == sGlyphBoxes.end()) {
+    if (fontID >= sGlyphBoxes.size() || glyphID >= sGlyphBoxes[fontID].size())
         return 0;
-    }
-    *bbox = i->second;
+    const CachedGlyphBBox& entry = sGlyphBoxes[fontID][glyphID];
+    if (!entry.valid)
+        return 0;
+    *bbox = entry.bbox;
     return 1;
 }
 
 void
 cacheGlyphBBox(uint16_t fontID, uint16_t glyphID, const GlyphBBox* bbox)
 {
-    uint32_t key = ((uint32_t)fontID << 16) + glyphID;
-    sGlyphBoxes[key] = *bbox;
+    if (fontID >= sGlyphBoxes.size())
+        sGlyphBoxes.resize(fontID + 1);
+    if (glyphID >= sGlyphBoxes[fontID].size()) {
+        CachedGlyphBBox empty = { { 0.0, 0.0, 0.0, 0.0 }, false };
+        sGlyphBoxes[fontID].resize(glyphID + 1, empty);
+    }
+    sGlyphBoxes[fontID][glyphID].bbox = *bbox;
+    sGlyphBoxes[fontID][glyphID].valid = true;
+}
+
+int
+glyphmetricshits()
+{
+    return (int) XeTeXFontInst::getGlyphMetricsHits();
+}
+
+int
+glyphmetricslookups()
+{
+    return (int) XeTeXFontInst::getGlyphMetricsLookups();
 }
 /*******************************************************************/
 
@@ -629,6 +728,7 @@ createLayoutEngine(PlatformFontRef fontRef, XeTeXFont font, hb_tag_t script, cha
                     hb_feature_t* features, int nFeatures, char **shapers, uint32_t rgbValue,
                     float extend, float slant, float embolden)
 {
+    static uint32_t engineCount = 0;
     XeTeXLayoutEngine result = new XeTeXLayoutEngine_rec;
     result->fontRef = fontRef;
     result->font = (XeTeXFontInst*)font;
@@ -642,6 +742,9 @@ createLayoutEngine(PlatformFontRef fontRef, XeTeXFont font, hb_tag_t script, cha
     result->slant = slant;
     result->embolden = embolden;
     result->hbBuffer = hb_buffer_create();
+    result->id = ++engineCount;
+    result->result.script = HB_SCRIPT_INVALID;
+    result->result.shaper = NULL;
 
     // For Graphite fonts treat the language as BCP 47 tag, for OpenType we
     // treat it as a OT language tag for backward compatibility with pre-0.9999
@@ -661,7 +764,6 @@ deleteLayoutEngine(XeTeXLayoutEngine engine)
 {
     hb_buffer_destroy(engine->hbBuffer);
     delete engine->font;
-    free(engine->shaper);
 }
 
 #if !HB_VERSION_ATLEAST(2,5,0)
@@ -700,6 +802,24 @@ layoutChars(XeTeXLayoutEngine engine, uint16_t chars[], int32_t offset, int32_t
     else if (rightToLeft)
         direction = HB_DIRECTION_RTL;
 
+    // Font, script, language, features and shapers are fixed for each engine,
+    // so together with the direction and the text the engine ID identifies
+    // the shaping result. The whole text is included in the key because
+    // HarfBuzz looks at the characters surrounding the run, too.
+    std::string key;
+    key.append((const char*) &engine->id, sizeof(engine->id));
+    key.append((const char*) &direction, sizeof(direction));
+    key.append((const char*) &offset, sizeof(offset));
+    key.append((const char*) &count, sizeof(count));
+    key.append((const char*) chars, max * sizeof(uint16_t));
+
+    const ShapingResult* cachedResult = sShapingCache.find(key);
+    if (cachedResult != NULL) {
+        engine->result = *cachedResult;
+        engine->shaper = cachedResult->shaper;
+        return engine->result.glyphs.size();
+    }
+
     script = hb_ot_tag_to_script (engine->script);
 
     hb_buffer_reset(engine->hbBuffer);
@@ -734,7 +854,7 @@ layoutChars(XeTeXLayoutEngine engine, uint16_t chars[], int32_t offset, int32_t
     res = hb_shape_plan_execute(shape_plan, hbFont, engine->hbBuffer, engine->features, engine->nFeatures);
 
     if (res) {
-        engine->shaper = strdup(hb_shape_plan_get_shaper(shape_plan));
+        engine->shaper = hb_shape_plan_get_shaper(shape_plan);
         hb_buffer_set_content_type(engine->hbBuffer, HB_BUFFER_CONTENT_TYPE_GLYPHS);
     } else {
         // all selected shapers failed, retrying with default
@@ -744,7 +864,7 @@ layoutChars(XeTeXLayoutEngine engine, uint16_t chars[], int32_t offset, int32_t
         res = hb_shape_plan_execute(shape_plan, hbFont, engine->hbBuffer, engine->features, engine->nFeatures);
 
         if (res) {
-            engine->shaper = strdup(hb_shape_plan_get_shaper(shape_plan));
+            engine->shaper = hb_shape_plan_get_shaper(shape_plan);
             hb_buffer_set_content_type(engine->hbBuffer, HB_BUFFER_CONTENT_TYPE_GLYPHS);
         } else {
             fprintf(stderr, "\nERROR: all shapers failed\n");
@@ -770,24 +890,34 @@ layoutChars(XeTeXLayoutEngine engine, uint16_t chars[], int32_t offset, int32_t
         printf ("buffer glyphs: %s\n", buf);
 #endif
 
+    hb_glyph_info_t *hbGlyphs = hb_buffer_get_glyph_infos(engine->hbBuffer, NULL);
+    hb_glyph_position_t *hbPositions = hb_buffer_get_glyph_positions(engine->hbBuffer, NULL);
+
+    engine->result.glyphs.resize(glyphCount);
+    for (int i = 0; i < glyphCount; i++)
+        engine->result.glyphs[i] = hbGlyphs[i].codepoint;
+    engine->result.positions.assign(hbPositions, hbPositions + glyphCount);
+    engine->result.script = hb_buffer_get_script(engine->hbBuffer);
+    engine->result.shaper = engine->shaper;
+    sShapingCache.insert(key, engine->result);
+
     return glyphCount;
 }
 
 void
 getGlyphs(XeTeXLayoutEngine engine, uint32_t glyphs[])
 {
-    int glyphCount = hb_buffer_get_length(engine->hbBuffer);
-    hb_glyph_info_t *hbGlyphs = hb_buffer_get_glyph_infos(engine->hbBuffer, NULL);
+    int glyphCount = engine->result.glyphs.size();
 
     for (int i = 0; i < glyphCount; i++)
-        glyphs[i] = hbGlyphs[i].codepoint;
+        glyphs[i] = engine->result.glyphs[i];
 }
 
 void
 getGlyphAdvances(XeTeXLayoutEngine engine, float advances[])
 {
-    int glyphCount = hb_buffer_get_length(engine->hbBuffer);
-    hb_glyph_position_t *hbPositions = hb_buffer_get_glyph_positions(engine->hbBuffer, NULL);
+    int glyphCount = engine->result.glyphs.size();
+    const hb_glyph_position_t *hbPositions = engine->result.positions.data();
 
     for (int i = 0; i < glyphCount; i++) {
         if (engine->font->getLayoutDirVertical())
@@ -800,8 +930,8 @@ getGlyphAdvances(XeTeXLayoutEngine engine, float advances[])
 void
 getGlyphPositions(XeTeXLayoutEngine engine, FloatPoint positions[])
 {
-    int glyphCount = hb_buffer_get_length(engine->hbBuffer);
-    hb_glyph_position_t *hbPositions = hb_buffer_get_glyph_positions(engine->hbBuffer, NULL);
+    int glyphCount = engine->result.glyphs.size();
+    const hb_glyph_position_t *hbPositions = engine->result.positions.data();
 
     float x = 0, y = 0;
 
@@ -853,7 +983,7 @@ getCapAndXHeight(XeTeXLayoutEngine engine, float* capheight, float* xheight)
 int
 getDefaultDirection(XeTeXLayoutEngine engine)
 {
-    hb_script_t script = hb_buffer_get_script(engine->hbBuffer);
+    hb_script_t script = engine->result.script;
     if (hb_script_get_horizontal_direction (script) == HB_DIRECTION_RTL)
         return UBIDI_DEFAULT_RTL;
     else
@@ -64,6 +64,11 @@ void cacheGlyphBBox(uint16_t fontID, uint16_t glyphID, const GlyphBBox* bbox);
 
 void terminatefontmanager();
 
+int shapingcachehits();
+int shapingcachelookups();
+int glyphmetricshits();
+int glyphmetricslookups();
+
 XeTeXFont createFont(PlatformFontRef fontRef, Fixed pointSize);
 XeTeXFont createFontFromFile(const char* filename, int index, Fixed pointSize);
 
@@ -2152,17 +2152,14 @@ measure_native_node(void* pNode, int use_glyph_metrics)
             float y = Fix2D(-locations[i].y); /* NB negative is upwards in locations[].y! */
 
             GlyphBBox bbox;
-            if (getCachedGlyphBBox(f, glyphIDs[i], &bbox) == 0) {
+            if (fontarea[f] == OTGR_FONT_FLAG)
+                getGlyphBounds((XeTeXLayoutEngine)(fontlayoutengine[f]), glyphIDs[i], &bbox);
 #ifdef XETEX_MAC
-                if (fontarea[f] == AAT_FONT_FLAG)
-                    GetGlyphBBox_AAT((CFDictionaryRef)(fontlayoutengine[f]), glyphIDs[i], &bbox);
-                else
-#endif
-                if (fontarea[f] == OTGR_FONT_FLAG)
-                    getGlyphBounds((XeTeXLayoutEngine)(fontlayoutengine[f]), glyphIDs[i], &bbox);
-
+            else if (getCachedGlyphBBox(f, glyphIDs[i], &bbox) == 0) {
+                GetGlyphBBox_AAT((CFDictionaryRef)(fontlayoutengine[f]), glyphIDs[i], &bbox);
                 cacheGlyphBBox(f, glyphIDs[i], &bbox);
             }
+#endif
 
             ht = bbox.yMax;
             dp = -bbox.yMin;
@@ -255,6 +255,10 @@ extern "C" {
     void makeutf16name(void);
 
     void terminatefontmanager(void);
+    int shapingcachehits(void);
+    int shapingcachelookups(void);
+    int glyphmetricshits(void);
+    int glyphmetricslookups(void);
     int maketexstring(const char* s);
 
     void checkfortfmfontmapping(void);